@@ -2,30 +2,28 @@
 
 const vec3 gravity = vec3(0.f, -9.8f, 0.f);
 
-uniform int size; //cloth scale
-
-uniform float mass;
-uniform float a_resistance; //-0.125f
-uniform vec3 f_wind; //vec3(0.f, 0.f, 0.f)
-
-uniform float ks;
-uniform float kd;
-uniform float ks_bend;
-uniform float kd_bend;
-uniform float rest_length; //1.f
-uniform float diag_length; //sqrt(2) * rest_length
-
-uniform float delta_time;
-
-uniform vec3 u_position;
-//for collision detection
+//std140, EulerCloth keeps the same layout on the CPU side
+layout(std140) uniform EulerParams {
+    vec3 f_wind;
+    int size; //cloth scale
+    vec3 u_position;
+    float mass;
+    float a_resistance;
+    float ks;
+    float kd;
+    float ks_bend;
+    float kd_bend;
+    float rest_length;
+    float diag_length; //sqrt(2) * rest_length
+    float delta_time;
+};
 
 uniform isamplerBuffer constraints_tbo;
 uniform samplerBuffer velocities_tbo;
 uniform samplerBuffer vertices_tbo;
 
-layout(location = 0) out vec3 o_velocity;
-layout(location = 1) out vec3 o_vertex;
+out vec3 o_velocity;
+out vec3 o_vertex;
 
 bool getSpringMsg(inout int index, inout float r_length) {
     // p - p - 8 - p - p
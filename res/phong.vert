@@ -3,16 +3,23 @@
 layout(location = 1) in vec3 a_position;
 layout(location = 2) in vec3 a_normal;
 layout(location = 3) in vec2 a_texcoord;
+layout(location = 4) in vec3 a_last_position; //only cloths have it
 
-uniform vec3 u_mPos;
-uniform vec3 u_mScale;
-uniform mat3 u_mRotate;
+//std140 blocks, Object3D and Camera keep the same layout on the CPU side
+layout(std140, row_major) uniform Object {
+    mat3 u_mRotate;
+    vec3 u_mPos;
+    float u_lag; //0 draws a_position, 1 draws a_last_position
+    vec3 u_mScale;
+};
 //model_view * vec4(position, 1.0) = u_mPos + (u_mRotate * (u_mScale * position));
 //u_NMatrix * normal = u_mRotate * (u_mScale * normal);
 
-uniform vec3 p_eye;
-uniform mat4 u_view;
-uniform mat4 u_proj;
+layout(std140, row_major) uniform Camera {
+    mat4 u_view;
+    mat4 u_proj;
+    vec3 p_eye;
+};
 
 out vec3 v_N;
 out vec3 v_E;
@@ -20,7 +27,8 @@ out vec3 v_mPos;
 out vec2 v_texcoord;
 
 void main() {
-    vec3 m_pos = u_mPos + (u_mRotate * (u_mScale * a_position));
+    vec3 position = mix(a_position, a_last_position, u_lag);
+    vec3 m_pos = u_mPos + (u_mRotate * (u_mScale * position));
     gl_Position = u_proj * (u_view * vec4(m_pos, 1.0));
     
     if(a_normal == vec3(0.0f)) v_N = a_normal;
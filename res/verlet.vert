@@ -2,23 +2,23 @@
 
 const float EXPSION = 0.00072; //deal with Z fighting
 
-uniform ivec2 size;
-uniform vec2 rest_length;
-uniform float diag_length;
+//std140, VerletCloth keeps the same layout on the CPU side
+layout(std140) uniform VerletParams {
+    ivec2 size;
+    vec2 rest_length;
+    vec3 gravity;
+    float diag_length;
+    vec3 f_wind;
+    float mass;
+    vec3 u_position;
+    float a_resistance;
+    float delta_time; //of one substep
+    float ks;
+    float kd;
+    float ks_bend;
+    float kd_bend;
+};
 
-uniform float ks;
-uniform float kd;
-uniform float ks_bend;
-uniform float kd_bend;
-
-uniform float mass;
-uniform vec3 gravity;
-uniform float a_resistance;
-uniform vec3 f_wind;
-
-uniform float delta_time;
-
-uniform vec3 u_position;
 uniform vec3 s_center;
 uniform float s_radius;
 
@@ -0,0 +1,47 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef CORE_H
+#define CORE_H
+
+//Definitions of the simulation core (math, physics, threads), nothing of GL here.
+//Header.h puts GLEW, GLFW and ImGui on top for the rendering part.
+//The out of line parts are in core.cpp, the ClothCore library.
+
+//Standard header
+#include <iostream>
+#include <string>
+#include <cmath>
+
+//some basic type
+using Kint = int;
+using Kuint = unsigned int;
+using Kfloat = float;
+using Kdouble = double;
+using Klong = long;
+using Kulong = unsigned long;
+using Kshort = short;
+using Kushort = unsigned short;
+using Kboolean = bool;
+using Ksize = unsigned int;
+using Kchar = char;
+using Kuchar = unsigned char;
+using Kbyte = char;
+using Kubyte = unsigned char;
+
+//Some definition
+#define EPSILON_E6 1E-6
+#define PI 3.1415926535
+#ifdef KNAN
+#undef KNAN
+#endif
+#define KNAN nan("Nan")
+
+//One level, false if it is not there afterwards.
+bool makeDirectory(std::string path);
+
+//Moves from over to, replacing it in one go where the system can.
+bool replaceFile(const std::string& from, const std::string& to);
+
+#endif // !CORE_H
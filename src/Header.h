@@ -6,11 +6,9 @@
 #define HEADER_H
 
 //A definition header for project.
+//The GL free part is Core.h, the simulation only needs that one.
 
-//Standard header
-#include <iostream>
-#include <string>
-#include <cmath>
+#include "./Core.h"
 
 //OpenGL header
 #include <GL/glew.h>
@@ -23,37 +21,14 @@
 #include <imgui_impl_glfw_gl3.h>
 #endif
 
-//some basic type
-using Kint = int;
-using Kuint = unsigned int;
-using Kfloat = float;
-using Kdouble = double;
-using Klong = long;
-using Kulong = unsigned long;
-using Kshort = short;
-using Kushort = unsigned short;
-using Kboolean = bool;
-using Ksize = unsigned int;
-using Kchar = char;
-using Kuchar = unsigned char;
-using Kbyte = char;
-using Kubyte = unsigned char;
-
-//Some definition
-#define EPSILON_E6 1E-6
-#define PI 3.1415926535
-#ifdef KNAN
-#undef KNAN
-#endif
-#define KNAN nan("Nan")
 std::string RES_PATH = "./res/";
 
 //debug
 #include <iomanip>
 #define glCall(x)	x; \
 					glCheckError(#x, __FILE__, __LINE__);
-void glClearError() { while (glGetError() != GL_NO_ERROR); } //ǰд;
-bool glCheckError(const char* fun, const char* file, int line) {
+inline void glClearError() { while (glGetError() != GL_NO_ERROR); } //ǰд;
+inline bool glCheckError(const char* fun, const char* file, int line) {
 	GLenum error;
 	if ((error = glGetError()) != GL_NO_ERROR) {
 		std::cerr << "OpenGL error at: " << fun << " in file: " << file << " at line: " << line
@@ -63,21 +38,4 @@ bool glCheckError(const char* fun, const char* file, int line) {
 	return true;
 }
 
-#include <fstream>
-
-std::ofstream os("data.txt");
-Kuint n = 0;
-
-void save_data(const Kfloat* data, int size) {
-	if (n > 30) {
-		if (os.is_open()) os.close();
-	}
-	os << n++ << "\n";
-	for (int i = 0; i < 2 * 3 * size;) {
-		os << data[i++] << " " << data[i++] << " " << data[i++] << "\t";
-		if (i == size * 3) os << "\n";
-	}
-	os << "\n";
-}
-
 #endif //HEADER_H
@@ -7,7 +7,12 @@
 
 #include <GL/glew.h>
 #include <GLFW/glfw3.h>
+#ifdef HEADLESS_EGL
+#include <EGL/egl.h>
+#include <EGL/eglext.h>
+#endif
 #include <string>
+#include <chrono>
 #include "./Header.h"
 #include "./math/Vec2.h"
 #include "./math/Quaternion.h"
@@ -15,6 +20,10 @@
 namespace KRenderer { class	Renderer; }
 
 namespace KWindow {
+	//A GLFW window, or a headless context for batch runs.
+	//Headless has no ImGui, no swap and no events, everything is drawn into an own
+	//framebuffer. Build with HEADLESS_EGL (Mesa, llvmpipe works too) to get a surfaceless
+	//EGL context that needs no display server, otherwise it is a hidden GLFW window.
 	class Window {
 		friend class KRenderer::Renderer;
 
@@ -27,7 +36,147 @@ namespace KWindow {
 		Kboolean is_focus;
 		Kdouble run_time, pause_time;
 
+		Kboolean headless;
+		Kboolean should_close;
+		Kdouble frame_time; //headless time goes on by this every update, 0 for the wall clock
+		Kuint frame_limit; //headless closes after this many updates, 0 for never
+		Kuint frames;
+		Kuint framebuffer, color_buffer, depth_buffer;
+		std::chrono::steady_clock::time_point start_time;
+#ifdef HEADLESS_EGL
+		EGLDisplay display;
+		EGLContext context;
+		EGLSurface surface;
+#endif
+
+		Kdouble getTime()const {
+			if (!headless) return glfwGetTime();
+			if (frame_time > 0.0) return frames * frame_time;
+			return std::chrono::duration<Kdouble>(std::chrono::steady_clock::now() - start_time).count();
+		}
+
+#ifdef HEADLESS_EGL
+		Kboolean initEGL() {
+			//Mesa's surfaceless platform first, it needs neither X nor a GPU
+			auto getPlatformDisplay = reinterpret_cast<PFNEGLGETPLATFORMDISPLAYEXTPROC>(
+				eglGetProcAddress("eglGetPlatformDisplayEXT"));
+			display = EGL_NO_DISPLAY;
+			if (getPlatformDisplay != nullptr)
+				display = getPlatformDisplay(EGL_PLATFORM_SURFACELESS_MESA, EGL_DEFAULT_DISPLAY, nullptr);
+			if (display == EGL_NO_DISPLAY) display = eglGetDisplay(EGL_DEFAULT_DISPLAY);
+			if (display == EGL_NO_DISPLAY || !eglInitialize(display, nullptr, nullptr)) {
+				std::cerr << "EGL initial failed!" << std::endl;
+				return false;
+			}
+			eglBindAPI(EGL_OPENGL_API);
+
+			const EGLint config_attribs[] = {
+				EGL_SURFACE_TYPE, EGL_PBUFFER_BIT,
+				EGL_RENDERABLE_TYPE, EGL_OPENGL_BIT,
+				EGL_NONE
+			};
+			EGLConfig config;
+			EGLint n_configs = 0;
+			eglChooseConfig(display, config_attribs, &config, 1, &n_configs);
+			context = eglCreateContext(display, n_configs > 0 ? config : nullptr, EGL_NO_CONTEXT, nullptr);
+			if (context == EGL_NO_CONTEXT) {
+				std::cerr << "EGL context create failed with error: " << eglGetError() << std::endl;
+				eglTerminate(display);
+				return false;
+			}
+
+			//surfaceless when the driver has it, a small pbuffer otherwise
+			surface = EGL_NO_SURFACE;
+			if (!eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, context) && n_configs > 0) {
+				const EGLint surface_attribs[] = { EGL_WIDTH, 1, EGL_HEIGHT, 1, EGL_NONE };
+				surface = eglCreatePbufferSurface(display, config, surface_attribs);
+				eglMakeCurrent(display, surface, surface, context);
+			}
+			if (eglGetCurrentContext() != context) {
+				std::cerr << "EGL make current failed!" << std::endl;
+				eglDestroyContext(display, context);
+				eglTerminate(display);
+				return false;
+			}
+			return true;
+		}
+#endif
+
+		//Headless draws here, there is no default framebuffer without a surface.
+		void initFramebuffer() {
+			glGenFramebuffers(1, &framebuffer);
+			glGenRenderbuffers(1, &color_buffer);
+			glGenRenderbuffers(1, &depth_buffer);
+			resizeFramebuffer();
+			glBindFramebuffer(GL_FRAMEBUFFER, framebuffer);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_COLOR_ATTACHMENT0, GL_RENDERBUFFER, color_buffer);
+			glFramebufferRenderbuffer(GL_FRAMEBUFFER, GL_DEPTH_ATTACHMENT, GL_RENDERBUFFER, depth_buffer);
+			if (glCheckFramebufferStatus(GL_FRAMEBUFFER) != GL_FRAMEBUFFER_COMPLETE) {
+				std::cerr << "Headless framebuffer is not complete!" << std::endl;
+			}
+		}
+
+		void resizeFramebuffer()const {
+			glBindRenderbuffer(GL_RENDERBUFFER, color_buffer);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_RGBA8, width, height);
+			glBindRenderbuffer(GL_RENDERBUFFER, depth_buffer);
+			glRenderbufferStorage(GL_RENDERBUFFER, GL_DEPTH_COMPONENT24, width, height);
+			glBindRenderbuffer(GL_RENDERBUFFER, 0);
+		}
+
+		Kboolean initHeadless() {
+			window = nullptr;
+#ifdef HEADLESS_EGL
+			if (!initEGL()) return false;
+#else
+			if (!glfwInit()) return false;
+			glfwWindowHint(GLFW_VISIBLE, GLFW_FALSE);
+			window = glfwCreateWindow(width, height, title.data(), nullptr, nullptr);
+			if (!window) {
+				glfwTerminate();
+				return false;
+			}
+			glfwMakeContextCurrent(window);
+#endif
+
+			//no GLX display with EGL, the GL functions are loaded before that check
+			const GLenum error = glewInit();
+			if (error != GLEW_OK && error != GLEW_ERROR_NO_GLX_DISPLAY) {
+				std::cerr << "GLEW initial failed!" << std::endl;
+				destroyContext();
+				return false;
+			}
+
+			initFramebuffer();
+			glViewport(0, 0, width, height);
+			glClearColor(0.17f, 0.17f, 0.17f, 1.0f);
+
+			std::cout << "Version: " << glGetString(GL_VERSION) << " (headless)" << std::endl;
+			is_active = true;
+			run_time = 0;
+			pause_time = 0;
+			start_time = std::chrono::steady_clock::now();
+
+			return true;
+		}
+
+		void destroyContext() {
+#ifdef HEADLESS_EGL
+			if (headless) {
+				eglMakeCurrent(display, EGL_NO_SURFACE, EGL_NO_SURFACE, EGL_NO_CONTEXT);
+				if (surface != EGL_NO_SURFACE) eglDestroySurface(display, surface);
+				eglDestroyContext(display, context);
+				eglTerminate(display);
+				return;
+			}
+#endif
+			if (window != nullptr) glfwDestroyWindow(window);
+			glfwTerminate();
+		}
+
 		Kboolean initGL() {
+			if (headless) return initHeadless();
+
 			if (!glfwInit()) {
 				window = nullptr;
 				return false;
@@ -74,39 +223,68 @@ namespace KWindow {
 		}
 
 	public:
-		Window(const std::string &title, Kint width = 800, Kint height = 800) :
-			title(title), width(width), height(height) {
+		Window(const std::string &title, Kint width = 800, Kint height = 800, Kboolean headless = false) :
+			title(title), width(width), height(height), window(nullptr), is_active(false), is_focus(false),
+			headless(headless), should_close(false), frame_time(1.0 / 60.0), frame_limit(0), frames(0),
+			framebuffer(0), color_buffer(0), depth_buffer(0) {
 			if (!initGL()) {
 				std::cerr << "Create window failed!" << std::endl;
+				should_close = true;
 				return;
 			}
 		}
 		~Window() {
+			if (headless) {
+				if (glIsFramebuffer(framebuffer)) glDeleteFramebuffers(1, &framebuffer);
+				if (glIsRenderbuffer(color_buffer)) glDeleteRenderbuffers(1, &color_buffer);
+				if (glIsRenderbuffer(depth_buffer)) glDeleteRenderbuffers(1, &depth_buffer);
+			}
 #ifdef IMGUI_ENABLE
-			ImGui_ImplGlfwGL3_Shutdown();
-			ImGui::DestroyContext();
+			else {
+				ImGui_ImplGlfwGL3_Shutdown();
+				ImGui::DestroyContext();
+			}
 #endif
-			glfwDestroyWindow(window);
-			glfwTerminate();
+			destroyContext();
 		}
 
 		void resize(Kint w, Kint h) {
 			width = w;
 			height = h;
 			//std::cout << "Window resized with " << w << ", " << h << std::endl;
+			if (headless) resizeFramebuffer();
 			glViewport(0, 0, width, height);
 		}
 
 		bool closed()const {
+			if (headless || window == nullptr) return should_close;
 			return glfwWindowShouldClose(window) == GLFW_TRUE;
 		}
 
+		bool isHeadless()const {
+			return headless;
+		}
+
+		//Headless only, see frame_time and frame_limit.
+		void setFrameTime(Kdouble frame_time) {
+			this->frame_time = frame_time;
+		}
+
+		void setFrameLimit(Kuint frame_limit) {
+			this->frame_limit = frame_limit;
+		}
+
+		Kuint getFramebuffer()const {
+			return framebuffer;
+		}
+
 		bool actived()const {
 			return is_active;
 		}
 
-		void closeWindow()const {
-			glfwSetWindowShouldClose(window, GLFW_TRUE);
+		void closeWindow() {
+			if (headless || window == nullptr) should_close = true;
+			else glfwSetWindowShouldClose(window, GLFW_TRUE);
 		}
 
 		void clear() {
@@ -118,11 +296,16 @@ namespace KWindow {
 		}
 
 		void update() {
+			++frames;
 			if (is_active) {
-				run_time = glfwGetTime() - pause_time;
+				run_time = getTime() - pause_time;
 			}
 			else {
-				pause_time = glfwGetTime() - run_time;
+				pause_time = getTime() - run_time;
+			}
+			if (headless) {
+				if (frame_limit != 0 && frames >= frame_limit) should_close = true;
+				return;
 			}
 			glfwSwapBuffers(window);
 			glfwPollEvents();
@@ -130,7 +313,7 @@ namespace KWindow {
 
 		void setTitle(const std::string& title) {
 			this->title = title;
-			glfwSetWindowTitle(window, this->title.c_str());
+			if (!headless) glfwSetWindowTitle(window, this->title.c_str());
 		}
 
 		void resetTime() {
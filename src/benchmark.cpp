@@ -0,0 +1,490 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+//Throughput of every solver over grid sizes, substeps and thread counts, nothing is drawn.
+//CPU solvers always run, the GPU ones need a headless context. Results go to stdout as CSV, --csv and --json write files too.
+//
+//ClothBenchmark [--solvers a,b] [--sizes 32,64] [--substeps 1,4] [--threads 1,0]
+//               [--warmup n] [--samples n] [--batch n] [--csv file] [--json file] [--no-gpu]
+//ClothBenchmark --check steps
+//Sizes are particles per side, thread 0 is one per hardware thread.
+//--check only runs the default cloth of every ClothSolver integrator for steps steps
+//and exits with 1 when a position is not finite, nothing is timed.
+
+#include <vector>
+#include <string>
+#include <sstream>
+#include <fstream>
+#include <chrono>
+#include <algorithm>
+#include <cstdint>
+#include <cmath>
+#include "Header.h"
+#include "Window.h"
+#include "./render/BackBuffer.h"
+#include "./physics/VerletSolver.h"
+#include "./physics/EulerSolver.h"
+#include "./physics/ClothSolver.h"
+#include "./object/VerletCloth.h"
+#include "./object/EulerCloth.h"
+#ifdef _WIN32
+//after the headers, windows.h defines near and far
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#define PSAPI_VERSION 2
+#include <windows.h>
+#include <psapi.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace KBenchmark {
+	struct Config {
+		std::vector<std::string> solvers;
+		std::vector<Kuint> sizes = { 32, 64, 128 };
+		std::vector<Kuint> substeps = { 1, 4 };
+		std::vector<Kuint> threads = { 1, 0 };
+		Kuint warmup = 10; //steps before timing
+		Kuint samples = 30; //timed batches, the percentiles are over them
+		Kuint batch = 10; //steps per sample
+		std::string csv;
+		std::string json;
+		Kboolean gpu = true;
+		Kuint check = 0; //steps of the stability check, 0 times the solvers
+	};
+
+	struct Result {
+		std::string solver;
+		Kuint size;
+		Kuint particles;
+		Kuint substeps;
+		Kuint threads; //0 on the GPU
+		Kuint steps;
+		Kdouble seconds;
+		Kdouble steps_per_second;
+		Kdouble ns_per_particle_step;
+		Kdouble p50_ms, p90_ms, p99_ms, max_ms; //per step
+		std::int64_t memory_bytes; //resident memory the solver added
+	};
+
+	//Bytes the process has in memory now.
+	std::int64_t getResidentMemory() {
+#ifdef _WIN32
+		PROCESS_MEMORY_COUNTERS counters;
+		if (!GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters))) return 0;
+		return counters.WorkingSetSize;
+#else
+		std::ifstream statm("/proc/self/statm");
+		std::int64_t pages = 0, resident = 0;
+		if (!(statm >> pages >> resident)) return 0;
+		return resident * sysconf(_SC_PAGESIZE);
+#endif
+	}
+
+	//One solver on one grid, step() advances one simulation step.
+	class Case {
+	public:
+		virtual ~Case() = default;
+		virtual void step() = 0;
+		//Waits until the steps are really done, the GPU ones only queue commands.
+		virtual void finish() {}
+		virtual Kuint getThreadCount()const { return 0; }
+		//false when the case could not be set up, e.g. its shader did not build
+		virtual Kboolean isReady()const { return true; }
+	};
+
+	class VerletCPUCase : public Case {
+	private:
+		KThread::ThreadPool* pool;
+		KPhysics::VerletSolverCPU* solver;
+
+	public:
+		VerletCPUCase(Kuint size, Kuint substeps, Kuint threads) : pool(nullptr), solver(nullptr) {
+			pool = new KThread::ThreadPool(threads);
+			KPhysics::VerletParams params(size, size);
+			params.substeps = substeps;
+			solver = new KPhysics::VerletSolverCPU(params, pool);
+		}
+		~VerletCPUCase()override {
+			delete solver;
+			delete pool;
+		}
+
+		void step()override { solver->step(); }
+		Kuint getThreadCount()const override { return pool->getThreadCount(); }
+	};
+
+	class EulerCPUCase : public Case {
+	private:
+		KThread::ThreadPool* pool;
+		KPhysics::EulerSolverCPU* solver;
+
+	public:
+		EulerCPUCase(Kuint size, Kuint threads) : pool(nullptr), solver(nullptr) {
+			pool = new KThread::ThreadPool(threads);
+			solver = new KPhysics::EulerSolverCPU(KPhysics::EulerParams(size), pool);
+		}
+		~EulerCPUCase()override {
+			delete solver;
+			delete pool;
+		}
+
+		void step()override { solver->step(); }
+		Kuint getThreadCount()const override { return pool->getThreadCount(); }
+	};
+
+	class ClothCase : public Case {
+	private:
+		KPhysics::ClothSolver* solver;
+
+	public:
+		ClothCase(Kuint size, KPhysics::Integrator integrator, Kuint substeps, Kuint threads) : solver(nullptr) {
+			solver = new KPhysics::ClothSolver(KPhysics::ClothParams(size), threads);
+			solver->setIntegrator(integrator);
+			if (integrator == KPhysics::XPBD) solver->getXPBDSolver()->setSubsteps(substeps);
+		}
+		~ClothCase()override {
+			delete solver;
+		}
+
+		void step()override { solver->step(0.01f); }
+		Kuint getThreadCount()const override { return solver->getThreadCount(); }
+	};
+
+	class VerletGPUCase : public Case {
+	private:
+		KShader::Shader* shader;
+		KObject::VerletCloth* cloth;
+		Kboolean ready;
+
+	public:
+		VerletGPUCase(Kuint size, Kuint substeps, Kboolean compute) : shader(nullptr), cloth(nullptr), ready(false) {
+			shader = new KShader::Shader();
+			ready = shader->addShader(compute ? GL_COMPUTE_SHADER : GL_VERTEX_SHADER,
+				RES_PATH + (compute ? "verlet.comp" : "verlet.vert"));
+			if (!ready) return;
+			cloth = new KObject::VerletCloth(size - 1, size - 1);
+			cloth->setSubsteps(substeps);
+			shader->bind();
+			if (compute) cloth->initCompute();
+			else cloth->initBackBuffer(shader);
+			cloth->bindBackUniform(shader);
+			shader->bindUniform3f("s_center", KVector::Vec3(0.f, 4.f, 0.f));
+			shader->bindUniform1f("s_radius", 2.f);
+		}
+		~VerletGPUCase()override {
+			delete cloth;
+			delete shader;
+		}
+
+		Kboolean isReady()const override { return ready; }
+
+		void step()override {
+			shader->bind();
+			cloth->renderBack();
+		}
+		void finish()override { glFinish(); }
+	};
+
+	class EulerGPUCase : public Case {
+	private:
+		KShader::Shader* shader;
+		KObject::EulerCloth* cloth;
+		Kboolean ready;
+
+	public:
+		EulerGPUCase(Kuint size, Kboolean compute) : shader(nullptr), cloth(nullptr), ready(false) {
+			shader = new KShader::Shader();
+			ready = shader->addShader(compute ? GL_COMPUTE_SHADER : GL_VERTEX_SHADER,
+				RES_PATH + (compute ? "euler.comp" : "euler.vert"));
+			if (!ready) return;
+			cloth = new KObject::EulerCloth(size);
+			shader->bind();
+			if (compute) cloth->initCompute();
+			else cloth->initBackBuffer(shader);
+			cloth->bindBackUniform(shader);
+		}
+		~EulerGPUCase()override {
+			delete cloth;
+			delete shader;
+		}
+
+		Kboolean isReady()const override { return ready; }
+
+		void step()override {
+			shader->bind();
+			cloth->renderBack();
+		}
+		void finish()override { glFinish(); }
+	};
+
+	const std::vector<std::string> CPU_SOLVERS = {
+		"verlet_cpu", "euler_cpu",
+		"cloth_explicit", "cloth_implicit", "cloth_xpbd", "cloth_projective"
+	};
+	const std::vector<std::string> GL_SOLVERS = {
+		"verlet_feedback", "verlet_compute", "euler_feedback", "euler_compute"
+	};
+
+	Kboolean isGLSolver(const std::string& solver) {
+		return std::find(GL_SOLVERS.begin(), GL_SOLVERS.end(), solver) != GL_SOLVERS.end();
+	}
+
+	Kboolean isKnownSolver(const std::string& solver) {
+		return isGLSolver(solver) || std::find(CPU_SOLVERS.begin(), CPU_SOLVERS.end(), solver) != CPU_SOLVERS.end();
+	}
+
+	Kboolean isThreaded(const std::string& solver) {
+		return !isGLSolver(solver);
+	}
+
+	//Only the Verlet solvers and XPBD split a step into substeps.
+	Kboolean hasSubsteps(const std::string& solver) {
+		return solver == "verlet_cpu" || solver == "verlet_feedback" ||
+			solver == "verlet_compute" || solver == "cloth_xpbd";
+	}
+
+	//nullptr for an unknown solver.
+	Case* createCase(const std::string& solver, Kuint size, Kuint substeps, Kuint threads) {
+		if (solver == "verlet_cpu") return new VerletCPUCase(size, substeps, threads);
+		if (solver == "euler_cpu") return new EulerCPUCase(size, threads);
+		if (solver == "cloth_explicit") return new ClothCase(size, KPhysics::EXPLICIT_EULER, substeps, threads);
+		if (solver == "cloth_implicit") return new ClothCase(size, KPhysics::IMPLICIT_EULER, substeps, threads);
+		if (solver == "cloth_xpbd") return new ClothCase(size, KPhysics::XPBD, substeps, threads);
+		if (solver == "cloth_projective") return new ClothCase(size, KPhysics::PROJECTIVE, substeps, threads);
+		if (solver == "verlet_feedback") return new VerletGPUCase(size, substeps, false);
+		if (solver == "verlet_compute") return new VerletGPUCase(size, substeps, true);
+		if (solver == "euler_feedback") return new EulerGPUCase(size, false);
+		if (solver == "euler_compute") return new EulerGPUCase(size, true);
+		return nullptr;
+	}
+
+	Kdouble percentile(const std::vector<Kdouble>& sorted, Kdouble p) {
+		if (sorted.empty()) return 0.0;
+		const Ksize index = Ksize(p * (sorted.size() - 1) + 0.5);
+		return sorted[std::min<Ksize>(index, sorted.size() - 1)];
+	}
+
+	//false when the case could not be set up, nothing is timed then.
+	Kboolean run(const Config& config, const std::string& solver, Kuint size, Kuint substeps,
+		Kuint threads, Result& result) {
+		const std::int64_t memory = getResidentMemory();
+		Case* test = createCase(solver, size, substeps, threads);
+		if (test == nullptr) return false;
+		if (!test->isReady()) {
+			delete test;
+			return false;
+		}
+		result.memory_bytes = getResidentMemory() - memory;
+
+		for (Kuint i = 0; i < config.warmup; ++i) test->step();
+		test->finish();
+
+		std::vector<Kdouble> times; //ms per step of every sample
+		times.reserve(config.samples);
+		Kdouble total = 0.0;
+		for (Kuint s = 0; s < config.samples; ++s) {
+			const auto start = std::chrono::steady_clock::now();
+			for (Kuint i = 0; i < config.batch; ++i) test->step();
+			test->finish();
+			const Kdouble seconds = std::chrono::duration<Kdouble>(std::chrono::steady_clock::now() - start).count();
+			total += seconds;
+			times.emplace_back(seconds * 1000.0 / config.batch);
+		}
+		std::sort(times.begin(), times.end());
+
+		result.solver = solver;
+		result.size = size;
+		result.particles = size * size;
+		result.substeps = substeps;
+		result.threads = test->getThreadCount();
+		result.steps = config.samples * config.batch;
+		result.seconds = total;
+		result.steps_per_second = total > 0.0 ? result.steps / total : 0.0;
+		result.ns_per_particle_step = result.steps > 0 ? total * 1e9 / result.steps / result.particles : 0.0;
+		result.p50_ms = percentile(times, 0.5);
+		result.p90_ms = percentile(times, 0.9);
+		result.p99_ms = percentile(times, 0.99);
+		result.max_ms = times.empty() ? 0.0 : times.back();
+
+		delete test;
+		return true;
+	}
+
+	void writeCSV(std::ostream& out, const std::vector<Result>& results) {
+		out << "solver,size,particles,substeps,threads,steps,seconds,steps_per_second,"
+			"ns_per_particle_step,p50_ms,p90_ms,p99_ms,max_ms,memory_bytes\n";
+		for (auto& r : results) {
+			out << r.solver << "," << r.size << "," << r.particles << "," << r.substeps << ","
+				<< r.threads << "," << r.steps << "," << r.seconds << "," << r.steps_per_second << ","
+				<< r.ns_per_particle_step << "," << r.p50_ms << "," << r.p90_ms << "," << r.p99_ms << ","
+				<< r.max_ms << "," << r.memory_bytes << "\n";
+		}
+	}
+
+	void writeJSON(std::ostream& out, const std::string& renderer, const std::vector<Result>& results) {
+		out << "{\n\t\"renderer\": \"" << renderer << "\",\n\t\"results\": [";
+		for (Ksize i = 0; i < results.size(); ++i) {
+			const Result& r = results[i];
+			out << (i == 0 ? "\n" : ",\n") << "\t\t{ \"solver\": \"" << r.solver << "\", \"size\": " << r.size
+				<< ", \"particles\": " << r.particles << ", \"substeps\": " << r.substeps
+				<< ", \"threads\": " << r.threads << ", \"steps\": " << r.steps << ", \"seconds\": " << r.seconds
+				<< ", \"steps_per_second\": " << r.steps_per_second
+				<< ", \"ns_per_particle_step\": " << r.ns_per_particle_step
+				<< ", \"p50_ms\": " << r.p50_ms << ", \"p90_ms\": " << r.p90_ms << ", \"p99_ms\": " << r.p99_ms
+				<< ", \"max_ms\": " << r.max_ms << ", \"memory_bytes\": " << r.memory_bytes << " }";
+		}
+		out << "\n\t]\n}\n";
+	}
+
+	//The cloth Cloth draws (ClothParams defaults, 0.01 per step) with every integrator,
+	//false when one of them does not stay finite for steps steps.
+	Kboolean checkStability(Kuint steps) {
+		const KPhysics::Integrator integrators[] = {
+			KPhysics::EXPLICIT_EULER, KPhysics::IMPLICIT_EULER, KPhysics::XPBD, KPhysics::PROJECTIVE
+		};
+		const char* names[] = { "cloth_explicit", "cloth_implicit", "cloth_xpbd", "cloth_projective" };
+		Kboolean stable = true;
+		for (Kuint k = 0; k < 4; ++k) {
+			KPhysics::ClothSolver solver;
+			solver.setIntegrator(integrators[k]);
+			const KPhysics::Particles* particles = solver.getParticles();
+			Kuint step = 0;
+			Kboolean finite = true;
+			for (; step < steps && finite; ++step) {
+				solver.step(0.01f);
+				const KVector::Vec3* p = particles->getPositions();
+				for (Ksize i = 0; i < particles->size() && finite; ++i) {
+					finite = std::isfinite(p[i].x) && std::isfinite(p[i].y) && std::isfinite(p[i].z);
+				}
+			}
+			if (finite) std::cerr << names[k] << ": finite for " << steps << " steps" << std::endl;
+			else std::cerr << names[k] << ": not finite at step " << step << std::endl;
+			stable = stable && finite;
+		}
+		return stable;
+	}
+
+	template <typename T>
+	std::vector<T> split(const std::string& list) {
+		std::vector<T> values;
+		std::stringstream stream(list);
+		std::string item;
+		while (std::getline(stream, item, ',')) {
+			std::stringstream value(item);
+			T v;
+			if (value >> v) values.emplace_back(v);
+		}
+		return values;
+	}
+
+	Kboolean parse(int argc, char** argv, Config& config) {
+		for (int i = 1; i < argc; ++i) {
+			const std::string arg(argv[i]);
+			if (arg == "--no-gpu") {
+				config.gpu = false;
+				continue;
+			}
+			if (i + 1 >= argc) {
+				std::cerr << "Missing value of " << arg << std::endl;
+				return false;
+			}
+			const std::string value(argv[++i]);
+			if (arg == "--solvers") config.solvers = split<std::string>(value);
+			else if (arg == "--sizes") config.sizes = split<Kuint>(value);
+			else if (arg == "--substeps") config.substeps = split<Kuint>(value);
+			else if (arg == "--threads") config.threads = split<Kuint>(value);
+			else if (arg == "--warmup") config.warmup = std::stoul(value);
+			else if (arg == "--samples") config.samples = std::stoul(value);
+			else if (arg == "--batch") config.batch = std::stoul(value);
+			else if (arg == "--csv") config.csv = value;
+			else if (arg == "--json") config.json = value;
+			else if (arg == "--check") config.check = std::stoul(value);
+			else {
+				std::cerr << "Unknown option " << arg << std::endl;
+				return false;
+			}
+		}
+		if (config.solvers.empty()) {
+			config.solvers = CPU_SOLVERS;
+			config.solvers.insert(config.solvers.end(), GL_SOLVERS.begin(), GL_SOLVERS.end());
+		}
+		for (auto& solver : config.solvers) {
+			if (!isKnownSolver(solver)) {
+				std::cerr << "Unknown solver " << solver << std::endl;
+				return false;
+			}
+		}
+		if (config.samples == 0) config.samples = 1;
+		if (config.batch == 0) config.batch = 1;
+		return true;
+	}
+}
+
+int main(int argc, char** argv) {
+	using namespace KBenchmark;
+
+	Config config;
+	if (!parse(argc, argv, config)) return 1;
+	if (config.check > 0) return checkStability(config.check) ? 0 : 1;
+
+	//a context for the GPU solvers, without one only the CPU ones run
+	KWindow::Window* window = nullptr;
+	std::string renderer("none");
+	if (config.gpu) {
+		window = new KWindow::Window("ClothBenchmark", 64, 64, true);
+		if (window->closed()) {
+			std::cerr << "No GL context, only the CPU solvers run." << std::endl;
+			delete window;
+			window = nullptr;
+		}
+		else renderer = reinterpret_cast<const char*>(glGetString(GL_RENDERER));
+	}
+
+	std::vector<Result> results;
+	for (auto& solver : config.solvers) {
+		if (isGLSolver(solver)) {
+			if (window == nullptr) continue;
+			if (solver.find("compute") != std::string::npos && !KShader::Shader::isComputeSupported()) {
+				std::cerr << "Skip " << solver << ", no compute shaders." << std::endl;
+				continue;
+			}
+		}
+		const std::vector<Kuint> substeps = hasSubsteps(solver) ? config.substeps : std::vector<Kuint>{ 1 };
+		const std::vector<Kuint> threads = isThreaded(solver) ? config.threads : std::vector<Kuint>{ 0 };
+		Kboolean ready = true;
+		for (Ksize i = 0; i < config.sizes.size() && ready; ++i) {
+			const Kuint size = config.sizes[i];
+			for (Ksize j = 0; j < substeps.size() && ready; ++j) {
+				const Kuint s = substeps[j];
+				for (Ksize k = 0; k < threads.size() && ready; ++k) {
+					const Kuint t = threads[k];
+					Result result;
+					if (!run(config, solver, size, s, t, result)) {
+						//a shader that does not build fails for every size
+						std::cerr << "Skip " << solver << ", it could not be set up." << std::endl;
+						ready = false;
+						break;
+					}
+					std::cerr << solver << " " << size << "x" << size << " substeps " << s << " threads "
+						<< result.threads << ": " << result.steps_per_second << " steps/s" << std::endl;
+					results.emplace_back(result);
+				}
+			}
+		}
+	}
+
+	writeCSV(std::cout, results);
+	if (!config.csv.empty()) {
+		std::ofstream file(config.csv);
+		writeCSV(file, results);
+	}
+	if (!config.json.empty()) {
+		std::ofstream file(config.json);
+		writeJSON(file, renderer, results);
+	}
+
+	delete window;
+	return 0;
+}
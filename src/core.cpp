@@ -0,0 +1,138 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+//The ClothCore library: math, physics, the thread utilities, the simulation cache and checkpoints without GL.
+//Everything is in the headers except what is below, every header of the core
+//is included so this target does not build when one of them pulls in GL.
+
+#include <cstdio>
+#include <sys/types.h>
+#include <sys/stat.h>
+#ifdef _WIN32
+#include <direct.h>
+#else
+#include <sys/mman.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+#include "Core.h"
+#include "./math/function.h"
+#include "./math/Vec2.h"
+#include "./math/Vec3.h"
+#include "./math/Vec4.h"
+#include "./math/Mat3.h"
+#include "./math/Mat4.h"
+#include "./math/Quaternion.h"
+#include "./math/transform.h"
+#include "./physics/Particles.h"
+#include "./physics/Springs.h"
+#include "./physics/Integrator.h"
+#include "./physics/ImplicitSolver.h"
+#include "./physics/XPBDSolver.h"
+#include "./physics/ProjectiveSolver.h"
+#include "./physics/VerletSolver.h"
+#include "./physics/EulerSolver.h"
+#include "./physics/ClothSolver.h"
+#include "./util/ThreadPool.h"
+#include "./util/WorkQueue.h"
+#include "./util/Profiler.h"
+#include "./util/SimulationClock.h"
+#include "./util/CacheCodec.h"
+#include "./util/SimulationCache.h"
+#include "./util/Checkpoint.h"
+#ifdef _WIN32
+//after the headers, windows.h defines near and far
+#define NOMINMAX
+#define WIN32_LEAN_AND_MEAN
+#include <windows.h>
+#endif
+
+bool makeDirectory(std::string path) {
+	while (path.size() > 1 && (path.back() == '/' || path.back() == '\\')) path.pop_back();
+#ifdef _WIN32
+	_mkdir(path.data());
+	struct _stat info;
+	return _stat(path.data(), &info) == 0 && (info.st_mode & _S_IFDIR);
+#else
+	mkdir(path.data(), 0755);
+	struct stat info;
+	return stat(path.data(), &info) == 0 && S_ISDIR(info.st_mode);
+#endif
+}
+
+bool replaceFile(const std::string& from, const std::string& to) {
+#ifdef _WIN32
+	return MoveFileExA(from.data(), to.data(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+	return rename(from.data(), to.data()) == 0;
+#endif
+}
+
+namespace KCache {
+	bool MappedFile::open(const std::string& path) {
+		close();
+#ifdef _WIN32
+		HANDLE handle = CreateFileA(path.data(), GENERIC_READ, FILE_SHARE_READ, nullptr,
+			OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+		if (handle == INVALID_HANDLE_VALUE) return false;
+		LARGE_INTEGER file_size;
+		if (!GetFileSizeEx(handle, &file_size) || file_size.QuadPart == 0) {
+			CloseHandle(handle);
+			return false;
+		}
+		HANDLE map = CreateFileMappingA(handle, nullptr, PAGE_READONLY, 0, 0, nullptr);
+		const void* view = map != nullptr ? MapViewOfFile(map, FILE_MAP_READ, 0, 0, 0) : nullptr;
+		if (view == nullptr) {
+			if (map != nullptr) CloseHandle(map);
+			CloseHandle(handle);
+			return false;
+		}
+		file = handle;
+		mapping = map;
+		size = file_size.QuadPart;
+#else
+		const int fd = ::open(path.data(), O_RDONLY);
+		if (fd < 0) return false;
+		struct stat info;
+		if (fstat(fd, &info) != 0 || info.st_size == 0) {
+			::close(fd);
+			return false;
+		}
+		void* view = mmap(nullptr, info.st_size, PROT_READ, MAP_SHARED, fd, 0);
+		::close(fd); //the mapping keeps the file
+		if (view == MAP_FAILED) return false;
+		size = info.st_size;
+#endif
+		data = static_cast<const Kubyte*>(view);
+		return true;
+	}
+
+	void MappedFile::close() {
+		if (data == nullptr) return;
+#ifdef _WIN32
+		UnmapViewOfFile(data);
+		CloseHandle(mapping);
+		CloseHandle(file);
+#else
+		munmap(const_cast<Kubyte*>(data), size);
+#endif
+		data = nullptr;
+		size = 0;
+		file = mapping = nullptr;
+	}
+}
+
+namespace KPhysics {
+	const Kfloat VerletSolverCPU::EXPSION = 0.00072f;
+	const Kfloat EulerSolverCPU::EXPSION = 0.00072f;
+	const Kfloat XPBDSolver::EXPSION = 0.00072f;
+	const Kfloat ProjectiveSolver::EXPSION = 0.00072f;
+	const Kfloat ClothSolver::EXPSION = 0.00072f;
+	const Kfloat ClothSolver::MAX_EXPLICIT_STEP = 0.005f;
+}
+
+namespace KTime {
+	const Kuint Profiler::HISTORY = 120;
+	const Kuint Profiler::RING_SIZE = 4096;
+}
@@ -8,8 +8,50 @@
 #include "./render/EulerClothRenderer.h"
 #include "./render/VerletClothRenderer.h"
 
-int main() {
-	auto renderer = new KRenderer::VerletClothRenderer();
+int main(int argc, char** argv) {
+	//--headless [frames]: no window and no GUI, the frames run as fast as they can
+	//--record directory: every frame as a PNG
+	//--profile file: the profiled scopes of every frame as CSV
+	//--cache file: every simulation step to a cache file
+	//--compress: the cache file with lossy compression
+	//--play file: the steps come from a cache file instead of the simulation
+	//--checkpoint file [steps]: the simulation state to file every so many steps
+	//--restore file: the simulation goes on from a checkpoint
+	Kboolean headless = false;
+	Kuint frames = 600;
+	std::string record;
+	std::string profile;
+	std::string cache;
+	std::string play;
+	Kboolean compress = false;
+	std::string checkpoint;
+	Kuint checkpoint_interval = 600;
+	std::string restore;
+	for (int i = 1; i < argc; ++i) {
+		const std::string arg(argv[i]);
+		if (arg == "--headless") {
+			headless = true;
+			if (i + 1 < argc && isdigit(argv[i + 1][0])) frames = std::stoul(argv[++i]);
+		}
+		else if (arg == "--record" && i + 1 < argc) record = argv[++i];
+		else if (arg == "--profile" && i + 1 < argc) profile = argv[++i];
+		else if (arg == "--cache" && i + 1 < argc) cache = argv[++i];
+		else if (arg == "--play" && i + 1 < argc) play = argv[++i];
+		else if (arg == "--compress") compress = true;
+		else if (arg == "--checkpoint" && i + 1 < argc) {
+			checkpoint = argv[++i];
+			if (i + 1 < argc && isdigit(argv[i + 1][0])) checkpoint_interval = std::stoul(argv[++i]);
+		}
+		else if (arg == "--restore" && i + 1 < argc) restore = argv[++i];
+	}
+	auto renderer = new KRenderer::VerletClothRenderer(headless);
+	if (headless) renderer->setFrameLimit(frames);
+	if (!record.empty()) renderer->record(record);
+	if (!profile.empty()) renderer->profile(profile);
+	if (!play.empty()) renderer->playCache(play);
+	else if (!cache.empty()) renderer->recordCache(cache, compress);
+	if (!restore.empty()) renderer->restore(restore);
+	if (!checkpoint.empty()) renderer->checkpoint(checkpoint, checkpoint_interval);
 
 	renderer->exec();
 
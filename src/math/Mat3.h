@@ -7,7 +7,7 @@
 
 #include <cassert>
 #include <iosfwd>
-#include "../Header.h"
+#include "../Core.h"
 #include "./Vec3.h"
 
 namespace KMatrix{
@@ -179,19 +179,19 @@ namespace KMatrix{
         }
     };
 
-    Mat3 operator-(const Mat3 &m){
+    inline Mat3 operator-(const Mat3 &m){
         return Mat3(0) -= m;
     }
-    Mat3 operator+(const Mat3 &m1, const Mat3 &m2){
+    inline Mat3 operator+(const Mat3 &m1, const Mat3 &m2){
         return Mat3(m1) += m2;
     }
-    Mat3 operator-(const Mat3 &m1, const Mat3 &m2){
+    inline Mat3 operator-(const Mat3 &m1, const Mat3 &m2){
         return Mat3(m1) -= m2;
     }
-    Mat3 operator*(const Mat3 &m1, const Mat3 &m2){
+    inline Mat3 operator*(const Mat3 &m1, const Mat3 &m2){
         return Mat3(m1) *= m2;
     }
-    KVector::Vec3 operator*(const Mat3 &m, const KVector::Vec3 &v){
+    inline KVector::Vec3 operator*(const Mat3 &m, const KVector::Vec3 &v){
         return KVector::Vec3(
                 KFunction::dot(v, m[0]),
                 KFunction::dot(v, m[1]),
@@ -210,11 +210,11 @@ namespace KMatrix{
     Mat3 operator/(const Mat3 &m1, const C &c){
         return Mat3(m1) /= c;
     }
-    std::istream& operator>>(std::istream &is, Mat3 &m){
+    inline std::istream& operator>>(std::istream &is, Mat3 &m){
         is >> m[0] >> m[1] >> m[2];
         return is;
     }
-    std::ostream& operator<<(std::ostream &os, const Mat3 &m){
+    inline std::ostream& operator<<(std::ostream &os, const Mat3 &m){
         os << m[0] << '\n';
         os << m[1] << '\n';
         os << m[2];
@@ -7,7 +7,7 @@
 
 #include <cassert>
 #include <iosfwd>
-#include "../Header.h"
+#include "../Core.h"
 #include "./Vec4.h"
 #include "./Mat3.h"
 
@@ -256,19 +256,19 @@ namespace KMatrix{
         }
     };
 
-    Mat4 operator-(const Mat4 &m){
+    inline Mat4 operator-(const Mat4 &m){
         return Mat4(0) -= m;
     }
-    Mat4 operator+(const Mat4 &m1, const Mat4 &m2){
+    inline Mat4 operator+(const Mat4 &m1, const Mat4 &m2){
         return Mat4(m1) += m2;
     }
-    Mat4 operator-(const Mat4 &m1, const Mat4 &m2){
+    inline Mat4 operator-(const Mat4 &m1, const Mat4 &m2){
         return Mat4(m1) -= m2;
     }
-    Mat4 operator*(const Mat4 &m1, const Mat4 &m2){
+    inline Mat4 operator*(const Mat4 &m1, const Mat4 &m2){
         return Mat4(m1) *= m2;
     }
-    KVector::Vec4 operator*(const Mat4 &m, const KVector::Vec4 &v){
+    inline KVector::Vec4 operator*(const Mat4 &m, const KVector::Vec4 &v){
         return KVector::Vec4(
                 KFunction::dot(v, m[0]),
                 KFunction::dot(v, m[1]),
@@ -288,11 +288,11 @@ namespace KMatrix{
     Mat4 operator/(const Mat4 &m, const C &c){
         return Mat4(m) /= c;
     }
-    std::istream& operator>>(std::istream &is, Mat4 &m){
+    inline std::istream& operator>>(std::istream &is, Mat4 &m){
         is >> m[0] >> m[1] >> m[2] >> m[3];
         return is;
     }
-    std::ostream& operator<<(std::ostream &os, const Mat4 &m){
+    inline std::ostream& operator<<(std::ostream &os, const Mat4 &m){
         os << m[0] << '\n';
         os << m[1] << '\n';
         os << m[2] << '\n';
@@ -5,7 +5,7 @@
 #ifndef KENGINE_QUATERNION_H
 #define KENGINE_QUATERNION_H
 
-#include "../Header.h"
+#include "../Core.h"
 #include "./Mat4.h"
 
 namespace KMatrix{
@@ -139,24 +139,24 @@ namespace KMatrix{
         friend std::ostream& operator<<(std::ostream &os, const Quaternion &q);
     };
 
-	Quaternion operator-(const Quaternion& q) {
+	inline Quaternion operator-(const Quaternion& q) {
 		return q.getConjugate();
 	}
 
-    Quaternion operator*(const Quaternion &q1, const Quaternion &q2) {
+    inline Quaternion operator*(const Quaternion &q1, const Quaternion &q2) {
         return Quaternion(q1)*=q2;
     }
-    KVector::Vec3 operator*(const Quaternion &q, const KVector::Vec3 &v){
+    inline KVector::Vec3 operator*(const Quaternion &q, const KVector::Vec3 &v){
         Quaternion p = (q * Quaternion(0, v.x, v.y, v.z)) * q.getConjugate();
         //do not use Quaternion(angle, v) for vector will be normalized.
         return KVector::Vec3(p.x, p.y, p.z);
     }
 
-    std::istream& operator>>(std::istream &is, Quaternion &q) {
+    inline std::istream& operator>>(std::istream &is, Quaternion &q) {
         is >> q.w >> q.x >> q.y >> q.z;
         return is;
     }
-    std::ostream& operator<<(std::ostream &os, const Quaternion &q) {
+    inline std::ostream& operator<<(std::ostream &os, const Quaternion &q) {
         os << q.w << " " << q.x << " " << q.y << " " << q.z;
         return os;
     }
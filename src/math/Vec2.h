@@ -8,7 +8,7 @@
 #include <cassert>
 #include <iosfwd>
 #include "./function.h"
-#include "../Header.h"
+#include "../Core.h"
 
 namespace KVector{
     class Vec2{
@@ -20,7 +20,7 @@ namespace KVector{
         };
 
         Vec2():Vec2(0){}
-        Vec2(const Vec2 &v):x(v.x), y(v.y){}
+        Vec2(const Vec2 &v) = default;
         explicit Vec2(const Kfloat &c):x(c), y(c){}
         Vec2(const Kfloat &x, const Kfloat &y):x(x), y(y){}
 
@@ -59,10 +59,7 @@ namespace KVector{
 			return !this->operator==(v);
 		}
 
-        Vec2& operator=(const Vec2 &v){
-            set(v.x, v.y);
-            return *this;
-        }
+        Vec2& operator=(const Vec2 &v) = default;
         inline Vec2& operator+=(const Vec2 &v){
             this->x += v.x;
             this->y += v.y;
@@ -113,19 +110,19 @@ namespace KVector{
         }
     };
 
-    Vec2 operator-(const Vec2 &v){
+    inline Vec2 operator-(const Vec2 &v){
         return Vec2() -= v;
     }
-    Vec2 operator+(const Vec2 &v1, const Vec2 &v2){
+    inline Vec2 operator+(const Vec2 &v1, const Vec2 &v2){
         return Vec2(v1) += v2;
     }
-    Vec2 operator-(const Vec2 &v1, const Vec2 &v2){
+    inline Vec2 operator-(const Vec2 &v1, const Vec2 &v2){
         return Vec2(v1) -= v2;
     }
-    Vec2 operator*(const Vec2 &v1, const Vec2 &v2){
+    inline Vec2 operator*(const Vec2 &v1, const Vec2 &v2){
         return Vec2(v1) *= v2;
 	}
-	Vec2 operator/(const Vec2 &v1, const Vec2 &v2) {
+	inline Vec2 operator/(const Vec2 &v1, const Vec2 &v2) {
 		return Vec2(v1) /= v2;
 	}
     template <typename C>
@@ -140,11 +137,11 @@ namespace KVector{
     Vec2 operator/(const Vec2 &v, const C &c){
         return Vec2(v) /= c;
     };
-    std::istream& operator>>(std::istream &is, Vec2 &v){
+    inline std::istream& operator>>(std::istream &is, Vec2 &v){
         is >> v.x >> v.y;
         return is;
     }
-    std::ostream& operator<<(std::ostream &os, const Vec2 &v){
+    inline std::ostream& operator<<(std::ostream &os, const Vec2 &v){
         os << v.x << " " << v.y;
         return os;
     }
@@ -7,7 +7,7 @@
 
 #include <cassert>
 #include <iosfwd>
-#include "../Header.h"
+#include "../Core.h"
 #include "./Vec2.h"
 
 namespace KVector{
@@ -20,7 +20,7 @@ namespace KVector{
         };
 
         Vec3():Vec3(0){}
-        Vec3(const Vec3 &v):x(v.x), y(v.y), z(v.z){}
+        Vec3(const Vec3 &v) = default;
         explicit Vec3(const Kfloat &c):x(c), y(c), z(c){}
         Vec3(const Kfloat &x, const Kfloat &y, const Kfloat &z):x(x), y(y), z(z){}
         Vec3(const Vec2 &v, const Kfloat &z):x(v.x), y(v.y), z(z){}
@@ -63,10 +63,7 @@ namespace KVector{
 			return !this->operator==(v);
 		}
 
-        Vec3& operator=(const Vec3 &v){
-            set(v.x, v.y, v.z);
-            return *this;
-        }
+        Vec3& operator=(const Vec3 &v) = default;
         inline Vec3& operator+=(const Vec3 &v){
             this->x += v.x;
             this->y += v.y;
@@ -151,19 +148,19 @@ namespace KVector{
         }
     };
 
-    Vec3 operator-(const Vec3 &v){
+    inline Vec3 operator-(const Vec3 &v){
         return Vec3() -= v;
     }
-    Vec3 operator+(const Vec3 &v1, const Vec3 &v2){
+    inline Vec3 operator+(const Vec3 &v1, const Vec3 &v2){
         return Vec3(v1) += v2;
     }
-    Vec3 operator-(const Vec3 &v1, const Vec3 &v2){
+    inline Vec3 operator-(const Vec3 &v1, const Vec3 &v2){
         return Vec3(v1) -= v2;
     }
-    Vec3 operator*(const Vec3 &v1, const Vec3 &v2){
+    inline Vec3 operator*(const Vec3 &v1, const Vec3 &v2){
         return Vec3(v1) *= v2;
 	}
-	Vec3 operator/(const Vec3 &v1, const Vec3 &v2) {
+	inline Vec3 operator/(const Vec3 &v1, const Vec3 &v2) {
 		return Vec3(v1) /= v2;
 	}
     template <typename C>
@@ -171,18 +168,18 @@ namespace KVector{
         return Vec3(v) *= c;
     };
     //防止与Mat3 * Vec3 发生冲突，不将常数c设置为其他类型
-    Vec3 operator*(const Kfloat &c, const Vec3 &v){
+    inline Vec3 operator*(const Kfloat &c, const Vec3 &v){
         return Vec3(v) *= c;
     };
     template <typename C>
     Vec3 operator/(const Vec3 &v, const C &c){
         return Vec3(v) /= c;
     };
-    std::istream& operator>>(std::istream &is, Vec3 &v){
+    inline std::istream& operator>>(std::istream &is, Vec3 &v){
         is >> v.x >> v.y >> v.z;
         return is;
     }
-    std::ostream& operator<<(std::ostream &os, const Vec3 &v){
+    inline std::ostream& operator<<(std::ostream &os, const Vec3 &v){
         os << v.x << " " << v.y << " " << v.z;
         return os;
     }
@@ -7,7 +7,7 @@
 
 #include <cassert>
 #include <iosfwd>
-#include "../Header.h"
+#include "../Core.h"
 #include "./function.h"
 #include "./Vec2.h"
 #include "./Vec3.h"
@@ -153,19 +153,19 @@ namespace KVector{
         }
     };
 
-    Vec4 operator-(const Vec4 &v){
+    inline Vec4 operator-(const Vec4 &v){
         return Vec4() -= v;
     }
-    Vec4 operator+(const Vec4 &v1, const Vec4 &v2){
+    inline Vec4 operator+(const Vec4 &v1, const Vec4 &v2){
         return Vec4(v1) += v2;
     }
-    Vec4 operator-(const Vec4 &v1, const Vec4 &v2){
+    inline Vec4 operator-(const Vec4 &v1, const Vec4 &v2){
         return Vec4(v1) -= v2;
     }
-    Vec4 operator*(const Vec4 &v1, const Vec4 &v2){
+    inline Vec4 operator*(const Vec4 &v1, const Vec4 &v2){
         return Vec4(v1) *= v2;
 	}
-	Vec4 operator/(const Vec4 &v1, const Vec4 &v2) {
+	inline Vec4 operator/(const Vec4 &v1, const Vec4 &v2) {
 		return Vec4(v1) /= v2;
 	}
 
@@ -174,18 +174,18 @@ namespace KVector{
         return Vec4(v) *= c;
     }
     //防止与Mat4 * Vec4发生冲突，不将常数c设置为其他类型
-    Vec4 operator*(const Kfloat &c, const Vec4 &v){
+    inline Vec4 operator*(const Kfloat &c, const Vec4 &v){
         return Vec4(v) *= c;
     }
     template <typename C>
     Vec4 operator/(const Vec4 &v, const C &c){
         return Vec4(v) /= c;
     }
-    std::istream& operator>>(std::istream &is, Vec4 &v){
+    inline std::istream& operator>>(std::istream &is, Vec4 &v){
         is >> v.x >> v.y >> v.z >> v.w;
         return is;
     }
-    std::ostream& operator<<(std::ostream &os, const Vec4 &v){
+    inline std::ostream& operator<<(std::ostream &os, const Vec4 &v){
         os << v.x << " " << v.y << " " << v.z << " " << v.w;
         return os;
     }
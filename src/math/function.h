@@ -5,7 +5,7 @@
 #ifndef FUNCTION_H
 #define FUNCTION_H
 
-#include "../Header.h"
+#include "../Core.h"
 
 //Some functions
 namespace KFunction {
@@ -9,7 +9,7 @@
 //lookAt perspective ortho frustum
 //project unproject(vec3 obj, mat4 model, mat4 proj, vec4 viewport)
 
-#include "../Header.h"
+#include "../Core.h"
 #include "./function.h"
 #include "./Mat4.h"
 
@@ -17,7 +17,7 @@ namespace KFunction{
     using namespace KVector;
     using namespace KMatrix;
 
-    Mat4 translate(const Vec3 &v){
+    inline Mat4 translate(const Vec3 &v){
         return Mat4(
                 1, 0, 0, v.x,
                 0, 1, 0, v.y,
@@ -26,7 +26,7 @@ namespace KFunction{
         );
     }
 
-    Mat4 rotate(const Kfloat &angle, const Vec3 &v){
+    inline Mat4 rotate(const Kfloat &angle, const Vec3 &v){
         const auto ang = toRadian<Kfloat>(angle);
         const auto cosA = static_cast<Kfloat>(cos(ang));
         const auto sinA = static_cast<Kfloat>(sin(ang));
@@ -50,7 +50,7 @@ namespace KFunction{
         return m;
     }
 
-    Mat4 scale(const Vec3 &v){
+    inline Mat4 scale(const Vec3 &v){
         return Mat4(
                 v.x, 0, 0, 0,
                 0, v.y, 0, 0,
@@ -59,7 +59,7 @@ namespace KFunction{
         );
     }
 
-    Mat4 lookAt(const Vec3 &eye, const Vec3 &center, const Vec3 &up){
+    inline Mat4 lookAt(const Vec3 &eye, const Vec3 &center, const Vec3 &up){
         //if eye == center or up = 0, the matrix will be nan
         //u-v-n is left-hand coordinate
         const Vec3 n((center - eye).normalize());
@@ -74,7 +74,7 @@ namespace KFunction{
         );
     }
 
-	Mat4 ortho(const Kfloat &left, const Kfloat &right, const Kfloat &bottom,
+	inline Mat4 ortho(const Kfloat &left, const Kfloat &right, const Kfloat &bottom,
 		const Kfloat &top, const Kfloat &near, const Kfloat &far) {
 		Mat4 m;
 
@@ -89,7 +89,7 @@ namespace KFunction{
 		return m;
 	}
 
-	Mat4 frustum(const Kfloat &left, const Kfloat &right, const Kfloat &bottom,
+	inline Mat4 frustum(const Kfloat &left, const Kfloat &right, const Kfloat &bottom,
 		const Kfloat &top, const Kfloat &near, const Kfloat &far) {
 		Mat4 m(0);
 
@@ -105,7 +105,7 @@ namespace KFunction{
 		return m;
 	}
 
-	Mat4 perspective(const Kfloat &fovy, const Kfloat &aspect, const Kfloat &zNear, const Kfloat &zFar) {
+	inline Mat4 perspective(const Kfloat &fovy, const Kfloat &aspect, const Kfloat &zNear, const Kfloat &zFar) {
 		assert((aspect > static_cast<Kfloat>(EPSILON_E6)) &&
 			((zFar - zNear) > static_cast<Kfloat>(EPSILON_E6)) &&
 			fovy > 0 && fovy < 180.0);
@@ -122,7 +122,7 @@ namespace KFunction{
 		return m;
 	}
 
-    Vec3 project(const Vec3 &v, const Mat4 &model, const Mat4 &proj, const Vec4 &viewport){
+    inline Vec3 project(const Vec3 &v, const Mat4 &model, const Mat4 &proj, const Vec4 &viewport){
         Vec4 pos = proj * (model * Vec4(v, static_cast<Kfloat>(1))); //裁剪坐标系
         pos /= pos.w; //转换到[-1, 1]
         pos /= static_cast<Kfloat>(2); //转换到[-0.5, 0.5]
@@ -134,7 +134,7 @@ namespace KFunction{
         return Vec3(pos.x, pos.y, pos.z);
     };
 
-    Vec3 unProject(const Vec3 &v, const Mat4 &model, const Mat4 &proj, const Vec4 &viewport){
+    inline Vec3 unProject(const Vec3 &v, const Mat4 &model, const Mat4 &proj, const Vec4 &viewport){
         Vec4 pos = Vec4(v, static_cast<Kfloat>(1));
         pos.x = (pos.x - viewport[0]) / viewport[2]; //转换到[0, 1]
         pos.y = (pos.y - viewport[1]) / viewport[3]; //转换到[0, 1]
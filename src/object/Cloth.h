@@ -10,235 +10,47 @@
 #include "../Header.h"
 #include "../math/Vec3.h"
 #include "../util/Material.h"
+#include "../physics/ClothSolver.h"
 #include "./Object3D.h"
 
 namespace KObject {
 	using tvec2 = KVector::Vec2;
 	using tvec3 = KVector::Vec3;
 
+	//Draws a KPhysics::ClothSolver, the simulation itself needs no GL.
 	class Cloth : public Object3D {
-	private:
-		class Spring {
-		private:
-			static const Kfloat ks;
-			static const Kfloat kd;
-			const Cloth* const parent;
-			Kuint vertex_index[2];
-			Kfloat rest_length;
-
-			tvec3 getVelcityDirection(Kuint index)const {
-				if (!isValid()) return tvec3();
-				if (index == vertex_index[0]) return parent->points->at(vertex_index[0])->getVelocity()
-					- parent->points->at(vertex_index[1])->getVelocity();
-				else if (index == vertex_index[1]) return parent->points->at(vertex_index[1])->getVelocity()
-					- parent->points->at(vertex_index[0])->getVelocity();
-				return tvec3();
-			}
-
-		public:
-			Spring(Kuint one, Kuint other, Kfloat rest, const Cloth* parent) :
-				parent(parent), rest_length(rest) {
-				vertex_index[0] = one;
-				vertex_index[1] = other;
-			}
-
-			Kfloat getCurrentLength()const {
-				if (parent->last_vertices == nullptr || vertex_index[0] >= parent->last_vertices->size() ||
-					vertex_index[1] >= parent->last_vertices->size()) return 0;
-				return KFunction::distance(parent->last_vertices->at(vertex_index[0]),
-					parent->last_vertices->at(vertex_index[1]));
-			}
-
-			Kfloat getRestLength()const {
-				return rest_length;
-			}
-
-			Kboolean isValid()const {
-				return !(parent == nullptr || parent->last_vertices == nullptr ||
-					vertex_index[0] >= parent->last_vertices->size() ||
-					vertex_index[1] >= parent->last_vertices->size());
-			}
-
-			tvec3 getDirection(Kuint index)const {
-				if (!isValid()) return tvec3();
-				if (index == vertex_index[0]) return parent->last_vertices->at(vertex_index[0])
-					- parent->last_vertices->at(vertex_index[1]);
-				else if (index == vertex_index[1]) return parent->last_vertices->at(vertex_index[1])
-					- parent->last_vertices->at(vertex_index[0]);
-				return tvec3();
-			}
-
-			tvec3 getForce(Kuint index)const {
-				Kfloat delta_length = getCurrentLength() - rest_length;
-				if (delta_length <= 0.f) return tvec3(0.f);
-				tvec3 dp(getDirection(index).normalize());
-				return -(ks * delta_length + kd * dp.dot(getVelcityDirection(index))) * dp;
-			}
-		};
-
-		class ClothPoint {
-		private:
-			Kuint index; //vertex index
-			const Cloth* const parent;
-
-			Kboolean is_constraint;
-			Kfloat mass;
-			tvec3 f_air;
-			tvec3 acceleration;
-			tvec3 velocity;
-			std::vector<const Spring*>* springs;
-
-			static const tvec3 f_wind;
-			static const tvec3 gravity;
-
-			void calAirForce() {
-				//f_air = tvec3(0.f); return;
-				static const Kfloat a_resistance = -0.0125f;
-				if(!velocity.isZero()) f_air = (a_resistance * velocity.dot(velocity)) * KFunction::normalize(velocity);
-				else f_air = tvec3(0.f);
-			}
-
-			void calAcceleration() {
-				calAirForce();
-				acceleration = mass * gravity + f_wind + f_air;
-				if (springs != nullptr) {
-					for (auto it : *springs) {
-						acceleration += it->getForce(index);
-					}
-				}
-				acceleration /= mass;
-			}
-
-		public:
-			ClothPoint(Kuint index, const Cloth* parent, Kboolean is_constraint = false):
-				index(index), parent(parent), is_constraint(is_constraint) {}
-			~ClothPoint() {
-				if (springs != nullptr) {
-					for (auto &it : *springs) {
-						delete it;
-						it = nullptr;
-					}
-					delete springs;
-				}
-			}
-
-			void setConstraint(Kboolean is_constraint = true) {
-				this->is_constraint = is_constraint;
-			}
-
-			void updateMass(Kfloat mass = 0.02f) {
-				this->mass = mass;
-			}
-
-			Kboolean isValid()const {
-				return !(parent == nullptr || parent->last_vertices == nullptr ||
-					parent->last_vertices->size() <= index);
-			}
-
-			tvec3 getMovement(Kfloat t) {
-				if (is_constraint) return tvec3(0.f);
-				calAcceleration();
-				if (isValid() && parent->last_vertices->at(index).y + parent->position.y <= 0) {
-					if (acceleration.y < 0) acceleration.y = 0;
-					if (velocity.y < 0)  velocity.y = 0;
-				}
-				tvec3 tmp(velocity);
-				velocity += acceleration * t;
-				return (tmp += velocity) *= (t / 2.0f);
-			}
-
-			void addSpring(const Spring* spring) {
-				if (spring == nullptr) return;
-				if (springs == nullptr) springs = new std::vector<const Spring*>();
-				springs->emplace_back(spring);
-			}
-
-			const tvec3& getVelocity()const {
-				return velocity;
-			}
-
-			const tvec3& getAcceleration()const {
-				return acceleration;
-			}
-		};
-
 	private:
 		Ksize size;
 		Ksize count;
 
-		std::vector<tvec3>* vertices; //It will be deleted in CLoth class
-		std::vector<tvec3>* last_vertices; //It will be deleted in CLoth class
-		std::vector<ClothPoint*>* points; //Every vectex has a point
-		
+		KPhysics::ClothSolver* solver;
+
+		//Positions before the last step, drawn with lbo to interpolate between steps.
+		//vbo and lbo stream: this points into lbo's mapped memory from the first step of
+		//a frame until interpolate, so the snapshot is written there directly.
+		tvec3* previous_positions;
+		KBuffer::VertexBuffer* lbo;
+
 		std::vector<tvec2>* texcoords;
-		std::vector<Kuint>* indices;
+		std::vector<Kuint>* indices; //kept for getIndices
 		std::vector<tvec3>* normals;
 
 		KMaterial::Material* material;
 
 		void generate() {
-			vertices = new std::vector<tvec3>();
-			vertices->reserve(size * size);	
-			last_vertices = new std::vector<tvec3>();
-			last_vertices->reserve(size * size);
-			points = new std::vector<ClothPoint*>();
-			points->reserve(size * size);
 			texcoords = new std::vector<tvec2>();
 			texcoords->reserve(size * size);
 			//normals = new std::vector<tvec3>();
 			//normals->reserve(size * size);
 
-			Kfloat rest_length = 1.f;
-			Kfloat diag_length = sqrt(2) * rest_length;
 			Kfloat pertex = 1.f / size;
-			//Kfloat y = 2.f + size * rest_length;
-			Kfloat y = size * rest_length / 2.f;
 			Kfloat ty = 0.f;
-			for (int i = 0; i < size; ++i, y -= rest_length, ty += pertex) {
-				Kfloat x = size * -rest_length / 2.f;
+			for (int i = 0; i < size; ++i, ty += pertex) {
 				Kfloat tx = 0.f;
-				for (int j = 0; j < size; ++j, x += rest_length, tx += pertex) {
-					//vertices->emplace_back(x, y, 0.f);
-					//last_vertices->emplace_back(x, y, 0.f);
-					vertices->emplace_back(x, size + 2, y);
-					last_vertices->emplace_back(x, size + 2, y);
+				for (int j = 0; j < size; ++j, tx += pertex) {
 					texcoords->emplace_back(tx, ty);
-					Kuint index = points->size(); //i * size + j
-					auto p = new ClothPoint(index, this);
-					if (i > 0) {
-						//if(j > 0) p->addSpring(
-						//	new Spring(index, index - size - 1, diag_length, this));
-						p->addSpring(
-							new Spring(index, index - size, rest_length, this));
-						//if (j < size - 1) p->addSpring(
-						//	new Spring(index, index - size + 1, diag_length, this));
-					}
-					if (j > 0) p->addSpring(
-						new Spring(index, index - 1, rest_length, this));
-					if (j < size - 1) p->addSpring(
-						new Spring(index, index + 1, rest_length, this));
-					if (i < size - 1) {
-						//if (j > 0) p->addSpring(
-						//	new Spring(index, index + size - 1, diag_length, this));
-						p->addSpring(
-							new Spring(index, index + size, rest_length, this));
-						//if (j < size - 1) p->addSpring(
-						//	new Spring(index, index + size + 1, diag_length, this));
-					}
-					if (j > 1) p->addSpring(
-						new Spring(index, index - 2, rest_length * 2, this));
-					if (j < size - 2) p->addSpring(
-						new Spring(index, index + 2, rest_length * 2, this));
-					if (i > 1) p->addSpring(
-						new Spring(index, index - size * 2, rest_length * 2, this));
-					if (i < size - 2) p->addSpring(
-						new Spring(index, index + size * 2, rest_length * 2, this));
-					points->emplace_back(p);
 				}
 			}
-			for (int i = 0; i < size; ++i) {
-				points->at(i)->setConstraint(true);
-			}
 
 			indices = new std::vector<Kuint>();
 //#define PRIMITIVE
@@ -274,11 +86,17 @@ namespace KObject {
 		}
 
 		void initArray() {
+			const KPhysics::Particles* particles = solver->getParticles();
 			vao = new KBuffer::VertexArray();
 
-			vbo = new KBuffer::VertexBuffer(vertices->size() * sizeof(tvec3), vertices->data());
+			vbo = new KBuffer::VertexBuffer(particles->size() * sizeof(tvec3), particles->getPositions(),
+				KBuffer::VERTEX, KBuffer::STREAM);
 			vao->allocate(vbo, A_POSITION, 3, GL_FLOAT);
 
+			lbo = new KBuffer::VertexBuffer(particles->size() * sizeof(tvec3), particles->getPositions(),
+				KBuffer::VERTEX, KBuffer::STREAM);
+			vao->allocate(lbo, A_LAST_POSITION, 3, GL_FLOAT);
+
 			tbo = new KBuffer::VertexBuffer(texcoords->size() * sizeof(tvec2), texcoords->data());
 			vao->allocate(tbo, A_TEXCOORD, 2, GL_FLOAT);
 
@@ -288,12 +106,20 @@ namespace KObject {
 			ibo = new KBuffer::VertexBuffer(count * sizeof(Ksize), indices->data(), KBuffer::INDEX);
 
 			delete texcoords; texcoords = nullptr;
-			delete indices; indices = nullptr;
+		}
+
+		//Copies the current positions into lbo, mapping it on the first step of a frame.
+		void snapshotPositions() {
+			const KPhysics::Particles* particles = solver->getParticles();
+			if (previous_positions == nullptr) previous_positions = static_cast<tvec3*>(lbo->beginWrite());
+			if (previous_positions != nullptr) {
+				memcpy(previous_positions, particles->getPositions(), particles->size() * sizeof(tvec3));
+			}
 		}
 
 	public:
-		Cloth(Ksize size = 30): Object3D("Cloth"), size(size),
-		vertices(nullptr), points(nullptr), texcoords(nullptr),
+		Cloth(Ksize size = 30, Kuint threads = 0): Object3D("Cloth"), size(size),
+		solver(nullptr), previous_positions(nullptr), lbo(nullptr), texcoords(nullptr),
 		normals(nullptr), indices(nullptr), material(nullptr) {
 			material = new KMaterial::Material();
 			material->ambient = KVector::Vec4(0.f, 0.67f, 0.56f, 1.f);
@@ -301,23 +127,19 @@ namespace KObject {
 			material->specular = KVector::Vec4(0.40f, 0.73f, 0.72f, 1.f);
 			material->shininess = 3.0;
 
+			solver = new KPhysics::ClothSolver(KPhysics::ClothParams(size), threads);
+
 			generate();
 			initArray();
 		}
 		~Cloth()override {
-			delete vertices;
-			delete last_vertices;
+			delete solver;
+			if (previous_positions != nullptr) lbo->endWrite();
+			delete lbo;
 			delete texcoords;
 			delete normals;
 			delete indices;
 			delete material;
-			if (points != nullptr) {
-				for (auto &it : *points) {
-					delete it;
-					it = nullptr;
-				}
-				delete points;
-			}
 		}
 
 		void bindUniform(const KShader::Shader* shader)const override {
@@ -325,24 +147,94 @@ namespace KObject {
 			material->bindUniform(shader);
 		}
 
+		KPhysics::ClothSolver* getSolver() {
+			return solver;
+		}
+
+		//0 means one thread per hardware thread.
+		void setThreadCount(Kuint count) {
+			solver->setThreadCount(count);
+		}
+
+		Kuint getThreadCount()const {
+			return solver->getThreadCount();
+		}
+
+		//SCALAR or SIMD spring forces, to compare both on the same cloth.
+		void setSpringBackend(KPhysics::SpringBackend backend) {
+			solver->setSpringBackend(backend);
+		}
+
+		//Stiff springs (ks around 1e4) need IMPLICIT_EULER to stay stable at one step per frame.
+		void setIntegrator(KPhysics::Integrator integrator) {
+			solver->setIntegrator(integrator);
+		}
+
+		KPhysics::Integrator getIntegrator()const {
+			return solver->getIntegrator();
+		}
+
+		void setSpringStiffness(KPhysics::SpringType type, Kfloat ks, Kfloat kd) {
+			solver->setSpringStiffness(type, ks, kd);
+		}
+
+		KPhysics::XPBDSolver* getXPBDSolver() {
+			return solver->getXPBDSolver();
+		}
+
+		KPhysics::ProjectiveSolver* getProjectiveSolver() {
+			return solver->getProjectiveSolver();
+		}
+
+		void setDeterministic(Kboolean deterministic = true) {
+			solver->setDeterministic(deterministic);
+		}
+
+		//One step, call interpolate once the frame's steps are done to upload them.
 		void updatePosition(Kfloat delta_time) {
 			if (KFunction::isZero(delta_time)) return;
-			for (Ksize i = 0; i < size * size; ++i) {
-				last_vertices->at(i) = vertices->at(i);
-			}
-			for (Ksize i = 0; i < size * size; ++i) {
-				points->at(i)->updateMass();
-				vertices->at(i) += points->at(i)->getMovement(delta_time);
-				if (vertices->at(i).y < 0) vertices->at(i).y = 0.00072;
-			}
-			vbo->allocate(0, vertices->size() * sizeof(tvec3), vertices->data());
-			if (!isnan(vertices->at(size).y)) std::cout << vertices->at(size) << "\t"
-				<< points->at(size)->getVelocity() << "\t"
-				<< points->at(size)->getAcceleration() << "\n"
-				<< vertices->at(size + 1) << "\t"
-				<< points->at(size + 1)->getVelocity() << "\t"
-				<< points->at(size + 1)->getAcceleration() << "\n"
-				<< std::endl;
+			snapshotPositions();
+			solver->setGround(-position.y);
+			solver->step(delta_time);
+		}
+
+		//A step from a cache instead of the solver: the particles take positions and,
+		//when there are any, velocities. Call interpolate after it the same way.
+		void loadFrame(const tvec3* positions, const tvec3* velocities = nullptr) {
+			snapshotPositions();
+			KPhysics::Particles* particles = solver->getParticles();
+			memcpy(particles->getPositions(), positions, particles->size() * sizeof(tvec3));
+			if (velocities != nullptr) memcpy(particles->getVelocities(), velocities, particles->size() * sizeof(tvec3));
+		}
+
+		//The solver from a checkpoint, drawn from the next interpolate on without
+		//interpolating from before.
+		Kboolean loadState(const KCache::Checkpoint& checkpoint) {
+			if (!solver->loadState(checkpoint)) return false;
+			snapshotPositions();
+			return true;
+		}
+
+		//Triangle strip of the grid, kept for the topology of cache files.
+		const std::vector<Kuint>* getIndices()const {
+			return indices;
+		}
+
+		//Upload the last two states, alpha from SimulationClock says where to draw between them.
+		//Nothing is uploaded on frames without a step.
+		void interpolate(Kfloat alpha) {
+			setLag(1.f - alpha);
+			if (previous_positions == nullptr) return;
+			lbo->endWrite();
+			previous_positions = nullptr;
+			vao->allocate(lbo, A_LAST_POSITION, 3, GL_FLOAT, false, 0, lbo->getOffset());
+
+			const KPhysics::Particles* particles = solver->getParticles();
+			void* positions = vbo->beginWrite();
+			if (positions == nullptr) return;
+			memcpy(positions, particles->getPositions(), particles->size() * sizeof(tvec3));
+			vbo->endWrite();
+			vao->allocate(vbo, A_POSITION, 3, GL_FLOAT, false, 0, vbo->getOffset());
 		}
 
 		void render()const override {
@@ -364,27 +256,24 @@ namespace KObject {
 
 #ifdef IMGUI_ENABLE
 		void drawGui() {
+			const tvec3* v = solver->getParticles()->getVelocities();
+			const tvec3* a = solver->getParticles()->getAccelerations();
 			Kuint index = size;
-			tvec3 t = points->at(index)->getVelocity();
+			tvec3 t = v[index];
 			ImGui::Text("Vel of p%d: %.2f, %.2f, %.2f", index, t.x, t.y, t.z);
 			index = size * 2 - 1;
-			t = points->at(index)->getVelocity();
+			t = v[index];
 			ImGui::Text("Vel of p%d: %.2f, %.2f, %.2f", index, t.x, t.y, t.z);
 
 			index = size;
-			t = points->at(index)->getAcceleration();
+			t = a[index];
 			ImGui::Text("Acc of p%d: %.2f, %.2f, %.2f", index, t.x, t.y, t.z);
 			index = size * 2 - 1;
-			t = points->at(index)->getAcceleration();
+			t = a[index];
 			ImGui::Text("Acc of p%d: %.2f, %.2f, %.2f", index, t.x, t.y, t.z);
 		}
 #endif
 	};
-
-	const Kfloat Cloth::Spring::ks = 15.f;
-	const Kfloat Cloth::Spring::kd = 0.9f;
-	const tvec3 Cloth::ClothPoint::gravity(0.0f, -9.8f, 0.0f);
-	const tvec3 Cloth::ClothPoint::f_wind(0.0f, 0.0f, 0.0f);
 }
 
 #endif // CLOTH_H
@@ -9,7 +9,9 @@
 #include "./Object3D.h"
 #include "../util/Material.h"
 #include "../render/BackBuffer.h"
+#include "../render/UniformBuffer.h"
 #include "../render/TextureBuffer.h"
+#include "../physics/EulerSolver.h"
 
 namespace KObject {
 	using tvec2 = KVector::Vec2;
@@ -19,28 +21,42 @@ namespace KObject {
 	//Use GPU and Euler mathod
 	class EulerCloth : public Object3D {
 	private:
-		const Kfloat length = 9.6f;
+		static const Kuint WORK_GROUP; //TILE of euler.comp
+
+		//std140 layout of the EulerParams block in euler.vert and euler.comp
+		struct ParamsBlock {
+			Kfloat f_wind[3];
+			Kint size;
+			Kfloat position[3]; //u_position
+			Kfloat mass;
+			Kfloat a_resistance;
+			Kfloat ks;
+			Kfloat kd;
+			Kfloat ks_bend;
+			Kfloat kd_bend;
+			Kfloat rest_length;
+			Kfloat diag_length;
+			Kfloat delta_time;
+		};
+
 		Ksize size;
 		Ksize count;
 
-		const Kfloat a_resistance = -0.0125f;
-		const tvec3 f_wind = tvec3(0.f);
-		
-		const Kfloat mass = 0.1f;
-		const Kfloat ks = 15.f;
-		const Kfloat kd = 0.96f;
-		const Kfloat ks_bend = 0.036f;
-		const Kfloat kd_bend = 0.96f;
-
-		const Kfloat delta_time = 1.f / 60.f;
-
-		Kfloat rest_length; //length / size
-		Kfloat diag_length; //rest_length * sqrt(2)
+		//shared with EulerSolverCPU so both run the same cloth
+		KPhysics::EulerParams params;
+		KBuffer::UniformBuffer* params_ubo;
+		tvec3 params_position; //position when they were uploaded, the shaders collide in it
 
 		KBuffer::BackBuffer* back_buffer;
 		KBuffer::TextureBuffer* constraints_sampler;
-		KBuffer::TextureBuffer* vertices_sampler;
-		KBuffer::TextureBuffer* velocities_sampler;
+		std::vector<Kubyte>* constraints; //kept for checkpoints
+		//Two states that swap every step: the shader reads [current] and transform
+		//feedback writes the other one, the vao draws [current] so nothing is copied.
+		KBuffer::TextureBuffer* vertices_samplers[2];
+		KBuffer::TextureBuffer* velocities_samplers[2];
+		Kuint current;
+		//euler.comp on the same buffers (bound as storage) instead of transform feedback
+		Kboolean compute;
 
 		std::vector<tvec3>* vertices; //It will be deleted in CLoth class
 		std::vector<tvec2>* texcoords;
@@ -51,41 +67,38 @@ namespace KObject {
 
 		void generate() {
 			vertices = new std::vector<tvec3>();
-			vertices->reserve(size * size);
+			KPhysics::EulerSolverCPU::generateVertices(params, vertices);
 			texcoords = new std::vector<tvec2>();
 			texcoords->reserve(size * size);
 			//normals = new std::vector<tvec3>();
 			//normals->reserve(size * size);
 
-			rest_length = length / size;
-			diag_length = rest_length * sqrt(2);
 			Kfloat pertex = 1.f / size;
-			//Kfloat y = length;
-			Kfloat y = length / 2.f;
 			Kfloat ty = 0.f;
-			for (int i = 0; i < size; ++i, y -= rest_length, ty += pertex) {
-				Kfloat x = -length / 2.f;
+			for (int i = 0; i < size; ++i, ty += pertex) {
 				Kfloat tx = 0.f;
-				for (int j = 0; j < size; ++j, x += rest_length, tx += pertex) {
-					//vertices->emplace_back(x, y, 0.f);
-					vertices->emplace_back(x, length, y);
+				for (int j = 0; j < size; ++j, tx += pertex) {
 					texcoords->emplace_back(tx, ty);
 				}
 			}
 			
-			vertices_sampler = new KBuffer::TextureBuffer(vertices->size() * sizeof(tvec3),
-				vertices->data());
-			velocities_sampler = new KBuffer::TextureBuffer(vertices->size() * sizeof(tvec3));
+			std::vector<tvec3> velocities(vertices->size(), tvec3(0.f));
+			for (int i = 0; i < 2; ++i) {
+				vertices_samplers[i] = new KBuffer::TextureBuffer(vertices->size() * sizeof(tvec3),
+					vertices->data());
+				velocities_samplers[i] = new KBuffer::TextureBuffer(velocities.size() * sizeof(tvec3),
+					velocities.data());
+			}
 
-			auto constraints = new Kubyte[size * size];
-			memset(constraints, 0, size * size * sizeof(Kubyte));
+			//whole texels (and uints for euler.comp)
+			constraints = new std::vector<Kubyte>((size * size + 3) / 4 * 4, 0);
 			for (int i = 0; i < size; ++i) {
-				constraints[i] = true;
+				(*constraints)[i] = true;
 			}
-			constraints[0] = true;
-			constraints[size - 1] = true;
-			constraints_sampler = new KBuffer::TextureBuffer(size * size * sizeof(Kubyte), constraints, GL_RGBA8UI);
-			delete constraints;
+			(*constraints)[0] = true;
+			(*constraints)[size - 1] = true;
+			constraints_sampler = new KBuffer::TextureBuffer(constraints->size() * sizeof(Kubyte),
+				constraints->data(), GL_RGBA8UI);
 
 			indices = new std::vector<Kuint>();
 //#define PRIMITIVE
@@ -121,12 +134,18 @@ namespace KObject {
 #endif
 		}
 
+		//The other state still holds the positions the last step started from,
+		//so drawing between the two needs no extra buffer either.
+		void bindState() {
+			vao->allocate(vertices_samplers[current], A_POSITION, 3, GL_FLOAT, false, sizeof(tvec3));
+			vao->allocate(vertices_samplers[1 - current], A_LAST_POSITION, 3, GL_FLOAT, false, sizeof(tvec3));
+		}
+
 		void initArray() {
 			vao = new KBuffer::VertexArray();
 
-			vbo = new KBuffer::VertexBuffer(vertices->size() * sizeof(tvec3));
-			//we will add data by transform feed back
-			vao->allocate(vbo, A_POSITION, 3, GL_FLOAT, false, sizeof(tvec3));
+			//positions come from the current state, see bindState
+			bindState();
 
 			tbo = new KBuffer::VertexBuffer(texcoords->size() * sizeof(tvec2), texcoords->data());
 			vao->allocate(tbo, A_TEXCOORD, 2, GL_FLOAT);
@@ -140,12 +159,33 @@ namespace KObject {
 			delete indices; indices = nullptr;
 		}
 
+		void uploadParams() {
+			ParamsBlock block;
+			for (Kuint i = 0; i < 3; ++i) {
+				block.f_wind[i] = params.f_wind[i];
+				block.position[i] = position[i];
+			}
+			block.size = size;
+			block.mass = params.mass;
+			block.a_resistance = params.a_resistance;
+			block.ks = params.ks;
+			block.kd = params.kd;
+			block.ks_bend = params.ks_bend;
+			block.kd_bend = params.kd_bend;
+			block.rest_length = params.rest_length;
+			block.diag_length = params.diag_length;
+			block.delta_time = params.delta_time;
+			params_ubo->allocate(&block);
+			params_position = position;
+		}
+
 	public:
-		EulerCloth(Ksize size = 30): Object3D("Cloth"), size(size),
-			back_buffer(nullptr), vertices_sampler(nullptr),
-			constraints_sampler(nullptr), velocities_sampler(nullptr),
-			vertices(nullptr), texcoords(nullptr), normals(nullptr),
-			indices(nullptr), material(nullptr) {
+		EulerCloth(Ksize size = 30): Object3D("Cloth"), size(size), params(size), params_ubo(nullptr),
+			back_buffer(nullptr), constraints_sampler(nullptr), constraints(nullptr),
+			vertices_samplers{ nullptr, nullptr }, velocities_samplers{ nullptr, nullptr }, current(0),
+			compute(false), vertices(nullptr), texcoords(nullptr), indices(nullptr),
+			normals(nullptr), material(nullptr) {
+			params_ubo = new KBuffer::UniformBuffer(sizeof(ParamsBlock), KBuffer::SOLVER_BLOCK);
 			material = new KMaterial::Material();
 			material->ambient = tvec4(0.f, 0.67f, 0.56f, 1.f);
 			material->diffuse = tvec4(0.41f, 0.69f, 0.67f, 1.f);
@@ -163,9 +203,13 @@ namespace KObject {
 			delete material;
 
 			delete back_buffer;
+			delete params_ubo;
 			delete constraints_sampler;
-			delete vertices_sampler;
-			delete velocities_sampler;
+			delete constraints;
+			for (int i = 0; i < 2; ++i) {
+				delete vertices_samplers[i];
+				delete velocities_samplers[i];
+			}
 		}
 
 		void bindUniform(const KShader::Shader* shader)const override {
@@ -174,47 +218,67 @@ namespace KObject {
 		}
 
 		void initBackBuffer(const KShader::Shader* back_shader) {
+			//outputs go straight into the state buffers, the back buffer keeps none of its own
 			back_buffer = new KBuffer::BackBuffer(back_shader,
 			{
 				"o_vertex",
 				"o_velocity"
 			},
-			{
-				size * size * sizeof(tvec3),
-				size * size * sizeof(tvec3)
-			},
+			{ 0, 0 },
 			GL_SEPARATE_ATTRIBS);
-
-			//vbo->bindToBackBuffer(0, back_buffer);
-			//vertices_sampler->bindToBackBuffer(0, back_buffer);
-			//velocities_sampler->bindToBackBuffer(1, back_buffer);
 		}
 
-		void bindBackUniform(const KShader::Shader* back_shader)const {
-			back_shader->bindUniform1i("size", size);
-
-			back_shader->bindUniform1f("mass", mass);
-			back_shader->bindUniform1f("a_resistance", a_resistance);
-			back_shader->bindUniform3f("f_wind", f_wind);
-			
-			back_shader->bindUniform1f("ks", ks);
-			back_shader->bindUniform1f("kd", kd);
-			back_shader->bindUniform1f("ks_bend", ks_bend);
-			back_shader->bindUniform1f("kd_bend", kd_bend);
-			back_shader->bindUniform1f("delta_time", delta_time);
+		//Instead of initBackBuffer, back_shader is euler.comp then.
+		void initCompute() {
+			delete back_buffer;
+			back_buffer = nullptr;
+			compute = true;
+		}
 
-			back_shader->bindUniform1f("rest_length", rest_length);
-			back_shader->bindUniform1f("diag_length", diag_length);
+		Kboolean isCompute()const {
+			return compute;
+		}
 
-			back_shader->bindUniform3f("u_position", position);
+		//Once after the back buffer (or compute) is set up.
+		void bindBackUniform(const KShader::Shader* back_shader) {
+			uploadParams();
+			back_shader->bindUniformBlock("EulerParams", KBuffer::SOLVER_BLOCK);
+			params_ubo->bind();
 
+			if (compute) return;
 			constraints_sampler->bind(back_shader, "constraints_tbo", 0);
-			vertices_sampler->bind(back_shader, "vertices_tbo", 1);
-			velocities_sampler->bind(back_shader, "velocities_tbo", 2);
+			vertices_samplers[current]->bind(back_shader, "vertices_tbo", 1);
+			velocities_samplers[current]->bind(back_shader, "velocities_tbo", 2);
 		}
 
-		void renderBack()const {
-			//remember to bind uniform and delta time before.
+		//One step of delta_time, SimulationClock decides how many run per frame.
+		void renderBack() {
+			//remember to bind uniform before.
+			if (params_position != position) uploadParams();
+			params_ubo->bind();
+			const Kuint next = 1 - current;
+			if (compute) {
+				constraints_sampler->bindToStorage(0);
+				vertices_samplers[current]->bindToStorage(1);
+				velocities_samplers[current]->bindToStorage(2);
+				vertices_samplers[next]->bindToStorage(3);
+				velocities_samplers[next]->bindToStorage(4);
+
+				glDispatchCompute((size + WORK_GROUP - 1) / WORK_GROUP, (size + WORK_GROUP - 1) / WORK_GROUP, 1);
+				//next step reads it as storage, drawing as vertex attributes, readbacks as copies
+				glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT |
+					GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+				current = next;
+				bindState();
+				return;
+			}
+
+			vertices_samplers[current]->bind(1);
+			velocities_samplers[current]->bind(2);
+			vertices_samplers[next]->bindToBackBuffer(0, back_buffer);
+			velocities_samplers[next]->bindToBackBuffer(1, back_buffer);
+
 			glEnable(GL_RASTERIZER_DISCARD);
 			back_buffer->enable();
 
@@ -223,12 +287,74 @@ namespace KObject {
 			back_buffer->disable();
 			glDisable(GL_RASTERIZER_DISCARD);
 
-			vbo->copyDataFormBuffer(0, back_buffer);
-			vertices_sampler->copyDataFromBuffer(0, back_buffer);
-			velocities_sampler->copyDataFromBuffer(1, back_buffer);
+			current = next;
+			bindState();
+		}
+
+		//alpha from SimulationClock, 1 draws the last step as it is.
+		void interpolate(Kfloat alpha) {
+			setLag(1.f - alpha);
+		}
+
+		//Positions of the current state (local space), tvec3 per vertex.
+		std::uint64_t requestPositions(KBuffer::ReadbackRing* ring)const {
+			return vertices_samplers[current]->requestData(ring, size * size * sizeof(tvec3));
+		}
+
+		//The state before the last step, drawn as the last positions.
+		std::uint64_t requestLastPositions(KBuffer::ReadbackRing* ring)const {
+			return vertices_samplers[1 - current]->requestData(ring, size * size * sizeof(tvec3));
+		}
+
+		std::uint64_t requestVelocities(KBuffer::ReadbackRing* ring)const {
+			return velocities_samplers[current]->requestData(ring, size * size * sizeof(tvec3));
+		}
+
+		//The three arrays from requestPositions, requestLastPositions and requestVelocities
+		//of one step. It restores into EulerSolverCPU as well.
+		void saveState(KCache::Checkpoint* checkpoint, const tvec3* positions,
+			const tvec3* last_positions, const tvec3* velocities)const {
+			const Ksize n = size * size;
+			std::vector<Kuint> pinned((n + 31) / 32, 0);
+			for (Ksize i = 0; i < n; ++i) {
+				if ((*constraints)[i]) pinned[i >> 5] |= 1u << (i & 31);
+			}
+			checkpoint->put(KCache::PARAMS, &params, 1);
+			checkpoint->put(KCache::POSITIONS, positions, n);
+			checkpoint->put(KCache::LAST_POSITIONS, last_positions, n);
+			checkpoint->put(KCache::VELOCITIES, velocities, n);
+			checkpoint->put(KCache::PINNED, pinned.data(), pinned.size());
+		}
+
+		//From this cloth or EulerSolverCPU, before bindBackUniform (it uploads the params).
+		Kboolean loadState(const KCache::Checkpoint& checkpoint) {
+			if (!checkpoint.matches(KCache::EULER_SOLVER, size, size)) return false;
+			const Ksize n = size * size;
+			KPhysics::EulerParams loaded;
+			std::vector<tvec3> positions(n), last_positions(n), velocities(n, tvec3(0.f));
+			if (!checkpoint.get(KCache::PARAMS, &loaded, 1) ||
+				!checkpoint.get(KCache::POSITIONS, positions.data(), n) ||
+				!checkpoint.get(KCache::LAST_POSITIONS, last_positions.data(), n)) {
+				std::cerr << "Checkpoint has no params or positions" << std::endl;
+				return false;
+			}
+			checkpoint.get(KCache::VELOCITIES, velocities.data(), n);
+			std::vector<Kuint> pinned((n + 31) / 32, 0);
+			if (checkpoint.get(KCache::PINNED, pinned.data(), pinned.size())) {
+				for (Ksize i = 0; i < n; ++i) (*constraints)[i] = (pinned[i >> 5] >> (i & 31)) & 1u;
+				constraints_sampler->allocate(0, constraints->size() * sizeof(Kubyte), constraints->data());
+			}
 
-			//const tvec3* data0 = back_buffer->getData<tvec3>(0);
-			//const tvec3* data1 = back_buffer->getData<tvec3>(1);
+			const Kuint bytes = n * sizeof(tvec3);
+			vertices_samplers[current]->allocate(0, bytes, positions.data());
+			vertices_samplers[1 - current]->allocate(0, bytes, last_positions.data());
+			for (int i = 0; i < 2; ++i) velocities_samplers[i]->allocate(0, bytes, velocities.data());
+			params = loaded;
+			return true;
+		}
+
+		const KPhysics::EulerParams& getParams()const {
+			return params;
 		}
 
 		void render()const override {
@@ -248,6 +374,8 @@ namespace KObject {
 			unBind();
 		}
 	};
+
+	const Kuint EulerCloth::WORK_GROUP = 16;
 }
 
 #endif // !EULER_CLOTH_H
@@ -14,9 +14,23 @@
 #include "../render/Shader.h"
 #include "../render/VertexArray.h"
 #include "../render/VertexBuffer.h"
+#include "../render/UniformBuffer.h"
 
 namespace KObject {
 	class Object3D {
+	private:
+		//std140 layout of the Object block in phong.vert (row_major)
+		struct ObjectBlock {
+			Kfloat rotation[12]; //u_mRotate, rows padded to vec4
+			Kfloat position[3]; //u_mPos
+			Kfloat lag; //u_lag
+			Kfloat scale[3]; //u_mScale
+			Kfloat padding;
+		};
+
+		mutable KBuffer::UniformBuffer* ubo; //made on the first bind
+		mutable Kboolean dirty; //transform or lag changed since the last upload
+
 	protected :
 		KVector::Vec3 position;
 		KMatrix::Quaternion rotation;
@@ -29,21 +43,30 @@ namespace KObject {
 		KBuffer::VertexBuffer* tbo;
 		KBuffer::VertexBuffer* nbo;
 
+		Kfloat lag; //draw between the last and the current position, for the objects that have both, see setLag
+
 		std::string type;
 
-		const static std::string U_POSITION;
-		const static std::string U_ROTATION;
-		const static std::string U_SCALE;
+	public:
+		const static std::string U_BLOCK; //Object: u_mRotate, u_mPos, u_lag, u_mScale
 
+	protected:
 		const static Kint A_POSITION; // = 1;
 		const static Kint A_NORMAL; // = 2;
 		const static Kint A_TEXCOORD; // = 3;
+		const static Kint A_LAST_POSITION; // = 4;
 
 	protected:
 		Object3D(std::string type, const KVector::Vec3& pos = KVector::Vec3()) :
-			type(type), vao(nullptr), ibo(nullptr), position(pos),
-			rotation(KMatrix::Quaternion()), m_scale(KVector::Vec3(1.0f)),
-			vbo(nullptr), tbo(nullptr), nbo(nullptr) {}
+			ubo(nullptr), dirty(true), position(pos),
+			rotation(KMatrix::Quaternion()), m_scale(KVector::Vec3(1.0f)), vao(nullptr), ibo(nullptr),
+			vbo(nullptr), tbo(nullptr), nbo(nullptr), lag(0.f), type(type) {}
+
+		void setLag(Kfloat lag) {
+			if (this->lag == lag) return;
+			this->lag = lag;
+			dirty = true;
+		}
 
 	public:
 		virtual ~Object3D() {
@@ -53,6 +76,7 @@ namespace KObject {
 			delete vbo;
 			delete tbo;
 			delete nbo;
+			delete ubo;
 		}
 
 		const std::string& getType()const {
@@ -77,44 +101,68 @@ namespace KObject {
 
 		void setPosition(const KVector::Vec3& v) {
 			position = v;
+			dirty = true;
 		}
 
 		void setRotation(Kfloat angle, const KVector::Vec3& v) {
 			rotation = KMatrix::Quaternion(angle, v);
+			dirty = true;
 		}
 
 		void setScale(const KVector::Vec3& v) {
 			m_scale = v;
+			dirty = true;
 		}
 
 		void translate(const KVector::Vec3& v) {
 			position += v;
+			dirty = true;
 		}
 
 		void rotate(Kfloat angle, const KVector::Vec3& v) {
 			rotation *= KMatrix::Quaternion(angle, v);
+			dirty = true;
 		}
 
 		void scale(const KVector::Vec3 &v) {
 			m_scale *= v;
+			dirty = true;
 		}
 
+		//The Object block, uploaded only after a change. The shader needs
+		//bindUniformBlock(U_BLOCK, OBJECT_BLOCK) once.
 		virtual void bindUniform(const KShader::Shader* shader)const {
-			shader->bindUniform3f(U_POSITION, position);
-			shader->bindUniformMat3(U_ROTATION, rotation.toMat3());
-			shader->bindUniform3f(U_SCALE, m_scale);
+			if (ubo == nullptr) ubo = new KBuffer::UniformBuffer(sizeof(ObjectBlock), KBuffer::OBJECT_BLOCK);
+			if (dirty) {
+				ObjectBlock block;
+				const KMatrix::Mat3 m(rotation.toMat3());
+				for (Kuint i = 0; i < 3; ++i) {
+					block.rotation[i * 4] = m[i].x;
+					block.rotation[i * 4 + 1] = m[i].y;
+					block.rotation[i * 4 + 2] = m[i].z;
+					block.rotation[i * 4 + 3] = 0.f;
+					block.position[i] = position[i];
+					block.scale[i] = m_scale[i];
+				}
+				block.lag = lag;
+				block.padding = 0.f;
+				ubo->allocate(&block);
+				dirty = false;
+			}
+			ubo->bind();
 		}
 
+		//The whole block goes at once now.
 		void bindPosition(const KShader::Shader* shader)const {
-			shader->bindUniform3f(U_POSITION, position);
+			Object3D::bindUniform(shader);
 		}
 
 		void bindRotation(const KShader::Shader* shader)const {
-			shader->bindUniformMat3(U_ROTATION, rotation.toMat3());
+			Object3D::bindUniform(shader);
 		}
 
 		void bindScale(const KShader::Shader* shader)const {
-			shader->bindUniform3f(U_SCALE, m_scale);
+			Object3D::bindUniform(shader);
 		}
 
 		const KVector::Vec3& getPosition()const {
@@ -129,20 +177,19 @@ namespace KObject {
 			//Be sure to use it between ImGui::Begin() and ImGui::End();
 			//Maybe the function will be private in the future.
 			//Remember to rebind the value when you want to change the value in OpenGL.
-			ImGui::SliderFloat3("position", &position[0], -10, 10);
-			ImGui::SliderFloat3("scale", &m_scale[0], -10, 10);
+			if (ImGui::SliderFloat3("position", &position[0], -10, 10)) dirty = true;
+			if (ImGui::SliderFloat3("scale", &m_scale[0], -10, 10)) dirty = true;
 		}
 #endif // IMGUI_ENABLE
 
 	};
 
-	const std::string Object3D::U_POSITION("u_mPos");
-	const std::string Object3D::U_ROTATION("u_mRotate");
-	const std::string Object3D::U_SCALE("u_mScale");
+	const std::string Object3D::U_BLOCK("Object");
 
 	const Kint Object3D::A_POSITION = 1;
 	const Kint Object3D::A_NORMAL = 2;
 	const Kint Object3D::A_TEXCOORD = 3;
+	const Kint Object3D::A_LAST_POSITION = 4;
 }
 
 #endif //OBJECT3D_H
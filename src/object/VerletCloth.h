@@ -10,6 +10,8 @@
 #include "../util/Material.h"
 #include "../render/BackBuffer.h"
 #include "../render/TextureBuffer.h"
+#include "../render/UniformBuffer.h"
+#include "../physics/VerletSolver.h"
 
 namespace KObject {
 	using tvec2 = KVector::Vec2;
@@ -19,48 +21,64 @@ namespace KObject {
 	//Use GPU and Verlet mathod
 	class VerletCloth : public Object3D {
 	private:
-		const tvec2 length = tvec2(10.f);
+		static const Kuint WORK_GROUP; //TILE of verlet.comp
+
+		//std140 layout of the VerletParams block in verlet.vert and verlet.comp
+		struct ParamsBlock {
+			Kint size[2];
+			Kfloat rest_length[2];
+			Kfloat gravity[3];
+			Kfloat diag_length;
+			Kfloat f_wind[3];
+			Kfloat mass;
+			Kfloat position[3]; //u_position
+			Kfloat a_resistance;
+			Kfloat delta_time; //of one substep
+			Kfloat ks;
+			Kfloat kd;
+			Kfloat ks_bend;
+			Kfloat kd_bend;
+			Kfloat padding[3];
+		};
+
 		Ksize size_x, size_y;
 		Ksize count;
 
-		const Kfloat a_resistance = -0.0125f;
-		const tvec3 f_wind = tvec3(0.f, 0.0f, -0.0f);
-
-		tvec3 gravity = tvec3(0.f, -0.0098f, 0.f);
-		const Kfloat mass = 0.1f;
-		Kfloat ks = 200.f;
-		const Kfloat kd = 0.60f;
-		Kfloat ks_bend = 9.6f;
-		const Kfloat kd_bend = 0.24f;
-
-		Kfloat delta_time = 1.f / 60.f;
-
-		tvec2 rest_length = tvec2(1.f); //length / size
-		Kfloat diag_length = rest_length.length(); //rest_length.length()
+		//shared with VerletSolverCPU so both run the same cloth
+		KPhysics::VerletParams params;
+		KBuffer::UniformBuffer* params_ubo;
+		Kboolean params_dirty; //params changed since the last upload
+		tvec3 params_position; //position when they were uploaded, the shaders collide in it
 
 		KBuffer::BackBuffer* back_buffer;
 		KBuffer::TextureBuffer* constraints_sampler;
-		KBuffer::TextureBuffer* vertices_sampler;
-		KBuffer::TextureBuffer* last_vertices_sampler;
+		std::vector<Kubyte>* constraints; //kept for checkpoints
+		//Two states that swap every step: the shader reads [current] and transform
+		//feedback writes the other one, the vao draws [current] so nothing is copied.
+		KBuffer::TextureBuffer* vertices_samplers[2];
+		KBuffer::TextureBuffer* last_vertices_samplers[2];
+		Kuint current;
+		//Where the step started, the substeps overwrite both states above.
+		//Only made and drawn when params.substeps > 1.
+		KBuffer::TextureBuffer* start_vertices_sampler;
+		//verlet.comp on the same buffers (bound as storage) instead of transform feedback
+		Kboolean compute;
 
 		std::vector<tvec3>* vertices; //It will be deleted in CLoth class
 		std::vector<tvec2>* texcoords;
-		std::vector<Kuint>* indices;
+		std::vector<Kuint>* indices; //kept for getIndices
 		std::vector<tvec3>* normals;
 
 		KMaterial::Material* material;
 
 		void generate() {
 			vertices = new std::vector<tvec3>();
-			vertices->reserve(size_x * size_y);
+			KPhysics::VerletSolverCPU::generateVertices(params, vertices);
 			texcoords = new std::vector<tvec2>();
 			texcoords->reserve(size_x * size_y);
 			//normals = new std::vector<tvec3>();
 			//normals->reserve(size_x * size_y);
 
-			rest_length = length / tvec2(size_x - 1, size_y - 1);
-			diag_length = rest_length.length();
-
 			//Kfloat mt = (rest_length.x + rest_length.y) / 20.f;
 			//Kfloat mt = (length.x * length.y) / (size_x * size_y);
 			//gravity.y *= mt;
@@ -70,33 +88,30 @@ namespace KObject {
 
 			Kfloat pertex_x = 1.f / (size_x - 1);
 			Kfloat pertex_y = 1.f / (size_y - 1);
-			//Kfloat y = length.y;
-			Kfloat y = length.y / 2.f;
 			Kfloat ty = 0.f;
-			for (int i = 0; i < size_y; ++i, y -= rest_length.y, ty += pertex_y) {
-				Kfloat x = length.x / -2.f;
+			for (int i = 0; i < size_y; ++i, ty += pertex_y) {
 				Kfloat tx = 0.f;
-				for (int j = 0; j < size_x; ++j, x += rest_length.x, tx += pertex_x) {
-					//vertices->emplace_back(x, y, 0.f);
-					vertices->emplace_back(x, length.y, y);
+				for (int j = 0; j < size_x; ++j, tx += pertex_x) {
 					texcoords->emplace_back(tx, ty);
 				}
 			}
 
-			vertices_sampler = new KBuffer::TextureBuffer(vertices->size() * sizeof(tvec3),
-				vertices->data());
-			last_vertices_sampler = new KBuffer::TextureBuffer(vertices->size() * sizeof(tvec3),
-				vertices->data());
+			for (int i = 0; i < 2; ++i) {
+				vertices_samplers[i] = new KBuffer::TextureBuffer(vertices->size() * sizeof(tvec3),
+					vertices->data());
+				last_vertices_samplers[i] = new KBuffer::TextureBuffer(vertices->size() * sizeof(tvec3),
+					vertices->data());
+			}
 
-			auto constraints = new Kubyte[size_x * size_y];
-			memset(constraints, 0, size_x * size_y * sizeof(Kubyte));
+			//whole texels (and uints for verlet.comp)
+			constraints = new std::vector<Kubyte>((size_x * size_y + 3) / 4 * 4, 0);
 			//for (int i = 0; i < size_x; ++i) {
-			//	constraints[i] = true;
+			//	(*constraints)[i] = true;
 			//}
-			constraints[0] = true;
-			constraints[size_x - 1] = true;
-			constraints_sampler = new KBuffer::TextureBuffer(size_x * size_y * sizeof(Kubyte), constraints, GL_RGBA8UI);
-			delete constraints;
+			(*constraints)[0] = true;
+			(*constraints)[size_x - 1] = true;
+			constraints_sampler = new KBuffer::TextureBuffer(constraints->size() * sizeof(Kubyte),
+				constraints->data(), GL_RGBA8UI);
 
 			indices = new std::vector<Kuint>();
 //#define PRIMITIVE
@@ -129,12 +144,19 @@ namespace KObject {
 #endif
 		}
 
+		//With one pass per step the last position is where the step started (o_last_vertex),
+		//so drawing between the two needs no extra buffer either.
+		void bindState() {
+			vao->allocate(vertices_samplers[current], A_POSITION, 3, GL_FLOAT, false, sizeof(tvec3));
+			vao->allocate(params.substeps > 1 ? start_vertices_sampler : last_vertices_samplers[current],
+				A_LAST_POSITION, 3, GL_FLOAT, false, sizeof(tvec3));
+		}
+
 		void initArray() {
 			vao = new KBuffer::VertexArray();
 
-			vbo = new KBuffer::VertexBuffer(vertices->size() * sizeof(tvec3), vertices->data());
-			//we will add data by transform feed back
-			vao->allocate(vbo, A_POSITION, 3, GL_FLOAT, false, sizeof(tvec3));
+			//positions come from the current state, see bindState
+			bindState();
 
 			tbo = new KBuffer::VertexBuffer(texcoords->size() * sizeof(tvec2), texcoords->data());
 			vao->allocate(tbo, A_TEXCOORD, 2, GL_FLOAT);
@@ -146,16 +168,43 @@ namespace KObject {
 
 			delete vertices; vertices = nullptr;
 			delete texcoords; texcoords = nullptr;
-			delete indices; indices = nullptr;
+		}
+
+		void uploadParams() {
+			ParamsBlock block;
+			block.size[0] = size_x;
+			block.size[1] = size_y;
+			block.rest_length[0] = params.rest_length.x;
+			block.rest_length[1] = params.rest_length.y;
+			block.diag_length = params.diag_length;
+			for (Kuint i = 0; i < 3; ++i) {
+				block.gravity[i] = params.gravity[i];
+				block.f_wind[i] = params.f_wind[i];
+				block.position[i] = position[i];
+				block.padding[i] = 0.f;
+			}
+			block.mass = params.mass;
+			block.a_resistance = params.a_resistance;
+			block.delta_time = params.getSubstepTime();
+			block.ks = params.ks;
+			block.kd = params.kd;
+			block.ks_bend = params.ks_bend;
+			block.kd_bend = params.kd_bend;
+			params_ubo->allocate(&block);
+			params_dirty = false;
+			params_position = position;
 		}
 
 	public:
 		VerletCloth(Ksize xslices = 30, Kfloat yslices = 20):
 			Object3D("Cloth"), size_x(xslices + 1), size_y(yslices + 1),
-			back_buffer(nullptr), vertices_sampler(nullptr),
-			constraints_sampler(nullptr), last_vertices_sampler(nullptr),
-			vertices(nullptr), texcoords(nullptr), normals(nullptr),
-			indices(nullptr), material(nullptr) {
+			params(xslices + 1, yslices + 1), params_ubo(nullptr), params_dirty(true),
+			back_buffer(nullptr), constraints_sampler(nullptr), constraints(nullptr),
+			vertices_samplers{ nullptr, nullptr }, last_vertices_samplers{ nullptr, nullptr }, current(0),
+			start_vertices_sampler(nullptr), compute(false),
+			vertices(nullptr), texcoords(nullptr), indices(nullptr),
+			normals(nullptr), material(nullptr) {
+			params_ubo = new KBuffer::UniformBuffer(sizeof(ParamsBlock), KBuffer::SOLVER_BLOCK);
 			material = new KMaterial::Material();
 			//material->ambient = tvec4(0.f, 0.67f, 0.56f, 1.f);
 			//material->diffuse = tvec4(0.41f, 0.69f, 0.67f, 1.f);
@@ -175,8 +224,13 @@ namespace KObject {
 
 			delete back_buffer;
 			delete constraints_sampler;
-			delete vertices_sampler;
-			delete last_vertices_sampler;
+			delete constraints;
+			for (int i = 0; i < 2; ++i) {
+				delete vertices_samplers[i];
+				delete last_vertices_samplers[i];
+			}
+			delete start_vertices_sampler;
+			delete params_ubo;
 		}
 
 		void bindUniform(const KShader::Shader* shader)const override {
@@ -185,80 +239,194 @@ namespace KObject {
 		}
 
 		void initBackBuffer(const KShader::Shader* back_shader) {
+			//outputs go straight into the state buffers, the back buffer keeps none of its own
 			back_buffer = new KBuffer::BackBuffer(back_shader,
 			{
 				"o_last_vertex",
-#define KDATA
-#ifndef KDATA
-				"o_point",
-#endif
 				"o_vertex"
 			},
-			{
-#ifdef KDATA
-				size_x * size_y * sizeof(tvec3),
-				size_x * size_y * sizeof(tvec3)
-#else
-				0, 0, 0
-#endif
-			},
+			{ 0, 0 },
 			GL_SEPARATE_ATTRIBS);
+		}
 
-#ifndef KDATA
-			//GPU will change the buffer data once it calculated.
-			last_vertices_sampler->bindToBackBuffer(0, back_buffer);
-			vertices_sampler->bindToBackBuffer(2, back_buffer);
-			vbo->bindToBackBuffer(1, back_buffer);
-#endif // !KDATA
+		//Instead of initBackBuffer, back_shader is verlet.comp then.
+		void initCompute() {
+			delete back_buffer;
+			back_buffer = nullptr;
+			compute = true;
 		}
 
-		void bindBackUniform(const KShader::Shader* back_shader)const {
-			back_shader->bindUniform2i("size", size_x, size_y);
-			back_shader->bindUniform2f("rest_length", rest_length);
-			back_shader->bindUniform1f("diag_length", diag_length);
+		Kboolean isCompute()const {
+			return compute;
+		}
 
-			back_shader->bindUniform3f("gravity", gravity);
-			back_shader->bindUniform1f("mass", mass);
-			back_shader->bindUniform1f("a_resistance", a_resistance);
-			back_shader->bindUniform3f("f_wind", f_wind);
+		//Once after the back buffer (or compute) is set up, s_center and s_radius are
+		//left to the renderer.
+		void bindBackUniform(const KShader::Shader* back_shader) {
+			back_shader->bindUniformBlock("VerletParams", KBuffer::SOLVER_BLOCK);
+			uploadParams();
+			params_ubo->bind();
 
-			back_shader->bindUniform1f("delta_time", delta_time);
+			if (compute) return;
+			constraints_sampler->bind(back_shader, "constraints_tbo", 0);
+			last_vertices_samplers[current]->bind(back_shader, "last_vertices_tbo", 1);
+			vertices_samplers[current]->bind(back_shader, "vertices_tbo", 2);
+		}
 
-			back_shader->bindUniform1f("ks", ks);
-			back_shader->bindUniform1f("kd", kd);
-			back_shader->bindUniform1f("ks_bend", ks_bend);
-			back_shader->bindUniform1f("kd_bend", kd_bend);
+		//One step of params.delta_time in params.substeps passes, SimulationClock decides
+		//how many steps run per frame. Every pass reads what the one before wrote.
+		void renderBack() {
+			//remember to bind uniform before, it holds for all passes.
+			if (params_dirty || params_position != position) uploadParams();
+			params_ubo->bind();
+			if (params.substeps > 1) {
+				start_vertices_sampler->copyDataFromBuffer(vertices_samplers[current],
+					size_x * size_y * sizeof(tvec3));
+			}
 
-			back_shader->bindUniform3f("u_position", position);
+			if (compute) {
+				constraints_sampler->bindToStorage(0);
+				for (Kuint s = 0; s < params.substeps; ++s) {
+					const Kuint next = 1 - current;
+					last_vertices_samplers[current]->bindToStorage(1);
+					vertices_samplers[current]->bindToStorage(2);
+					last_vertices_samplers[next]->bindToStorage(3);
+					vertices_samplers[next]->bindToStorage(4);
+
+					glDispatchCompute((size_x + WORK_GROUP - 1) / WORK_GROUP,
+						(size_y + WORK_GROUP - 1) / WORK_GROUP, 1);
+					//next pass reads it as storage, drawing and copies as buffers
+					glMemoryBarrier(GL_SHADER_STORAGE_BARRIER_BIT |
+						GL_VERTEX_ATTRIB_ARRAY_BARRIER_BIT | GL_BUFFER_UPDATE_BARRIER_BIT);
+
+					current = next;
+				}
+				bindState();
+				return;
+			}
 
-			constraints_sampler->bind(back_shader, "constraints_tbo", 0);
-			last_vertices_sampler->bind(back_shader, "last_vertices_tbo", 1);
-			vertices_sampler->bind(back_shader, "vertices_tbo", 2);
+			glEnable(GL_RASTERIZER_DISCARD);
+			for (Kuint s = 0; s < params.substeps; ++s) {
+				const Kuint next = 1 - current;
+				last_vertices_samplers[current]->bind(1);
+				vertices_samplers[current]->bind(2);
+				//feedback targets can not change while it is active, so one begin/end per pass
+				last_vertices_samplers[next]->bindToBackBuffer(0, back_buffer);
+				vertices_samplers[next]->bindToBackBuffer(1, back_buffer);
+
+				back_buffer->enable();
+				glDrawArrays(GL_POINTS, 0, size_x * size_y);
+				back_buffer->disable();
+
+				current = next;
+			}
+			glDisable(GL_RASTERIZER_DISCARD);
+
+			bindState();
 		}
 
-		void renderBack()const {
-			//remember to bind uniform and delta time before.
-			glEnable(GL_RASTERIZER_DISCARD);
-			back_buffer->enable();
+		void setSubsteps(Kuint substeps) {
+			params.substeps = substeps > 0 ? substeps : 1;
+			params_dirty = true; //delta_time of a pass
+			if (params.substeps > 1 && start_vertices_sampler == nullptr) {
+				start_vertices_sampler = new KBuffer::TextureBuffer(size_x * size_y * sizeof(tvec3), nullptr);
+				start_vertices_sampler->copyDataFromBuffer(vertices_samplers[current],
+					size_x * size_y * sizeof(tvec3));
+			}
+			bindState();
+		}
 
-			int t = 10;
+		Kuint getSubsteps()const {
+			return params.substeps;
+		}
 
-			while (t--) {
-				glDrawArrays(GL_POINTS, 0, size_x * size_y);
+		//alpha from SimulationClock, 1 draws the last step as it is.
+		void interpolate(Kfloat alpha) {
+			setLag(1.f - alpha);
+		}
+
+		//Draws positions (local space, tvec3 per vertex, from a cache) as the next state
+		//instead of a step, the current one becomes the state to interpolate from.
+		void loadFrame(const tvec3* positions) {
+			const Kuint next = 1 - current;
+			const Kuint bytes = size_x * size_y * sizeof(tvec3);
+			last_vertices_samplers[next]->copyDataFromBuffer(vertices_samplers[current], bytes);
+			if (params.substeps > 1) start_vertices_sampler->copyDataFromBuffer(vertices_samplers[current], bytes);
+			vertices_samplers[next]->allocate(0, bytes, positions);
+			current = next;
+			bindState();
+		}
+
+		//Triangles of the grid, kept for the topology of cache files.
+		const std::vector<Kuint>* getIndices()const {
+			return indices;
+		}
+
+		Ksize getSizeX()const {
+			return size_x;
+		}
+
+		Ksize getSizeY()const {
+			return size_y;
+		}
+
+		//Positions of the current state (local space), tvec3 per vertex.
+		std::uint64_t requestPositions(KBuffer::ReadbackRing* ring)const {
+			return vertices_samplers[current]->requestData(ring, size_x * size_y * sizeof(tvec3));
+		}
+
+		//Last positions of the current state, with requestPositions all a checkpoint needs.
+		std::uint64_t requestLastPositions(KBuffer::ReadbackRing* ring)const {
+			return last_vertices_samplers[current]->requestData(ring, size_x * size_y * sizeof(tvec3));
+		}
+
+		//positions and last_positions from requestPositions and requestLastPositions of one step,
+		//the particles have no other state here. It restores into VerletSolverCPU as well.
+		void saveState(KCache::Checkpoint* checkpoint, const tvec3* positions, const tvec3* last_positions)const {
+			const Ksize n = size_x * size_y;
+			std::vector<Kuint> pinned((n + 31) / 32, 0);
+			for (Ksize i = 0; i < n; ++i) {
+				if ((*constraints)[i]) pinned[i >> 5] |= 1u << (i & 31);
 			}
+			checkpoint->put(KCache::PARAMS, &params, 1);
+			checkpoint->put(KCache::POSITIONS, positions, n);
+			checkpoint->put(KCache::LAST_POSITIONS, last_positions, n);
+			checkpoint->put(KCache::PINNED, pinned.data(), pinned.size());
+		}
 
-			back_buffer->disable();
-			glDisable(GL_RASTERIZER_DISCARD);
+		//From this cloth or VerletSolverCPU. Both states get it, so the next frame
+		//does not interpolate from before.
+		Kboolean loadState(const KCache::Checkpoint& checkpoint) {
+			if (!checkpoint.matches(KCache::VERLET_SOLVER, size_x, size_y)) return false;
+			const Ksize n = size_x * size_y;
+			KPhysics::VerletParams loaded;
+			std::vector<tvec3> positions(n), last_positions(n);
+			if (!checkpoint.get(KCache::PARAMS, &loaded, 1) ||
+				!checkpoint.get(KCache::POSITIONS, positions.data(), n) ||
+				!checkpoint.get(KCache::LAST_POSITIONS, last_positions.data(), n)) {
+				std::cerr << "Checkpoint has no params or positions" << std::endl;
+				return false;
+			}
+			std::vector<Kuint> pinned((n + 31) / 32, 0);
+			if (checkpoint.get(KCache::PINNED, pinned.data(), pinned.size())) {
+				for (Ksize i = 0; i < n; ++i) (*constraints)[i] = (pinned[i >> 5] >> (i & 31)) & 1u;
+				constraints_sampler->allocate(0, constraints->size() * sizeof(Kubyte), constraints->data());
+			}
 
-#ifdef KDATA
-			last_vertices_sampler->copyDataFromBuffer(0, back_buffer);
-			vbo->copyDataFormBuffer(1, back_buffer);
-			vertices_sampler->copyDataFromBuffer(1, back_buffer);
-			
-			//save_data(back_buffer->getData<Kfloat>(1), size_x);
-			//const tvec3* data0 = back_buffer->getData<tvec3>(0);
-			//const tvec3* data1 = back_buffer->getData<tvec3>(1);
-#endif // KDATA
+			const Kuint bytes = n * sizeof(tvec3);
+			for (int i = 0; i < 2; ++i) {
+				vertices_samplers[i]->allocate(0, bytes, positions.data());
+				last_vertices_samplers[i]->allocate(0, bytes, last_positions.data());
+			}
+			params = loaded;
+			params_dirty = true;
+			setSubsteps(params.substeps);
+			if (start_vertices_sampler != nullptr) start_vertices_sampler->copyDataFromBuffer(vertices_samplers[current], bytes);
+			return true;
+		}
+
+		const KPhysics::VerletParams& getParams()const {
+			return params;
 		}
 
 		void render()const override {
@@ -278,6 +446,8 @@ namespace KObject {
 			unBind();
 		}
 	};
+
+	const Kuint VerletCloth::WORK_GROUP = 16;
 }
 
 #endif // !VERLET_CLOTH_H
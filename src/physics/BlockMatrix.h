@@ -0,0 +1,117 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef BLOCK_MATRIX_H
+#define BLOCK_MATRIX_H
+
+#include <vector>
+#include "../Core.h"
+#include "../math/Vec3.h"
+#include "../math/Mat3.h"
+#include "../util/ThreadPool.h"
+
+namespace KPhysics {
+	using tvec3 = KVector::Vec3;
+	using tmat3 = KMatrix::Mat3;
+
+	//Symmetric sparse matrix of 3x3 blocks, one block row per particle.
+	//The pattern comes from an edge list (the springs): edge e couples rows
+	//first[e] and second[e] and owns one off diagonal block, used for both (i, j) and (j, i).
+	//Rows keep a list of (column, edge) so a product only gathers, every row is
+	//written by one thread and the result does not depend on the thread count.
+	class BlockMatrix {
+	private:
+		Ksize rows;
+
+		std::vector<tmat3>* diagonal;
+		std::vector<tmat3>* off_diagonal; //one per edge
+
+		std::vector<Kuint>* row_offsets; //neighbours of row i are [offsets[i], offsets[i + 1])
+		std::vector<Kuint>* columns;
+		std::vector<Kuint>* edges;
+
+	public:
+		BlockMatrix() : rows(0), diagonal(nullptr), off_diagonal(nullptr),
+			row_offsets(nullptr), columns(nullptr), edges(nullptr) {
+			diagonal = new std::vector<tmat3>();
+			off_diagonal = new std::vector<tmat3>();
+			row_offsets = new std::vector<Kuint>();
+			columns = new std::vector<Kuint>();
+			edges = new std::vector<Kuint>();
+		}
+		~BlockMatrix() {
+			delete diagonal;
+			delete off_diagonal;
+			delete row_offsets;
+			delete columns;
+			delete edges;
+		}
+
+		void setPattern(Ksize rows, const Kuint* first, const Kuint* second, Ksize edge_count) {
+			this->rows = rows;
+			diagonal->assign(rows, tmat3(0.f));
+			off_diagonal->assign(edge_count, tmat3(0.f));
+
+			row_offsets->assign(rows + 1, 0);
+			for (Ksize e = 0; e < edge_count; ++e) {
+				++(*row_offsets)[first[e] + 1];
+				++(*row_offsets)[second[e] + 1];
+			}
+			for (Ksize i = 0; i < rows; ++i) (*row_offsets)[i + 1] += (*row_offsets)[i];
+
+			columns->resize(edge_count * 2);
+			edges->resize(edge_count * 2);
+			std::vector<Kuint> next(row_offsets->begin(), row_offsets->end() - 1);
+			for (Ksize e = 0; e < edge_count; ++e) {
+				const Kuint i = first[e], j = second[e];
+				(*columns)[next[i]] = j;
+				(*edges)[next[i]++] = e;
+				(*columns)[next[j]] = i;
+				(*edges)[next[j]++] = e;
+			}
+		}
+
+		Ksize size()const {
+			return rows;
+		}
+
+		void setZero() {
+			diagonal->assign(diagonal->size(), tmat3(0.f));
+			off_diagonal->assign(off_diagonal->size(), tmat3(0.f));
+		}
+
+		tmat3* getDiagonal() { return diagonal->data(); }
+		tmat3* getOffDiagonal() { return off_diagonal->data(); }
+		const tmat3* getDiagonal()const { return diagonal->data(); }
+		const tmat3* getOffDiagonal()const { return off_diagonal->data(); }
+
+		const Kuint* getRowOffsets()const { return row_offsets->data(); }
+		const Kuint* getColumns()const { return columns->data(); }
+		const Kuint* getEdges()const { return edges->data(); }
+
+		//y = A * x for rows [begin, end).
+		void multiply(const tvec3* x, tvec3* y, Ksize begin, Ksize end)const {
+			const Kuint* offsets = row_offsets->data();
+			const Kuint* col = columns->data();
+			const Kuint* edge = edges->data();
+			const tmat3* d = diagonal->data();
+			const tmat3* o = off_diagonal->data();
+			for (Ksize i = begin; i < end; ++i) {
+				tvec3 sum(d[i] * x[i]);
+				for (Kuint k = offsets[i]; k < offsets[i + 1]; ++k) {
+					sum += o[edge[k]] * x[col[k]];
+				}
+				y[i] = sum;
+			}
+		}
+
+		void multiply(KThread::ThreadPool* pool, const tvec3* x, tvec3* y)const {
+			pool->parallelFor(0, rows, [&](Ksize begin, Ksize end, Kuint) {
+				multiply(x, y, begin, end);
+			});
+		}
+	};
+}
+
+#endif // !BLOCK_MATRIX_H
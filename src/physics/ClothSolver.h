@@ -0,0 +1,403 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef CLOTH_SOLVER_H
+#define CLOTH_SOLVER_H
+
+#include <cstring>
+#include <cmath>
+#include <algorithm>
+#include "../Core.h"
+#include "../math/Vec3.h"
+#include "../math/function.h"
+#include "../util/ThreadPool.h"
+#include "../util/Profiler.h"
+#include "./Particles.h"
+#include "./Springs.h"
+#include "./Integrator.h"
+#include "./ImplicitSolver.h"
+#include "./XPBDSolver.h"
+#include "./ProjectiveSolver.h"
+
+namespace KPhysics {
+	using tvec3 = KVector::Vec3;
+
+	//The cloth KObject::Cloth draws. Defaults are the ones it has always used.
+	struct ClothParams {
+		Ksize size; //particles per side
+		Kfloat rest_length = 1.f;
+
+		tvec3 gravity = tvec3(0.f, -9.8f, 0.f);
+		Kfloat mass = 0.02f;
+		Kfloat a_resistance = -0.0125f;
+		tvec3 f_wind = tvec3(0.f, 0.f, 0.f);
+
+		Kfloat ks = 15.f;
+		Kfloat kd = 0.9f;
+
+		ClothParams(Ksize size = 30) : size(size) {}
+	};
+
+	//The SOLVER_STATE section of a ClothSolver checkpoint.
+	struct ClothSolverState {
+		Kuint integrator;
+		Kuint solvers; //1 << integrator of every solver that was created, with its settings below
+		Kfloat ground;
+		Kfloat ks[Springs::TYPE_COUNT];
+		Kfloat kd[Springs::TYPE_COUNT];
+
+		Kuint implicit_iterations;
+		Kfloat implicit_tolerance;
+		Kfloat compliance[Springs::TYPE_COUNT];
+		Kuint xpbd_substeps;
+		Kuint xpbd_iterations;
+		Kuint xpbd_budget;
+		Kfloat weights[Springs::TYPE_COUNT];
+		Kuint projective_iterations;
+	};
+
+	//The CPU cloth without GL: a square grid of particles hanging from its first row,
+	//structural and bend springs, and one of the integrators of Integrator.h.
+	class ClothSolver {
+	private:
+		static const Kfloat EXPSION; //ground offset
+		//Longest explicit step, longer ones are split. The damping is explicit and the
+		//springs are summed at once, the default cloth blows up from about 0.0075.
+		static const Kfloat MAX_EXPLICIT_STEP;
+
+		ClothParams params;
+
+		Particles* particles;
+		Springs* springs;
+		Integrator integrator;
+		ImplicitSolver* implicit_solver; //created on first use
+		XPBDSolver* xpbd_solver; //created on first use
+		ProjectiveSolver* projective_solver; //created on first use
+
+		KThread::ThreadPool* pool;
+		Kboolean deterministic;
+		Kfloat ground; //y of the floor in cloth space
+
+		void generate() {
+			const Ksize size = params.size;
+			const Kfloat rest_length = params.rest_length;
+			particles = new Particles(size * size, params.mass);
+
+			//no shear springs, add (1 << SHEAR) to the mask to enable them
+			springs = new Springs();
+			springs->generateGrid(size, size, rest_length, rest_length,
+				(1 << STRUCTURAL) | (1 << BEND));
+			springs->setStiffness(STRUCTURAL, params.ks, params.kd);
+			springs->setStiffness(BEND, params.ks, params.kd);
+
+			Kfloat y = size * rest_length / 2.f;
+			for (Ksize i = 0; i < size; ++i, y -= rest_length) {
+				Kfloat x = size * -rest_length / 2.f;
+				for (Ksize j = 0; j < size; ++j, x += rest_length) {
+					particles->setPosition(i * size + j, tvec3(x, size + 2, y));
+				}
+			}
+			for (Ksize i = 0; i < size; ++i) {
+				particles->setPinned(i);
+			}
+		}
+
+		//Gravity, wind and air drag into accelerations, as forces.
+		void calExternalForce() {
+			const Ksize n = particles->size();
+			const tvec3* v = particles->getVelocities();
+			const Kfloat* m = particles->getMasses();
+			tvec3* a = particles->getAccelerations();
+			pool->parallelFor(0, n, [&](Ksize begin, Ksize end, Kuint) {
+				for (Ksize i = begin; i < end; ++i) {
+					a[i] = m[i] * params.gravity + params.f_wind;
+					if (!v[i].isZero()) a[i] += (params.a_resistance * v[i].dot(v[i])) * KFunction::normalize(v[i]);
+				}
+			});
+		}
+
+		void calAcceleration() {
+			//a holds forces until all springs are added
+			calExternalForce();
+			KTime::ScopeTimer timer("springs");
+			springs->accumulateForces(pool, particles->getPositions(), particles->getVelocities(),
+				particles->getAccelerations(), particles->size(), deterministic);
+		}
+
+		//Trapezoidal explicit Euler.
+		void updateExplicit(Kfloat delta_time) {
+			const Ksize n = particles->size();
+			tvec3* p = particles->getPositions();
+			tvec3* last_p = particles->getLastPositions();
+			tvec3* v = particles->getVelocities();
+			tvec3* a = particles->getAccelerations();
+			const Kfloat* m = particles->getMasses();
+			const Kfloat half_time = delta_time / 2.0f;
+			pool->parallelFor(0, n, [&](Ksize begin, Ksize end, Kuint) {
+				for (Ksize i = begin; i < end; ++i) {
+					last_p[i] = p[i];
+					if (particles->isPinned(i)) {
+						a[i].set(0.f);
+						continue;
+					}
+					a[i] /= m[i];
+					if (p[i].y <= ground) {
+						if (a[i].y < 0) a[i].y = 0;
+						if (v[i].y < 0) v[i].y = 0;
+					}
+					tvec3 tmp(v[i]);
+					v[i] += a[i] * delta_time;
+					p[i] += (tmp += v[i]) *= half_time;
+					if (p[i].y < ground) p[i].y = ground + EXPSION;
+				}
+			});
+		}
+
+		//Backward Euler: v += dv from the solver, then x += v * h.
+		void updateImplicit(Kfloat delta_time) {
+			implicit_solver->solve(delta_time, particles->getAccelerations());
+
+			const Ksize n = particles->size();
+			tvec3* p = particles->getPositions();
+			tvec3* last_p = particles->getLastPositions();
+			tvec3* v = particles->getVelocities();
+			tvec3* a = particles->getAccelerations();
+			const tvec3* dv = implicit_solver->getVelocityChanges();
+			pool->parallelFor(0, n, [&](Ksize begin, Ksize end, Kuint) {
+				for (Ksize i = begin; i < end; ++i) {
+					last_p[i] = p[i];
+					if (particles->isPinned(i)) {
+						a[i].set(0.f);
+						continue;
+					}
+					a[i] = dv[i] / delta_time;
+					v[i] += dv[i];
+					if (p[i].y <= ground && v[i].y < 0) v[i].y = 0;
+					p[i] += v[i] * delta_time;
+					if (p[i].y < ground) p[i].y = ground + EXPSION;
+				}
+			});
+		}
+
+	public:
+		//0 threads means one per hardware thread.
+		ClothSolver(const ClothParams& params = ClothParams(), Kuint threads = 0) : params(params),
+			particles(nullptr), springs(nullptr), integrator(EXPLICIT_EULER),
+			implicit_solver(nullptr), xpbd_solver(nullptr), projective_solver(nullptr),
+			pool(nullptr), deterministic(true), ground(0.f) {
+			pool = new KThread::ThreadPool(threads);
+			generate();
+		}
+		~ClothSolver() {
+			delete implicit_solver;
+			delete xpbd_solver;
+			delete projective_solver;
+			delete pool;
+			delete particles;
+			delete springs;
+		}
+
+		//One step of delta_time.
+		void step(Kfloat delta_time) {
+			if (KFunction::isZero(delta_time)) return;
+			KTime::ScopeTimer step_timer("step");
+			if (integrator == XPBD) {
+				calExternalForce();
+				KTime::ScopeTimer timer("integrate");
+				xpbd_solver->step(delta_time, particles->getAccelerations());
+				return;
+			}
+			if (integrator == PROJECTIVE) {
+				calExternalForce();
+				KTime::ScopeTimer timer("integrate");
+				projective_solver->step(delta_time, particles->getAccelerations());
+				return;
+			}
+			if (integrator == IMPLICIT_EULER) {
+				calAcceleration();
+				KTime::ScopeTimer timer("integrate");
+				updateImplicit(delta_time);
+				return;
+			}
+			const Kuint substeps = std::max(1u, Kuint(std::ceil(delta_time / MAX_EXPLICIT_STEP - 0.001f)));
+			const Kfloat substep_time = delta_time / substeps;
+			for (Kuint s = 0; s < substeps; ++s) {
+				calAcceleration();
+				KTime::ScopeTimer timer("integrate");
+				updateExplicit(substep_time);
+			}
+		}
+
+		//0 means one thread per hardware thread.
+		void setThreadCount(Kuint count) {
+			pool->setThreadCount(count);
+		}
+
+		Kuint getThreadCount()const {
+			return pool->getThreadCount();
+		}
+
+		//SCALAR or SIMD spring forces, to compare both on the same cloth.
+		void setSpringBackend(SpringBackend backend) {
+			springs->setBackend(backend);
+		}
+
+		//Stiff springs (ks around 1e4) need IMPLICIT_EULER to stay stable at one step per frame.
+		void setIntegrator(Integrator integrator) {
+			this->integrator = integrator;
+			if (integrator == IMPLICIT_EULER && implicit_solver == nullptr) {
+				implicit_solver = new ImplicitSolver(particles, springs, pool);
+			}
+			if (integrator == XPBD) getXPBDSolver();
+			if (integrator == PROJECTIVE) getProjectiveSolver();
+		}
+
+		Integrator getIntegrator()const {
+			return integrator;
+		}
+
+		void setSpringStiffness(SpringType type, Kfloat ks, Kfloat kd) {
+			springs->setStiffness(type, ks, kd);
+		}
+
+		//Compliance, substeps and the iteration budget are set on the solver,
+		//compliance starts as 1 / ks of the springs.
+		XPBDSolver* getXPBDSolver() {
+			if (xpbd_solver == nullptr) {
+				xpbd_solver = new XPBDSolver(particles, springs, pool);
+				xpbd_solver->setGround(ground);
+			}
+			return xpbd_solver;
+		}
+
+		//Weights start as ks of the springs, the factor is built on the first step
+		//(or taken from the cache) and kept while the step length does not change.
+		ProjectiveSolver* getProjectiveSolver() {
+			if (projective_solver == nullptr) {
+				projective_solver = new ProjectiveSolver(particles, springs, pool);
+				projective_solver->setGround(ground);
+			}
+			return projective_solver;
+		}
+
+		//Deterministic steps give the same result bit for bit whatever the thread count is.
+		void setDeterministic(Kboolean deterministic = true) {
+			this->deterministic = deterministic;
+		}
+
+		//The floor in cloth space, -y of the cloth's position when it is drawn moved.
+		void setGround(Kfloat ground) {
+			this->ground = ground;
+			if (xpbd_solver != nullptr) xpbd_solver->setGround(ground);
+			if (projective_solver != nullptr) projective_solver->setGround(ground);
+		}
+
+		//Params, integrator, ground, spring stiffness, the settings of the solvers
+		//that were created and every particle array, so the steps after a restore are
+		//the same bit for bit. Threads and the spring backend are how it runs, not what
+		//it is, the caller sets them again.
+		void saveState(KCache::Checkpoint* checkpoint)const {
+			ClothSolverState state;
+			memset(&state, 0, sizeof(ClothSolverState));
+			state.integrator = integrator;
+			state.ground = ground;
+			for (Kuint t = 0; t < Springs::TYPE_COUNT; ++t) {
+				state.ks[t] = springs->getKs(SpringType(t));
+				state.kd[t] = springs->getKd(SpringType(t));
+			}
+			if (implicit_solver != nullptr) {
+				state.solvers |= 1 << IMPLICIT_EULER;
+				state.implicit_iterations = implicit_solver->getMaxIterations();
+				state.implicit_tolerance = implicit_solver->getTolerance();
+			}
+			if (xpbd_solver != nullptr) {
+				state.solvers |= 1 << XPBD;
+				for (Kuint t = 0; t < Springs::TYPE_COUNT; ++t) {
+					state.compliance[t] = xpbd_solver->getCompliance(SpringType(t));
+				}
+				state.xpbd_substeps = xpbd_solver->getSubsteps();
+				state.xpbd_iterations = xpbd_solver->getIterations();
+				state.xpbd_budget = xpbd_solver->getIterationBudget();
+			}
+			if (projective_solver != nullptr) {
+				state.solvers |= 1 << PROJECTIVE;
+				for (Kuint t = 0; t < Springs::TYPE_COUNT; ++t) {
+					state.weights[t] = projective_solver->getWeight(SpringType(t));
+				}
+				state.projective_iterations = projective_solver->getIterations();
+			}
+			checkpoint->put(KCache::PARAMS, &params, 1);
+			checkpoint->put(KCache::SOLVER_STATE, &state, 1);
+			particles->saveState(checkpoint);
+			if (implicit_solver != nullptr) {
+				//CG starts from the last solution
+				checkpoint->put(KCache::FIRST_GUESS, implicit_solver->getVelocityChanges(), particles->size());
+			}
+		}
+
+		//checkpoint has to be of a cloth of the same size.
+		Kboolean loadState(const KCache::Checkpoint& checkpoint) {
+			if (!checkpoint.matches(KCache::CLOTH_SOLVER, params.size, params.size)) return false;
+			ClothParams loaded;
+			ClothSolverState state;
+			if (!checkpoint.get(KCache::PARAMS, &loaded, 1) || !checkpoint.get(KCache::SOLVER_STATE, &state, 1)) {
+				std::cerr << "Checkpoint has no solver state" << std::endl;
+				return false;
+			}
+			if (state.integrator > PROJECTIVE) {
+				std::cerr << "Checkpoint has an unknown integrator " << state.integrator << std::endl;
+				return false;
+			}
+			if (!particles->loadState(checkpoint)) return false;
+			params = loaded;
+			for (Kuint t = 0; t < Springs::TYPE_COUNT; ++t) {
+				springs->setStiffness(SpringType(t), state.ks[t], state.kd[t]);
+			}
+			//masses and pins may have changed
+			if (xpbd_solver != nullptr) xpbd_solver->rebuild();
+			if (projective_solver != nullptr) projective_solver->rebuild();
+			if (state.solvers & (1 << IMPLICIT_EULER)) {
+				setIntegrator(IMPLICIT_EULER);
+				implicit_solver->setMaxIterations(state.implicit_iterations);
+				implicit_solver->setTolerance(state.implicit_tolerance);
+				checkpoint.get(KCache::FIRST_GUESS, implicit_solver->getFirstGuess(), particles->size());
+			}
+			if (state.solvers & (1 << XPBD)) {
+				for (Kuint t = 0; t < Springs::TYPE_COUNT; ++t) {
+					getXPBDSolver()->setCompliance(SpringType(t), state.compliance[t]);
+				}
+				xpbd_solver->setSubsteps(state.xpbd_substeps);
+				xpbd_solver->setIterations(state.xpbd_iterations);
+				xpbd_solver->setIterationBudget(state.xpbd_budget);
+			}
+			if (state.solvers & (1 << PROJECTIVE)) {
+				for (Kuint t = 0; t < Springs::TYPE_COUNT; ++t) {
+					getProjectiveSolver()->setWeight(SpringType(t), state.weights[t]);
+				}
+				projective_solver->setIterations(state.projective_iterations);
+			}
+			setIntegrator(Integrator(state.integrator));
+			setGround(state.ground);
+			return true;
+		}
+
+		const ClothParams& getParams()const {
+			return params;
+		}
+
+		Ksize getSize()const {
+			return params.size;
+		}
+
+		Particles* getParticles() {
+			return particles;
+		}
+
+		const Particles* getParticles()const {
+			return particles;
+		}
+	};
+}
+
+#endif // !CLOTH_SOLVER_H
@@ -0,0 +1,228 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef EULER_SOLVER_H
+#define EULER_SOLVER_H
+
+#include <vector>
+#include <cmath>
+#include "../Core.h"
+#include "../math/Vec3.h"
+#include "../util/ThreadPool.h"
+#include "./Particles.h"
+#include "./GridStencil.h"
+
+namespace KPhysics {
+	using tvec3 = KVector::Vec3;
+
+	//Everything euler.vert reads from uniforms except the object position.
+	//Defaults are the ones EulerCloth has always used.
+	struct EulerParams {
+		Kint size;
+		Kfloat length;
+		Kfloat rest_length; //length / size
+		Kfloat diag_length; //rest_length * sqrt(2)
+
+		tvec3 gravity = tvec3(0.f, -9.8f, 0.f); //a constant in the shader
+		Kfloat mass = 0.1f;
+		Kfloat a_resistance = -0.0125f;
+		tvec3 f_wind = tvec3(0.f);
+
+		Kfloat ks = 15.f;
+		Kfloat kd = 0.96f;
+		Kfloat ks_bend = 0.036f;
+		Kfloat kd_bend = 0.96f;
+
+		Kfloat delta_time = 1.f / 60.f;
+
+		EulerParams(Ksize size = 30, Kfloat length = 9.6f) : size(size), length(length) {
+			rest_length = length / size;
+			diag_length = rest_length * sqrt(2);
+		}
+
+		GridStencil getStencil()const {
+			return GridStencil{ size, size, rest_length, rest_length, diag_length };
+		}
+	};
+
+	//CPU version of res/euler.vert: trapezoidal Euler on positions and velocities
+	//with the same 12-spring stencil and ground contact clamping.
+	//It shares Particles and the thread pool with VerletSolverCPU, so both
+	//integrators can be run on identical inputs.
+	class EulerSolverCPU {
+	private:
+		static const Kfloat EXPSION; //ground offset, same as the shader
+
+		EulerParams params;
+		GridStencil stencil;
+		tvec3 position; //u_position
+
+		Particles* particles;
+		std::vector<tvec3>* next_positions;
+		std::vector<tvec3>* next_last_positions;
+		std::vector<tvec3>* next_velocities;
+
+		KThread::ThreadPool* pool;
+		Kboolean own_pool;
+
+		tvec3 calAirForce(const tvec3& velocity)const {
+			if (velocity == tvec3(0.f)) return tvec3(0.f);
+			return (params.a_resistance * velocity.dot<Kfloat>(velocity)) * (velocity / velocity.length<Kfloat>());
+		}
+
+		void stepVertex(Kint id, const tvec3* p, const tvec3* v,
+			tvec3& o_vertex, tvec3& o_velocity)const {
+			tvec3 p0(p[id]);
+			tvec3 v0(v[id]);
+
+			if (particles->isPinned(id)) {
+				o_vertex = p0;
+				o_velocity.set(0.f);
+				return;
+			}
+			if (params.delta_time == 0.f) {
+				o_vertex = p0;
+				o_velocity = v0;
+				return;
+			}
+
+			const Kint i = id / params.size;
+			const Kint j = id % params.size;
+			tvec3 acceleration(0.f);
+			if (params.mass != 0.f) {
+				acceleration = params.mass * params.gravity + params.f_wind + calAirForce(v0);
+				for (Kint k = 0; k < GridStencil::SPRING_COUNT; ++k) {
+					Kint index;
+					Kfloat r_length;
+					if (!stencil.getSpring(id, i, j, k, index, r_length)) continue;
+					tvec3 delta_p(p0 - p[index]);
+					const Kfloat delta_length = delta_p.length<Kfloat>();
+					if (delta_length - r_length <= 0.f) continue;
+
+					const Kfloat damp = delta_p.dot<Kfloat>(v0 - v[index]) / delta_length;
+					delta_p /= delta_length;
+					if (r_length != params.diag_length) {
+						acceleration -= (params.ks * (delta_length - r_length) + params.kd * damp) * delta_p;
+					}
+					else {
+						acceleration -= (params.ks_bend * (delta_length - r_length) + params.kd_bend * damp) * delta_p;
+					}
+				}
+				acceleration /= params.mass;
+			}
+
+			if (p0.y + position.y <= EXPSION) {
+				if (acceleration.y < 0.f) acceleration.y = 0.f;
+				if (v0.y < 0.f) v0.y = 0.f;
+				p0.y = EXPSION - position.y;
+			}
+			o_velocity = v0 + acceleration * params.delta_time;
+			o_vertex = p0 + (o_velocity + v0) * (params.delta_time / 2.f);
+		}
+
+	public:
+		EulerSolverCPU(const EulerParams& params, KThread::ThreadPool* pool = nullptr) :
+			params(params), stencil(params.getStencil()), position(0.f),
+			particles(nullptr), next_positions(nullptr), next_last_positions(nullptr),
+			next_velocities(nullptr), pool(pool), own_pool(pool == nullptr) {
+			if (own_pool) this->pool = new KThread::ThreadPool();
+
+			const Ksize count = params.size * params.size;
+			particles = new Particles(count, params.mass);
+			next_positions = new std::vector<tvec3>(count);
+			next_last_positions = new std::vector<tvec3>(count);
+			next_velocities = new std::vector<tvec3>(count);
+
+			std::vector<tvec3> vertices;
+			generateVertices(params, &vertices);
+			for (Ksize i = 0; i < count; ++i) particles->setPosition(i, vertices[i]);
+			for (Kint i = 0; i < params.size; ++i) particles->setPinned(i);
+		}
+		~EulerSolverCPU() {
+			delete particles;
+			delete next_positions;
+			delete next_last_positions;
+			delete next_velocities;
+			if (own_pool) delete pool;
+		}
+
+		//Rest positions of the grid, the same EulerCloth uploads.
+		static void generateVertices(const EulerParams& params, std::vector<tvec3>* vertices) {
+			vertices->clear();
+			vertices->reserve(params.size * params.size);
+			Kfloat y = params.length / 2.f;
+			for (int i = 0; i < params.size; ++i, y -= params.rest_length) {
+				Kfloat x = -params.length / 2.f;
+				for (int j = 0; j < params.size; ++j, x += params.rest_length) {
+					//vertices->emplace_back(x, y, 0.f);
+					vertices->emplace_back(x, params.length, y);
+				}
+			}
+		}
+
+		//One pass of the shader over every vertex.
+		void step() {
+			const Kint count = particles->size();
+			const tvec3* p = particles->getPositions();
+			const tvec3* v = particles->getVelocities();
+			tvec3* o_last = next_last_positions->data();
+			tvec3* o_p = next_positions->data();
+			tvec3* o_v = next_velocities->data();
+			pool->parallelFor(0, count, [&](Ksize begin, Ksize end, Kuint) {
+				for (Ksize id = begin; id < end; ++id) {
+					stepVertex(id, p, v, o_p[id], o_v[id]);
+					o_last[id] = p[id];
+				}
+			});
+			particles->swapPositions(next_positions, next_last_positions);
+			particles->swapVelocities(next_velocities);
+		}
+
+		void step(Kuint passes) {
+			while (passes--) step();
+		}
+
+		void setPosition(const tvec3& position) {
+			this->position = position;
+		}
+
+		void setDeltaTime(Kfloat delta_time) {
+			params.delta_time = delta_time;
+		}
+
+		//Params and every particle array, position belongs to the scene.
+		void saveState(KCache::Checkpoint* checkpoint)const {
+			checkpoint->put(KCache::PARAMS, &params, 1);
+			particles->saveState(checkpoint);
+		}
+
+		//checkpoint has to be of a cloth of the same size, from this solver or EulerCloth.
+		Kboolean loadState(const KCache::Checkpoint& checkpoint) {
+			if (!checkpoint.matches(KCache::EULER_SOLVER, params.size, params.size)) return false;
+			EulerParams loaded;
+			if (!checkpoint.get(KCache::PARAMS, &loaded, 1)) {
+				std::cerr << "Checkpoint has no params" << std::endl;
+				return false;
+			}
+			if (!particles->loadState(checkpoint)) return false;
+			params = loaded;
+			stencil = params.getStencil();
+			return true;
+		}
+
+		const EulerParams& getParams()const {
+			return params;
+		}
+
+		Particles* getParticles() {
+			return particles;
+		}
+
+		const Particles* getParticles()const {
+			return particles;
+		}
+	};
+}
+
+#endif // !EULER_SOLVER_H
@@ -0,0 +1,101 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef GRID_STENCIL_H
+#define GRID_STENCIL_H
+
+#include "../Core.h"
+
+namespace KPhysics {
+	//The 12 springs every vertex of a row-major grid has in verlet.vert and euler.vert,
+	//same numbering as getSpringMsg in the shaders:
+	// p - p - 8 - p - p
+	// |   |   |   |   |
+	// p - 0 - 1 - 2 - p
+	// |   |   |   |   |
+	// 9 - 3 - p - 4 - 10
+	// |   |   |   |   |
+	// p - 5 - 6 - 7 - p
+	// |   |   |   |   |
+	// p - p - 11 - p - p
+	struct GridStencil {
+		static const Kint SPRING_COUNT = 12;
+
+		Kint size_x, size_y;
+		Kfloat rest_x, rest_y;
+		Kfloat diag_length;
+
+		//i is the row and j the column of vertex id.
+		//Returns false when spring k of the vertex falls out of the grid.
+		inline Kboolean getSpring(Kint id, Kint i, Kint j, Kint k, Kint& index, Kfloat& r_length)const {
+			switch (k) {
+			case 0:
+				if (i == 0 || j == 0) return false;
+				index = id - size_x - 1;
+				r_length = diag_length;
+				return true;
+			case 2:
+				if (i == 0 || j == size_x - 1) return false;
+				index = id - size_x + 1;
+				r_length = diag_length;
+				return true;
+			case 5:
+				if (i == size_y - 1 || j == 0) return false;
+				index = id + size_x - 1;
+				r_length = diag_length;
+				return true;
+			case 7:
+				if (i == size_y - 1 || j == size_x - 1) return false;
+				index = id + size_x + 1;
+				r_length = diag_length;
+				return true;
+
+			case 1:
+				if (i == 0) return false;
+				index = id - size_x;
+				r_length = rest_y;
+				return true;
+			case 3:
+				if (j == 0) return false;
+				index = id - 1;
+				r_length = rest_x;
+				return true;
+			case 4:
+				if (j == size_x - 1) return false;
+				index = id + 1;
+				r_length = rest_x;
+				return true;
+			case 6:
+				if (i == size_y - 1) return false;
+				index = id + size_x;
+				r_length = rest_y;
+				return true;
+
+			case 8:
+				if (i < 2) return false;
+				index = id - size_x * 2;
+				r_length = rest_y * 2;
+				return true;
+			case 9:
+				if (j < 2) return false;
+				index = id - 2;
+				r_length = rest_x * 2;
+				return true;
+			case 10:
+				if (j >= size_x - 2) return false;
+				index = id + 2;
+				r_length = rest_x * 2;
+				return true;
+			case 11:
+				if (i >= size_y - 2) return false;
+				index = id + size_x * 2;
+				r_length = rest_y * 2;
+				return true;
+			}
+			return false;
+		}
+	};
+}
+
+#endif // !GRID_STENCIL_H
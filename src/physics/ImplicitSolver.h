@@ -0,0 +1,316 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef IMPLICIT_SOLVER_H
+#define IMPLICIT_SOLVER_H
+
+#include <vector>
+#include <cmath>
+#include "../Core.h"
+#include "../math/Vec3.h"
+#include "../math/Mat3.h"
+#include "../util/ThreadPool.h"
+#include "./Particles.h"
+#include "./Springs.h"
+#include "./BlockMatrix.h"
+
+namespace KPhysics {
+	using tvec3 = KVector::Vec3;
+	using tmat3 = KMatrix::Mat3;
+
+	//Backward Euler step in the way of Baraff and Witkin (Large Steps in Cloth Simulation).
+	//The spring forces are linearized around the current state, which gives
+	//	(M - h * df/dv - h^2 * df/dx) * dv = h * (f + h * df/dx * v)
+	//The matrix is assembled block by block from the springs and solved with
+	//conjugate gradient, preconditioned with the inverse of the 3x3 diagonal blocks.
+	//Pinned particles are filtered out of the system, their dv stays zero.
+	//It stays stable for stiff springs at one step per frame where the explicit
+	//path would need hundreds of substeps.
+	class ImplicitSolver {
+	private:
+		static const Ksize DOT_CHUNK = 1024; //fixed reduction chunks, results do not depend on thread count
+
+		const Particles* particles;
+		const Springs* springs;
+		KThread::ThreadPool* pool;
+
+		BlockMatrix* matrix;
+		std::vector<tmat3>* jacobians; //df_i/dx_j of every spring
+		std::vector<tmat3>* preconditioner; //inverse diagonal blocks
+
+		std::vector<tvec3>* dv;
+		std::vector<tvec3>* rhs;
+		std::vector<tvec3>* residual;
+		std::vector<tvec3>* direction;
+		std::vector<tvec3>* product;
+		std::vector<tvec3>* preconditioned;
+		std::vector<Kdouble>* partials;
+
+		Kuint max_iterations;
+		Kfloat tolerance;
+		Kuint iterations;
+		Kfloat relative_residual;
+
+		static tmat3 outer(const tvec3& a, const tvec3& b) {
+			return tmat3(a.x * b.x, a.x * b.y, a.x * b.z,
+				a.y * b.x, a.y * b.y, a.y * b.z,
+				a.z * b.x, a.z * b.y, a.z * b.z);
+		}
+
+		//Mat3::inverse gives up below a fixed determinant, which small masses reach.
+		//Diagonal blocks are symmetric positive definite, so only exact zero is a problem.
+		static tmat3 invert(const tmat3& m) {
+			const Kdouble c00 = (Kdouble)m[1][1] * m[2][2] - (Kdouble)m[1][2] * m[2][1];
+			const Kdouble c01 = (Kdouble)m[1][2] * m[2][0] - (Kdouble)m[1][0] * m[2][2];
+			const Kdouble c02 = (Kdouble)m[1][0] * m[2][1] - (Kdouble)m[1][1] * m[2][0];
+			const Kdouble det = m[0][0] * c00 + m[0][1] * c01 + m[0][2] * c02;
+			if (det == 0.0) return tmat3(0.f);
+			const Kdouble inv = 1.0 / det;
+			return tmat3(
+				c00 * inv, ((Kdouble)m[0][2] * m[2][1] - (Kdouble)m[0][1] * m[2][2]) * inv,
+				((Kdouble)m[0][1] * m[1][2] - (Kdouble)m[0][2] * m[1][1]) * inv,
+				c01 * inv, ((Kdouble)m[0][0] * m[2][2] - (Kdouble)m[0][2] * m[2][0]) * inv,
+				((Kdouble)m[0][2] * m[1][0] - (Kdouble)m[0][0] * m[1][2]) * inv,
+				c02 * inv, ((Kdouble)m[0][1] * m[2][0] - (Kdouble)m[0][0] * m[2][1]) * inv,
+				((Kdouble)m[0][0] * m[1][1] - (Kdouble)m[0][1] * m[1][0]) * inv);
+		}
+
+		Kdouble dot(const tvec3* a, const tvec3* b) {
+			const Ksize n = particles->size();
+			const Ksize chunks = (n + DOT_CHUNK - 1) / DOT_CHUNK;
+			Kdouble* part = partials->data();
+			pool->parallelFor(0, chunks, [&](Ksize begin, Ksize end, Kuint) {
+				for (Ksize c = begin; c < end; ++c) {
+					const Ksize last = (c + 1) * DOT_CHUNK < n ? (c + 1) * DOT_CHUNK : n;
+					Kdouble sum = 0.0;
+					for (Ksize i = c * DOT_CHUNK; i < last; ++i) {
+						sum += (Kdouble)a[i].x * b[i].x + (Kdouble)a[i].y * b[i].y + (Kdouble)a[i].z * b[i].z;
+					}
+					part[c] = sum;
+				}
+			}, false, 1);
+			Kdouble sum = 0.0;
+			for (Ksize c = 0; c < chunks; ++c) sum += part[c];
+			return sum;
+		}
+
+		//A * x with pinned rows filtered to zero.
+		void multiply(const tvec3* x, tvec3* y) {
+			pool->parallelFor(0, particles->size(), [&](Ksize begin, Ksize end, Kuint) {
+				matrix->multiply(x, y, begin, end);
+				for (Ksize i = begin; i < end; ++i) {
+					if (particles->isPinned(i)) y[i].set(0.f);
+				}
+			});
+		}
+
+		void assemble(Kfloat h, const tvec3* forces) {
+			const SpringData s = springs->getData();
+			const tvec3* p = particles->getPositions();
+			const tvec3* v = particles->getVelocities();
+			const Kfloat* m = particles->getMasses();
+			tmat3* jacobian = jacobians->data();
+			tmat3* off = matrix->getOffDiagonal();
+			const Kfloat h2 = h * h;
+
+			//one block per spring, the stretch part of the jacobian is clamped
+			//at rest length like the forces, so every block stays positive semi definite
+			pool->parallelFor(0, springs->size(), [&](Ksize begin, Ksize end, Kuint) {
+				const tmat3 identity(1.f);
+				for (Ksize k = begin; k < end; ++k) {
+					const Kuint i = s.first[k], j = s.second[k];
+					tvec3 dp(p[i] - p[j]);
+					const Kfloat len = dp.length<Kfloat>();
+					if (len - s.rest_lengths[k] <= 0.f) {
+						jacobian[k] = tmat3(0.f);
+						off[k] = tmat3(0.f);
+						continue;
+					}
+					dp /= len;
+					const tmat3 nn(outer(dp, dp));
+					const Kfloat ks = s.ks[s.types[k]], kd = s.kd[s.types[k]];
+					jacobian[k] = (nn + (identity - nn) * (1.f - s.rest_lengths[k] / len)) * ks;
+					off[k] = -(jacobian[k] * h2 + nn * (kd * h));
+				}
+			});
+
+			//rows gather their springs, so the diagonal and the right side need no atomics
+			const Kuint* offsets = matrix->getRowOffsets();
+			const Kuint* columns = matrix->getColumns();
+			const Kuint* edges = matrix->getEdges();
+			tmat3* diagonal = matrix->getDiagonal();
+			tmat3* inv = preconditioner->data();
+			tvec3* b = rhs->data();
+			pool->parallelFor(0, particles->size(), [&](Ksize begin, Ksize end, Kuint) {
+				for (Ksize i = begin; i < end; ++i) {
+					tmat3 d(m[i]);
+					tvec3 kv(0.f);
+					for (Kuint k = offsets[i]; k < offsets[i + 1]; ++k) {
+						d -= off[edges[k]];
+						kv += jacobian[edges[k]] * (v[i] - v[columns[k]]);
+					}
+					diagonal[i] = d;
+					if (particles->isPinned(i)) {
+						inv[i] = tmat3(0.f);
+						b[i].set(0.f);
+						continue;
+					}
+					inv[i] = invert(d);
+					b[i] = forces[i] * h - kv * h2;
+				}
+			});
+		}
+
+		void precondition(const tvec3* r, tvec3* z) {
+			const tmat3* inv = preconditioner->data();
+			pool->parallelFor(0, particles->size(), [&](Ksize begin, Ksize end, Kuint) {
+				for (Ksize i = begin; i < end; ++i) z[i] = inv[i] * r[i];
+			});
+		}
+
+	public:
+		ImplicitSolver(const Particles* particles, const Springs* springs, KThread::ThreadPool* pool) :
+			particles(particles), springs(springs), pool(pool), matrix(nullptr), jacobians(nullptr),
+			preconditioner(nullptr), dv(nullptr), rhs(nullptr), residual(nullptr), direction(nullptr),
+			product(nullptr), preconditioned(nullptr), partials(nullptr),
+			max_iterations(100), tolerance(1e-4f), iterations(0), relative_residual(0.f) {
+			matrix = new BlockMatrix();
+			jacobians = new std::vector<tmat3>();
+			preconditioner = new std::vector<tmat3>();
+			dv = new std::vector<tvec3>();
+			rhs = new std::vector<tvec3>();
+			residual = new std::vector<tvec3>();
+			direction = new std::vector<tvec3>();
+			product = new std::vector<tvec3>();
+			preconditioned = new std::vector<tvec3>();
+			partials = new std::vector<Kdouble>();
+			rebuild();
+		}
+		~ImplicitSolver() {
+			delete matrix;
+			delete jacobians;
+			delete preconditioner;
+			delete dv;
+			delete rhs;
+			delete residual;
+			delete direction;
+			delete product;
+			delete preconditioned;
+			delete partials;
+		}
+
+		//Call again when particles or springs are added or removed.
+		void rebuild() {
+			const Ksize n = particles->size();
+			matrix->setPattern(n, springs->getFirst(), springs->getSecond(), springs->size());
+			jacobians->assign(springs->size(), tmat3(0.f));
+			preconditioner->assign(n, tmat3(0.f));
+			dv->assign(n, tvec3(0.f));
+			rhs->assign(n, tvec3(0.f));
+			residual->assign(n, tvec3(0.f));
+			direction->assign(n, tvec3(0.f));
+			product->assign(n, tvec3(0.f));
+			preconditioned->assign(n, tvec3(0.f));
+			partials->assign((n + DOT_CHUNK - 1) / DOT_CHUNK, 0.0);
+		}
+
+		//Solve for the velocity change of one step of length h.
+		//forces are the total forces at the current state (springs and external).
+		//The last solution is the first guess, so slow motion converges in a few iterations.
+		//Returns false when CG did not reach the tolerance, dv is still the best iterate.
+		Kboolean solve(Kfloat h, const tvec3* forces) {
+			assemble(h, forces);
+
+			const Ksize n = particles->size();
+			tvec3* x = dv->data();
+			tvec3* r = residual->data();
+			tvec3* d = direction->data();
+			tvec3* q = product->data();
+			tvec3* z = preconditioned->data();
+			const tvec3* b = rhs->data();
+
+			multiply(x, q);
+			pool->parallelFor(0, n, [&](Ksize begin, Ksize end, Kuint) {
+				for (Ksize i = begin; i < end; ++i) {
+					if (particles->isPinned(i)) x[i].set(0.f);
+					r[i] = b[i] - q[i];
+				}
+			});
+
+			const Kdouble b_norm = dot(b, b);
+			const Kdouble target = b_norm * tolerance * tolerance;
+			Kdouble r_norm = dot(r, r);
+			iterations = 0;
+			if (r_norm <= target) {
+				relative_residual = b_norm > 0.0 ? Kfloat(sqrt(r_norm / b_norm)) : 0.f;
+				return true;
+			}
+
+			precondition(r, z);
+			*direction = *preconditioned;
+			Kdouble rz = dot(r, z);
+			while (iterations < max_iterations) {
+				++iterations;
+				multiply(d, q);
+				const Kdouble dq = dot(d, q);
+				if (dq <= 0.0) break;
+				const Kfloat alpha = Kfloat(rz / dq);
+				pool->parallelFor(0, n, [&](Ksize begin, Ksize end, Kuint) {
+					for (Ksize i = begin; i < end; ++i) {
+						x[i] += d[i] * alpha;
+						r[i] -= q[i] * alpha;
+					}
+				});
+				r_norm = dot(r, r);
+				if (r_norm <= target) break;
+
+				precondition(r, z);
+				const Kdouble rz_next = dot(r, z);
+				const Kfloat beta = Kfloat(rz_next / rz);
+				rz = rz_next;
+				pool->parallelFor(0, n, [&](Ksize begin, Ksize end, Kuint) {
+					for (Ksize i = begin; i < end; ++i) d[i] = z[i] + d[i] * beta;
+				});
+			}
+			relative_residual = b_norm > 0.0 ? Kfloat(sqrt(r_norm / b_norm)) : 0.f;
+			return r_norm <= target;
+		}
+
+		const tvec3* getVelocityChanges()const {
+			return dv->data();
+		}
+
+		//The first guess of the next solve, for a state restored from a checkpoint.
+		tvec3* getFirstGuess() {
+			return dv->data();
+		}
+
+		void setMaxIterations(Kuint max_iterations) {
+			this->max_iterations = max_iterations;
+		}
+
+		Kuint getMaxIterations()const {
+			return max_iterations;
+		}
+
+		//Relative to the norm of the right side.
+		void setTolerance(Kfloat tolerance) {
+			this->tolerance = tolerance;
+		}
+
+		Kfloat getTolerance()const {
+			return tolerance;
+		}
+
+		Kuint getIterations()const {
+			return iterations;
+		}
+
+		Kfloat getResidual()const {
+			return relative_residual;
+		}
+	};
+}
+
+#endif // !IMPLICIT_SOLVER_H
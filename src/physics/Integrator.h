@@ -0,0 +1,18 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef INTEGRATOR_H
+#define INTEGRATOR_H
+
+namespace KPhysics {
+	//How the CPU cloth advances one step.
+	enum Integrator {
+		EXPLICIT_EULER = 0, //trapezoidal explicit Euler, needs small steps for stiff springs
+		IMPLICIT_EULER = 1, //backward Euler solved with preconditioned CG, see ImplicitSolver
+		XPBD = 2, //springs as compliant distance constraints, see XPBDSolver
+		PROJECTIVE = 3 //projective dynamics with a prefactored system, see ProjectiveSolver
+	};
+}
+
+#endif // !INTEGRATOR_H
@@ -0,0 +1,140 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef PARTICLES_H
+#define PARTICLES_H
+
+#include <vector>
+#include <utility>
+#include "../Core.h"
+#include "../math/Vec3.h"
+#include "../util/Checkpoint.h"
+
+namespace KPhysics {
+	using tvec3 = KVector::Vec3;
+
+	//Particle store for the CPU solvers, kept as a structure of arrays.
+	//Every attribute lives in its own contiguous array so that a step can stream
+	//through them linearly instead of chasing one heap object per vertex.
+	class Particles {
+	private:
+		Ksize count;
+
+		std::vector<tvec3>* positions;
+		std::vector<tvec3>* last_positions;
+		std::vector<tvec3>* velocities;
+		std::vector<tvec3>* accelerations;
+		std::vector<Kfloat>* masses;
+		std::vector<Kuint>* pinned; //bitmask, one bit per particle
+
+	public:
+		Particles(Ksize count = 0, Kfloat mass = 1.f) : count(0),
+			positions(nullptr), last_positions(nullptr), velocities(nullptr),
+			accelerations(nullptr), masses(nullptr), pinned(nullptr) {
+			positions = new std::vector<tvec3>();
+			last_positions = new std::vector<tvec3>();
+			velocities = new std::vector<tvec3>();
+			accelerations = new std::vector<tvec3>();
+			masses = new std::vector<Kfloat>();
+			pinned = new std::vector<Kuint>();
+			resize(count, mass);
+		}
+		~Particles() {
+			delete positions;
+			delete last_positions;
+			delete velocities;
+			delete accelerations;
+			delete masses;
+			delete pinned;
+		}
+
+		void resize(Ksize count, Kfloat mass = 1.f) {
+			this->count = count;
+			positions->assign(count, tvec3(0.f));
+			last_positions->assign(count, tvec3(0.f));
+			velocities->assign(count, tvec3(0.f));
+			accelerations->assign(count, tvec3(0.f));
+			masses->assign(count, mass);
+			pinned->assign((count + 31) / 32, 0);
+		}
+
+		Ksize size()const {
+			return count;
+		}
+
+		void setPosition(Ksize index, const tvec3& p) {
+			positions->at(index) = p;
+			last_positions->at(index) = p;
+		}
+
+		void setPinned(Ksize index, Kboolean pin = true) {
+			if (pin) pinned->at(index >> 5) |= 1u << (index & 31);
+			else pinned->at(index >> 5) &= ~(1u << (index & 31));
+		}
+
+		inline Kboolean isPinned(Ksize index)const {
+			return ((*pinned)[index >> 5] >> (index & 31) & 1u) != 0;
+		}
+
+		//Raw arrays for the hot loops.
+		tvec3* getPositions() { return positions->data(); }
+		tvec3* getLastPositions() { return last_positions->data(); }
+		tvec3* getVelocities() { return velocities->data(); }
+		tvec3* getAccelerations() { return accelerations->data(); }
+		Kfloat* getMasses() { return masses->data(); }
+		const Kuint* getPinned()const { return pinned->data(); }
+
+		const tvec3* getPositions()const { return positions->data(); }
+		const tvec3* getLastPositions()const { return last_positions->data(); }
+		const tvec3* getVelocities()const { return velocities->data(); }
+		const tvec3* getAccelerations()const { return accelerations->data(); }
+		const Kfloat* getMasses()const { return masses->data(); }
+
+		void savePositions() {
+			*last_positions = *positions;
+		}
+
+		//Swap in the arrays a solver wrote the next state into,
+		//the old arrays go back to the solver as its next scratch.
+		void swapPositions(std::vector<tvec3>*& next_positions, std::vector<tvec3>*& next_last_positions) {
+			std::swap(positions, next_positions);
+			std::swap(last_positions, next_last_positions);
+		}
+
+		void swapVelocities(std::vector<tvec3>*& next_velocities) {
+			std::swap(velocities, next_velocities);
+		}
+
+		//Every array as its section.
+		void saveState(KCache::Checkpoint* checkpoint)const {
+			checkpoint->put(KCache::POSITIONS, positions->data(), count);
+			checkpoint->put(KCache::LAST_POSITIONS, last_positions->data(), count);
+			checkpoint->put(KCache::VELOCITIES, velocities->data(), count);
+			checkpoint->put(KCache::ACCELERATIONS, accelerations->data(), count);
+			checkpoint->put(KCache::MASSES, masses->data(), count);
+			checkpoint->put(KCache::PINNED, pinned->data(), pinned->size());
+		}
+
+		//Positions and last positions have to be there, the other arrays are kept
+		//when the checkpoint has none (the GPU cloths save only what they simulate).
+		Kboolean loadState(const KCache::Checkpoint& checkpoint) {
+			if (checkpoint.getParticleCount() != count) {
+				std::cerr << "Checkpoint has " << checkpoint.getParticleCount() << " particles, not " << count << std::endl;
+				return false;
+			}
+			if (!checkpoint.get(KCache::POSITIONS, positions->data(), count) ||
+				!checkpoint.get(KCache::LAST_POSITIONS, last_positions->data(), count)) {
+				std::cerr << "Checkpoint has no positions" << std::endl;
+				return false;
+			}
+			checkpoint.get(KCache::VELOCITIES, velocities->data(), count);
+			checkpoint.get(KCache::ACCELERATIONS, accelerations->data(), count);
+			checkpoint.get(KCache::MASSES, masses->data(), count);
+			checkpoint.get(KCache::PINNED, pinned->data(), pinned->size());
+			return true;
+		}
+	};
+}
+
+#endif // !PARTICLES_H
@@ -0,0 +1,420 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef PROJECTIVE_SOLVER_H
+#define PROJECTIVE_SOLVER_H
+
+#include <map>
+#include <mutex>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include "../Core.h"
+#include "../math/Vec3.h"
+#include "../util/ThreadPool.h"
+#include "./Particles.h"
+#include "./Springs.h"
+#include "./SkylineCholesky.h"
+
+namespace KPhysics {
+	using tvec3 = KVector::Vec3;
+
+	//Factored system matrices shared by every ProjectiveSolver in the process,
+	//keyed by a hash of everything the matrix depends on.
+	//Solvers only borrow the factors, they live until clear() or exit.
+	class FactorCache {
+	private:
+		std::mutex mutex;
+		std::map<std::uint64_t, SkylineCholesky*>* factors;
+
+		FactorCache() : factors(nullptr) {
+			factors = new std::map<std::uint64_t, SkylineCholesky*>();
+		}
+
+	public:
+		~FactorCache() {
+			clear();
+			delete factors;
+		}
+
+		static FactorCache& getInstance() {
+			static FactorCache cache;
+			return cache;
+		}
+
+		const SkylineCholesky* find(std::uint64_t key) {
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = factors->find(key);
+			return it == factors->end() ? nullptr : it->second;
+		}
+
+		//Takes the factor, returns the one kept if another solver got there first.
+		const SkylineCholesky* insert(std::uint64_t key, SkylineCholesky* factor) {
+			std::lock_guard<std::mutex> lock(mutex);
+			auto it = factors->find(key);
+			if (it != factors->end()) {
+				delete factor;
+				return it->second;
+			}
+			(*factors)[key] = factor;
+			return factor;
+		}
+
+		//Only when no solver holds a factor any more.
+		void clear() {
+			std::lock_guard<std::mutex> lock(mutex);
+			for (auto& factor : *factors) delete factor.second;
+			factors->clear();
+		}
+	};
+
+	//Projective dynamics (Bouaziz et al. 2014) for the springs, in the mass spring
+	//form of Liu et al. 2013. Each iteration projects every spring to its rest
+	//length (local, in parallel) and solves
+	//	(M / h^2 + L) * x = M / h^2 * y + J * d
+	//(global) where L is the weighted graph Laplacian of the springs.
+	//The matrix only depends on topology, masses, weights and h, so it is factored
+	//once and every iteration is one forward and back substitution per axis.
+	//Factors are cached in process and, with setCacheDirectory, on disk, so runs
+	//on the same grid never factor twice.
+	//Pinned particles are taken out of the system. Like the springs, the
+	//projections only resist stretching.
+	class ProjectiveSolver {
+	private:
+		static const Kfloat EXPSION; //ground offset, same as Cloth
+
+		Particles* particles;
+		const Springs* springs;
+		KThread::ThreadPool* pool;
+
+		Kfloat weights[Springs::TYPE_COUNT];
+		Kuint iterations;
+		Kfloat ground;
+		std::string cache_directory;
+
+		const SkylineCholesky* factor; //owned by FactorCache, nullptr when it has to be found again
+		Kfloat factor_step; //h of factor
+
+		std::vector<Kint>* rows; //row of every particle in the system, -1 when pinned
+		std::vector<Kuint>* row_particles;
+		std::vector<Kuint>* adjacency_offsets; //springs of particle i are [offsets[i], offsets[i + 1])
+		std::vector<Kuint>* adjacency;
+		std::vector<tvec3>* projections; //one per spring
+		std::vector<tvec3>* inertia; //y = x + h * v + h^2 * f / m
+		std::vector<Kdouble>* rhs; //x, y, z interleaved per row
+		std::vector<Kdouble>* scratch; //of the solves, one row count per axis
+
+		Kboolean isFree(Ksize i)const {
+			return !particles->isPinned(i) && particles->getMasses()[i] > 0.f;
+		}
+
+		//FNV-1a over everything the matrix is made of.
+		static void hash(std::uint64_t& key, const void* data, Ksize bytes) {
+			const Kubyte* p = static_cast<const Kubyte*>(data);
+			for (Ksize k = 0; k < bytes; ++k) {
+				key ^= p[k];
+				key *= 1099511628211ull;
+			}
+		}
+
+		std::uint64_t calKey(Kfloat h)const {
+			std::uint64_t key = 14695981039346656037ull;
+			const Ksize n = particles->size();
+			const Ksize count = springs->size();
+			hash(key, &n, sizeof(n));
+			hash(key, &count, sizeof(count));
+			hash(key, &h, sizeof(h));
+			hash(key, weights, sizeof(weights));
+			hash(key, rows->data(), n * sizeof(Kint));
+			hash(key, particles->getMasses(), n * sizeof(Kfloat));
+			hash(key, springs->getFirst(), count * sizeof(Kuint));
+			hash(key, springs->getSecond(), count * sizeof(Kuint));
+			hash(key, springs->getTypes(), count * sizeof(Kubyte));
+			return key;
+		}
+
+		std::string getCachePath(std::uint64_t key)const {
+			char name[32];
+			snprintf(name, sizeof(name), "pd_%016llx.bin", (unsigned long long)key);
+			return cache_directory + name;
+		}
+
+		SkylineCholesky* factorize(Kfloat h)const {
+			const Ksize free_count = row_particles->size();
+			const Kuint* a = springs->getFirst();
+			const Kuint* b = springs->getSecond();
+			const Kubyte* type = springs->getTypes();
+			const Kint* r = rows->data();
+
+			std::vector<Kuint> first_columns(free_count);
+			for (Ksize k = 0; k < free_count; ++k) first_columns[k] = k;
+			for (Ksize k = 0; k < springs->size(); ++k) {
+				const Kint i = r[a[k]], j = r[b[k]];
+				if (i < 0 || j < 0) continue;
+				if (i > j && Kuint(j) < first_columns[i]) first_columns[i] = j;
+				if (j > i && Kuint(i) < first_columns[j]) first_columns[j] = i;
+			}
+
+			SkylineCholesky* matrix = new SkylineCholesky();
+			matrix->setPattern(free_count, first_columns);
+			const Kfloat* m = particles->getMasses();
+			const Kdouble inv_h2 = 1.0 / (Kdouble(h) * h);
+			for (Ksize k = 0; k < free_count; ++k) {
+				matrix->at(k, k) = m[(*row_particles)[k]] * inv_h2;
+			}
+			for (Ksize k = 0; k < springs->size(); ++k) {
+				const Kint i = r[a[k]], j = r[b[k]];
+				const Kdouble w = weights[type[k]];
+				if (i >= 0) matrix->at(i, i) += w;
+				if (j >= 0) matrix->at(j, j) += w;
+				if (i >= 0 && j >= 0) {
+					if (i > j) matrix->at(i, j) -= w;
+					else matrix->at(j, i) -= w;
+				}
+			}
+			if (!matrix->factorize()) {
+				delete matrix;
+				return nullptr;
+			}
+			return matrix;
+		}
+
+		//To a .tmp file first and then over the cached one, so a run stopped in the
+		//middle of a write never leaves a truncated factor that is loaded next time.
+		void saveFactor(const SkylineCholesky* built, std::uint64_t key)const {
+			const std::string path(getCachePath(key));
+			const std::string tmp(path + ".tmp");
+			Kboolean saved = false;
+			{
+				std::ofstream out(tmp, std::ios::binary | std::ios::trunc);
+				saved = out.is_open() && built->save(out, key) && out.flush();
+			}
+			if (!saved || !replaceFile(tmp, path)) {
+				remove(tmp.data());
+				std::cerr << "Can't save factorization at: " << path << std::endl;
+			}
+		}
+
+		//Find or build the factor for h. The key is only hashed when h changed or
+		//rebuild or setWeight dropped the factor, not on every step.
+		Kboolean prepare(Kfloat h) {
+			if (factor != nullptr && h == factor_step) return true;
+			const std::uint64_t key = calKey(h);
+
+			FactorCache& cache = FactorCache::getInstance();
+			factor = cache.find(key);
+			if (factor == nullptr && !cache_directory.empty()) {
+				std::ifstream in(getCachePath(key), std::ios::binary);
+				if (in.is_open()) {
+					SkylineCholesky* loaded = new SkylineCholesky();
+					if (loaded->load(in, key) && loaded->size() == row_particles->size()) {
+						factor = cache.insert(key, loaded);
+					}
+					else {
+						delete loaded;
+					}
+				}
+			}
+			if (factor == nullptr) {
+				SkylineCholesky* built = factorize(h);
+				if (built == nullptr) {
+					std::cerr << "Factorization failed!" << std::endl;
+					return false;
+				}
+				if (!cache_directory.empty()) saveFactor(built, key);
+				factor = cache.insert(key, built);
+			}
+			factor_step = h;
+			return true;
+		}
+
+	public:
+		ProjectiveSolver(Particles* particles, const Springs* springs, KThread::ThreadPool* pool) :
+			particles(particles), springs(springs), pool(pool), iterations(10), ground(0.f),
+			factor(nullptr), factor_step(0.f), rows(nullptr), row_particles(nullptr),
+			adjacency_offsets(nullptr), adjacency(nullptr), projections(nullptr),
+			inertia(nullptr), rhs(nullptr), scratch(nullptr) {
+			rows = new std::vector<Kint>();
+			row_particles = new std::vector<Kuint>();
+			adjacency_offsets = new std::vector<Kuint>();
+			adjacency = new std::vector<Kuint>();
+			projections = new std::vector<tvec3>();
+			inertia = new std::vector<tvec3>();
+			rhs = new std::vector<Kdouble>();
+			scratch = new std::vector<Kdouble>();
+			//the spring stiffness is the projection weight
+			for (Kuint t = 0; t < Springs::TYPE_COUNT; ++t) {
+				weights[t] = springs->getKs(SpringType(t));
+			}
+			rebuild();
+		}
+		~ProjectiveSolver() {
+			delete rows;
+			delete row_particles;
+			delete adjacency_offsets;
+			delete adjacency;
+			delete projections;
+			delete inertia;
+			delete rhs;
+			delete scratch;
+		}
+
+		//Call again when particles, masses, pins or springs change.
+		void rebuild() {
+			const Ksize n = particles->size();
+			rows->assign(n, -1);
+			row_particles->clear();
+			for (Ksize i = 0; i < n; ++i) {
+				if (!isFree(i)) continue;
+				(*rows)[i] = row_particles->size();
+				row_particles->emplace_back(i);
+			}
+
+			const Kuint* a = springs->getFirst();
+			const Kuint* b = springs->getSecond();
+			adjacency_offsets->assign(n + 1, 0);
+			for (Ksize k = 0; k < springs->size(); ++k) {
+				++(*adjacency_offsets)[a[k] + 1];
+				++(*adjacency_offsets)[b[k] + 1];
+			}
+			for (Ksize i = 0; i < n; ++i) (*adjacency_offsets)[i + 1] += (*adjacency_offsets)[i];
+			adjacency->resize(springs->size() * 2);
+			std::vector<Kuint> next(adjacency_offsets->begin(), adjacency_offsets->end() - 1);
+			for (Ksize k = 0; k < springs->size(); ++k) {
+				(*adjacency)[next[a[k]]++] = k;
+				(*adjacency)[next[b[k]]++] = k;
+			}
+
+			projections->assign(springs->size(), tvec3(0.f));
+			inertia->assign(n, tvec3(0.f));
+			rhs->assign(row_particles->size() * 3, 0.0);
+			scratch->assign(row_particles->size() * 3, 0.0);
+			factor = nullptr;
+		}
+
+		//Changing a weight needs a new factor, it is found or built on the next step.
+		void setWeight(SpringType type, Kfloat weight) {
+			if (weights[type] != weight) factor = nullptr;
+			weights[type] = weight;
+		}
+
+		Kfloat getWeight(SpringType type)const {
+			return weights[type];
+		}
+
+		void setIterations(Kuint iterations) {
+			this->iterations = iterations > 0 ? iterations : 1;
+		}
+
+		Kuint getIterations()const {
+			return iterations;
+		}
+
+		//Factors are read from and written to this directory, empty turns it off.
+		void setCacheDirectory(const std::string& directory) {
+			cache_directory = directory;
+			if (!cache_directory.empty() && cache_directory.back() != '/' && cache_directory.back() != '\\') {
+				cache_directory += '/';
+			}
+		}
+
+		void setGround(Kfloat ground) {
+			this->ground = ground;
+		}
+
+		//Advance by h. forces are the external forces (gravity, wind, drag).
+		Kboolean step(Kfloat h, const tvec3* forces) {
+			if (!prepare(h)) return false;
+
+			const Ksize n = particles->size();
+			const Ksize free_count = row_particles->size();
+			tvec3* p = particles->getPositions();
+			tvec3* last_p = particles->getLastPositions();
+			tvec3* v = particles->getVelocities();
+			const Kfloat* m = particles->getMasses();
+			const Kint* r = rows->data();
+			const Kuint* rp = row_particles->data();
+			const Kuint* a = springs->getFirst();
+			const Kuint* b = springs->getSecond();
+			const Kfloat* rest = springs->getRestLengths();
+			const Kubyte* type = springs->getTypes();
+			const Kuint* offsets = adjacency_offsets->data();
+			const Kuint* adj = adjacency->data();
+			tvec3* d = projections->data();
+			tvec3* y = inertia->data();
+			Kdouble* x = rhs->data();
+			Kdouble* solve_x = scratch->data();
+			const Kfloat h2 = h * h;
+			const Kdouble inv_h2 = 1.0 / (Kdouble(h) * h);
+
+			pool->parallelFor(0, n, [&](Ksize begin, Ksize end, Kuint) {
+				for (Ksize i = begin; i < end; ++i) {
+					last_p[i] = p[i];
+					if (r[i] < 0) continue;
+					y[i] = p[i] + v[i] * h + forces[i] * (h2 / m[i]);
+					p[i] = y[i];
+				}
+			});
+
+			for (Kuint it = 0; it < iterations; ++it) {
+				//local: closest rest length configuration of every spring
+				pool->parallelFor(0, springs->size(), [&](Ksize begin, Ksize end, Kuint) {
+					for (Ksize k = begin; k < end; ++k) {
+						d[k] = p[a[k]] - p[b[k]];
+						const Kfloat len = d[k].length<Kfloat>();
+						if (len > rest[k]) d[k] *= rest[k] / len;
+					}
+				});
+
+				//global: right side per row, then one solve per axis
+				pool->parallelFor(0, free_count, [&](Ksize begin, Ksize end, Kuint) {
+					for (Ksize k = begin; k < end; ++k) {
+						const Kuint i = rp[k];
+						Kdouble sx = m[i] * inv_h2 * y[i].x;
+						Kdouble sy = m[i] * inv_h2 * y[i].y;
+						Kdouble sz = m[i] * inv_h2 * y[i].z;
+						for (Kuint e = offsets[i]; e < offsets[i + 1]; ++e) {
+							const Kuint s = adj[e];
+							const Kuint other = a[s] == i ? b[s] : a[s];
+							const Kdouble w = weights[type[s]];
+							tvec3 t(a[s] == i ? d[s] : -d[s]);
+							if (r[other] < 0) t += p[other];
+							sx += w * t.x;
+							sy += w * t.y;
+							sz += w * t.z;
+						}
+						x[k * 3] = sx;
+						x[k * 3 + 1] = sy;
+						x[k * 3 + 2] = sz;
+					}
+				});
+				pool->parallelFor(0, 3, [&](Ksize begin, Ksize end, Kuint) {
+					for (Ksize axis = begin; axis < end; ++axis) {
+						factor->solve(x + axis, 3, solve_x + axis * free_count);
+					}
+				}, false, 1);
+				pool->parallelFor(0, free_count, [&](Ksize begin, Ksize end, Kuint) {
+					for (Ksize k = begin; k < end; ++k) {
+						p[rp[k]].set(Kfloat(x[k * 3]), Kfloat(x[k * 3 + 1]), Kfloat(x[k * 3 + 2]));
+					}
+				});
+			}
+
+			pool->parallelFor(0, n, [&](Ksize begin, Ksize end, Kuint) {
+				for (Ksize i = begin; i < end; ++i) {
+					if (r[i] < 0) {
+						v[i].set(0.f);
+						continue;
+					}
+					if (p[i].y < ground) p[i].y = ground + EXPSION;
+					v[i] = (p[i] - last_p[i]) / h;
+				}
+			});
+			return true;
+		}
+	};
+}
+
+#endif // !PROJECTIVE_SOLVER_H
@@ -0,0 +1,159 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef SKYLINE_CHOLESKY_H
+#define SKYLINE_CHOLESKY_H
+
+#include <vector>
+#include <cstdint>
+#include <iostream>
+#include "../Core.h"
+
+namespace KPhysics {
+	//Sparse symmetric positive definite matrix in skyline (envelope) storage,
+	//factored in place as L * D * L^T, all in doubles.
+	//Row i keeps columns [first[i], i], the fill of the factorization stays in
+	//that envelope. Grids numbered row by row have an envelope of about two grid
+	//rows, so cost is n * width^2 to factor and n * width per solve.
+	class SkylineCholesky {
+	private:
+		static const Kuint FILE_MAGIC = 0x4C44534B; //"KSDL"
+		static const Kuint FILE_VERSION = 1;
+
+		Ksize rows;
+		std::vector<Kuint>* first; //first column stored in row i
+		std::vector<Ksize>* offsets; //row i starts at offsets[i], its diagonal is at offsets[i + 1] - 1
+		std::vector<Kdouble>* values;
+		Kboolean factored;
+
+	public:
+		SkylineCholesky() : rows(0), first(nullptr), offsets(nullptr), values(nullptr), factored(false) {
+			first = new std::vector<Kuint>();
+			offsets = new std::vector<Ksize>();
+			values = new std::vector<Kdouble>();
+		}
+		~SkylineCholesky() {
+			delete first;
+			delete offsets;
+			delete values;
+		}
+
+		//first_columns[i] <= i is the leftmost non zero of row i, all entries start at zero.
+		void setPattern(Ksize rows, const std::vector<Kuint>& first_columns) {
+			this->rows = rows;
+			*first = first_columns;
+			offsets->resize(rows + 1);
+			(*offsets)[0] = 0;
+			for (Ksize i = 0; i < rows; ++i) {
+				(*offsets)[i + 1] = (*offsets)[i] + (i - (*first)[i] + 1);
+			}
+			values->assign((*offsets)[rows], 0.0);
+			factored = false;
+		}
+
+		Ksize size()const {
+			return rows;
+		}
+
+		Ksize getEntryCount()const {
+			return values->size();
+		}
+
+		Kboolean isFactored()const {
+			return factored;
+		}
+
+		//Entry (i, j) with first[i] <= j <= i.
+		Kdouble& at(Ksize i, Ksize j) {
+			return (*values)[(*offsets)[i] + j - (*first)[i]];
+		}
+
+		//In place L * D * L^T, L has a unit diagonal and D takes its place.
+		//Returns false when a pivot is not positive, the matrix is not positive definite then.
+		Kboolean factorize() {
+			Kdouble* v = values->data();
+			const Kuint* f = first->data();
+			const Ksize* o = offsets->data();
+			for (Ksize i = 0; i < rows; ++i) {
+				Kdouble* row = v + o[i] - f[i]; //row[j] is entry (i, j)
+				//row[j] becomes g_j = L(i, j) * D(j)
+				for (Ksize j = f[i]; j < i; ++j) {
+					const Kdouble* other = v + o[j] - f[j];
+					const Ksize k0 = f[i] > f[j] ? f[i] : f[j];
+					Kdouble sum = row[j];
+					for (Ksize k = k0; k < j; ++k) sum -= row[k] * other[k];
+					row[j] = sum;
+				}
+				Kdouble d = row[i];
+				for (Ksize j = f[i]; j < i; ++j) {
+					const Kdouble l = row[j] / v[o[j + 1] - 1];
+					d -= row[j] * l;
+					row[j] = l;
+				}
+				if (!(d > 0.0)) {
+					std::cerr << "Matrix is not positive definite at row " << i << "!" << std::endl;
+					factored = false;
+					return false;
+				}
+				row[i] = d;
+			}
+			factored = true;
+			return true;
+		}
+
+		//Solve A * x = b in place, b is read with stride (so one of x, y, z can be solved
+		//straight from an interleaved array). x is scratch of size() values from the caller,
+		//a factor is shared by solvers solving on many threads so it keeps none itself.
+		template <typename T>
+		void solve(T* b, Ksize stride, Kdouble* x)const {
+			const Kdouble* v = values->data();
+			const Kuint* f = first->data();
+			const Ksize* o = offsets->data();
+			for (Ksize i = 0; i < rows; ++i) {
+				const Kdouble* row = v + o[i] - f[i];
+				Kdouble sum = b[i * stride];
+				for (Ksize k = f[i]; k < i; ++k) sum -= row[k] * x[k];
+				x[i] = sum;
+			}
+			for (Ksize i = 0; i < rows; ++i) x[i] /= v[o[i + 1] - 1];
+			for (Ksize i = rows; i-- > 0;) {
+				const Kdouble* row = v + o[i] - f[i];
+				const Kdouble xi = x[i];
+				for (Ksize k = f[i]; k < i; ++k) x[k] -= row[k] * xi;
+			}
+			for (Ksize i = 0; i < rows; ++i) b[i * stride] = T(x[i]);
+		}
+
+		//The factor, with a key so a stale file is never taken for another matrix.
+		Kboolean save(std::ostream& out, std::uint64_t key)const {
+			if (!factored) return false;
+			const Kuint header[3] = { FILE_MAGIC, FILE_VERSION, rows };
+			out.write(reinterpret_cast<const char*>(header), sizeof(header));
+			out.write(reinterpret_cast<const char*>(&key), sizeof(key));
+			out.write(reinterpret_cast<const char*>(first->data()), rows * sizeof(Kuint));
+			out.write(reinterpret_cast<const char*>(values->data()), values->size() * sizeof(Kdouble));
+			return out.good();
+		}
+
+		Kboolean load(std::istream& in, std::uint64_t key) {
+			Kuint header[3];
+			std::uint64_t file_key = 0;
+			in.read(reinterpret_cast<char*>(header), sizeof(header));
+			in.read(reinterpret_cast<char*>(&file_key), sizeof(file_key));
+			if (!in || header[0] != FILE_MAGIC || header[1] != FILE_VERSION || file_key != key) return false;
+			std::vector<Kuint> columns(header[2]);
+			in.read(reinterpret_cast<char*>(columns.data()), columns.size() * sizeof(Kuint));
+			if (!in) return false;
+			for (Ksize i = 0; i < columns.size(); ++i) {
+				if (columns[i] > i) return false;
+			}
+			setPattern(header[2], columns);
+			in.read(reinterpret_cast<char*>(values->data()), values->size() * sizeof(Kdouble));
+			factored = in.good();
+			return factored;
+		}
+	};
+}
+
+#endif // !SKYLINE_CHOLESKY_H
@@ -0,0 +1,224 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef SPRING_KERNEL_H
+#define SPRING_KERNEL_H
+
+#include <cmath>
+#include "../Core.h"
+#include "../math/Vec3.h"
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__x86_64__) || defined(__i386__)
+#define KSIMD_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#define KSIMD_AVX2_FUNC
+#define KSIMD_SSE_FUNC
+#else
+#include <cpuid.h>
+#define KSIMD_AVX2_FUNC __attribute__((target("avx2")))
+#define KSIMD_SSE_FUNC __attribute__((target("sse2")))
+#endif
+#endif
+
+namespace KPhysics {
+	using tvec3 = KVector::Vec3;
+
+	enum SpringBackend {
+		SCALAR, //per spring Vec3 math
+		SIMD //batched float kernel, AVX2 (8 springs) or SSE (4 springs) chosen at run time
+	};
+
+	enum SimdLevel {
+		SIMD_NONE, SIMD_SSE, SIMD_AVX2
+	};
+
+	//Raw spring arrays handed to the kernels, ks and kd are indexed by spring type.
+	struct SpringData {
+		const Kuint* first;
+		const Kuint* second;
+		const Kfloat* rest_lengths;
+		const Kubyte* types;
+		const Kfloat* ks;
+		const Kfloat* kd;
+	};
+
+	//Batched spring force kernel.
+	//Same force as Springs::accumulateForces, but in float with an rsqrt plus one
+	//Newton step instead of sqrt and divide. Forces of a batch are computed in
+	//registers and scattered to the particles one by one.
+	class SpringKernel {
+	private:
+		static SimdLevel detect() {
+#ifdef KSIMD_X86
+#ifdef _MSC_VER
+			int info[4];
+			__cpuid(info, 0);
+			const int max_leaf = info[0];
+			__cpuid(info, 1);
+			const Kboolean sse2 = (info[3] >> 26 & 1) != 0;
+			const Kboolean avx = (info[2] >> 28 & 1) != 0 && (info[2] >> 27 & 1) != 0 &&
+				(_xgetbv(0) & 6) == 6; //the os saves ymm registers
+			Kboolean avx2 = false;
+			if (avx && max_leaf >= 7) {
+				__cpuidex(info, 7, 0);
+				avx2 = (info[1] >> 5 & 1) != 0;
+			}
+			if (avx2) return SIMD_AVX2;
+			if (sse2) return SIMD_SSE;
+#else
+			__builtin_cpu_init();
+			if (__builtin_cpu_supports("avx2")) return SIMD_AVX2;
+			if (__builtin_cpu_supports("sse2")) return SIMD_SSE;
+#endif
+#endif
+			return SIMD_NONE;
+		}
+
+		static void accumulateScalar(const SpringData& s, const tvec3* p, const tvec3* v,
+			tvec3* forces, Ksize begin, Ksize end) {
+			for (Ksize k = begin; k < end; ++k) {
+				const Kuint i = s.first[k], j = s.second[k];
+				const Kfloat dx = p[i].x - p[j].x, dy = p[i].y - p[j].y, dz = p[i].z - p[j].z;
+				const Kfloat len2 = dx * dx + dy * dy + dz * dz;
+				if (len2 <= s.rest_lengths[k] * s.rest_lengths[k]) continue;
+				const Kfloat inv = 1.f / std::sqrt(len2);
+				const Kfloat nx = dx * inv, ny = dy * inv, nz = dz * inv;
+				const Kfloat dot = nx * (v[i].x - v[j].x) + ny * (v[i].y - v[j].y) + nz * (v[i].z - v[j].z);
+				const Kfloat f = s.ks[s.types[k]] * (len2 * inv - s.rest_lengths[k]) + s.kd[s.types[k]] * dot;
+				const tvec3 df(nx * f, ny * f, nz * f);
+				forces[i] -= df;
+				forces[j] += df;
+			}
+		}
+
+		static void scatter(const SpringData& s, tvec3* forces, Ksize k, Kuint width,
+			const Kfloat* fx, const Kfloat* fy, const Kfloat* fz) {
+			for (Kuint l = 0; l < width; ++l) {
+				const tvec3 df(fx[l], fy[l], fz[l]);
+				forces[s.first[k + l]] -= df;
+				forces[s.second[k + l]] += df;
+			}
+		}
+
+#ifdef KSIMD_X86
+		KSIMD_SSE_FUNC
+		static void accumulateSSE(const SpringData& s, const tvec3* p, const tvec3* v,
+			tvec3* forces, Ksize begin, Ksize end) {
+			alignas(16) Kfloat fx[4], fy[4], fz[4];
+			const __m128 half = _mm_set1_ps(0.5f), three_half = _mm_set1_ps(1.5f);
+			Ksize k = begin;
+			for (; k + 4 <= end; k += 4) {
+				const Kuint* a = s.first + k;
+				const Kuint* b = s.second + k;
+				const Kubyte* t = s.types + k;
+#define KSIMD_LOAD4(arr, idx, c) _mm_set_ps(arr[idx[3]].c, arr[idx[2]].c, arr[idx[1]].c, arr[idx[0]].c)
+				const __m128 dx = _mm_sub_ps(KSIMD_LOAD4(p, a, x), KSIMD_LOAD4(p, b, x));
+				const __m128 dy = _mm_sub_ps(KSIMD_LOAD4(p, a, y), KSIMD_LOAD4(p, b, y));
+				const __m128 dz = _mm_sub_ps(KSIMD_LOAD4(p, a, z), KSIMD_LOAD4(p, b, z));
+				const __m128 vx = _mm_sub_ps(KSIMD_LOAD4(v, a, x), KSIMD_LOAD4(v, b, x));
+				const __m128 vy = _mm_sub_ps(KSIMD_LOAD4(v, a, y), KSIMD_LOAD4(v, b, y));
+				const __m128 vz = _mm_sub_ps(KSIMD_LOAD4(v, a, z), KSIMD_LOAD4(v, b, z));
+#undef KSIMD_LOAD4
+				const __m128 rest = _mm_loadu_ps(s.rest_lengths + k);
+				const __m128 ks = _mm_set_ps(s.ks[t[3]], s.ks[t[2]], s.ks[t[1]], s.ks[t[0]]);
+				const __m128 kd = _mm_set_ps(s.kd[t[3]], s.kd[t[2]], s.kd[t[1]], s.kd[t[0]]);
+
+				const __m128 len2 = _mm_add_ps(_mm_add_ps(_mm_mul_ps(dx, dx), _mm_mul_ps(dy, dy)), _mm_mul_ps(dz, dz));
+				__m128 inv = _mm_rsqrt_ps(len2);
+				inv = _mm_mul_ps(inv, _mm_sub_ps(three_half, _mm_mul_ps(_mm_mul_ps(half, len2), _mm_mul_ps(inv, inv))));
+				const __m128 delta = _mm_sub_ps(_mm_mul_ps(len2, inv), rest);
+				const __m128 mask = _mm_cmpgt_ps(delta, _mm_setzero_ps());
+				if (_mm_movemask_ps(mask) == 0) continue;
+				const __m128 nx = _mm_mul_ps(dx, inv), ny = _mm_mul_ps(dy, inv), nz = _mm_mul_ps(dz, inv);
+				const __m128 dot = _mm_add_ps(_mm_add_ps(_mm_mul_ps(nx, vx), _mm_mul_ps(ny, vy)), _mm_mul_ps(nz, vz));
+				const __m128 f = _mm_add_ps(_mm_mul_ps(ks, delta), _mm_mul_ps(kd, dot));
+				_mm_store_ps(fx, _mm_and_ps(mask, _mm_mul_ps(nx, f)));
+				_mm_store_ps(fy, _mm_and_ps(mask, _mm_mul_ps(ny, f)));
+				_mm_store_ps(fz, _mm_and_ps(mask, _mm_mul_ps(nz, f)));
+				scatter(s, forces, k, 4, fx, fy, fz);
+			}
+			accumulateScalar(s, p, v, forces, k, end);
+		}
+
+		KSIMD_AVX2_FUNC
+		static void accumulateAVX2(const SpringData& s, const tvec3* p, const tvec3* v,
+			tvec3* forces, Ksize begin, Ksize end) {
+			alignas(32) Kfloat fx[8], fy[8], fz[8];
+			const __m256 half = _mm256_set1_ps(0.5f), three_half = _mm256_set1_ps(1.5f);
+			const Kfloat* pf = &p[0].x;
+			const Kfloat* vf = &v[0].x;
+			Ksize k = begin;
+			for (; k + 8 <= end; k += 8) {
+				__m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s.first + k));
+				__m256i b = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s.second + k));
+				a = _mm256_add_epi32(a, _mm256_add_epi32(a, a)); //Vec3 is 3 floats
+				b = _mm256_add_epi32(b, _mm256_add_epi32(b, b));
+				const __m256i t = _mm256_cvtepu8_epi32(_mm_loadl_epi64(reinterpret_cast<const __m128i*>(s.types + k)));
+
+				const __m256 dx = _mm256_sub_ps(_mm256_i32gather_ps(pf, a, 4), _mm256_i32gather_ps(pf, b, 4));
+				const __m256 dy = _mm256_sub_ps(_mm256_i32gather_ps(pf + 1, a, 4), _mm256_i32gather_ps(pf + 1, b, 4));
+				const __m256 dz = _mm256_sub_ps(_mm256_i32gather_ps(pf + 2, a, 4), _mm256_i32gather_ps(pf + 2, b, 4));
+				const __m256 vx = _mm256_sub_ps(_mm256_i32gather_ps(vf, a, 4), _mm256_i32gather_ps(vf, b, 4));
+				const __m256 vy = _mm256_sub_ps(_mm256_i32gather_ps(vf + 1, a, 4), _mm256_i32gather_ps(vf + 1, b, 4));
+				const __m256 vz = _mm256_sub_ps(_mm256_i32gather_ps(vf + 2, a, 4), _mm256_i32gather_ps(vf + 2, b, 4));
+				const __m256 rest = _mm256_loadu_ps(s.rest_lengths + k);
+				const __m256 ks = _mm256_i32gather_ps(s.ks, t, 4);
+				const __m256 kd = _mm256_i32gather_ps(s.kd, t, 4);
+
+				const __m256 len2 = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(dx, dx), _mm256_mul_ps(dy, dy)), _mm256_mul_ps(dz, dz));
+				__m256 inv = _mm256_rsqrt_ps(len2);
+				inv = _mm256_mul_ps(inv, _mm256_sub_ps(three_half, _mm256_mul_ps(_mm256_mul_ps(half, len2), _mm256_mul_ps(inv, inv))));
+				const __m256 delta = _mm256_sub_ps(_mm256_mul_ps(len2, inv), rest);
+				const __m256 mask = _mm256_cmp_ps(delta, _mm256_setzero_ps(), _CMP_GT_OQ);
+				if (_mm256_movemask_ps(mask) == 0) continue;
+				const __m256 nx = _mm256_mul_ps(dx, inv), ny = _mm256_mul_ps(dy, inv), nz = _mm256_mul_ps(dz, inv);
+				const __m256 dot = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(nx, vx), _mm256_mul_ps(ny, vy)), _mm256_mul_ps(nz, vz));
+				const __m256 f = _mm256_add_ps(_mm256_mul_ps(ks, delta), _mm256_mul_ps(kd, dot));
+				//masking the products also clears the NaN of zero length springs
+				_mm256_store_ps(fx, _mm256_and_ps(mask, _mm256_mul_ps(nx, f)));
+				_mm256_store_ps(fy, _mm256_and_ps(mask, _mm256_mul_ps(ny, f)));
+				_mm256_store_ps(fz, _mm256_and_ps(mask, _mm256_mul_ps(nz, f)));
+				scatter(s, forces, k, 8, fx, fy, fz);
+			}
+			accumulateSSE(s, p, v, forces, k, end);
+		}
+#endif
+
+	public:
+		static SimdLevel getLevel() {
+			static const SimdLevel level = detect();
+			return level;
+		}
+
+		static const char* getLevelName() {
+			switch (getLevel()) {
+			case SIMD_AVX2: return "AVX2";
+			case SIMD_SSE: return "SSE";
+			default: return "scalar";
+			}
+		}
+
+		//Add the forces of springs [begin, end) into forces.
+		static void accumulate(const SpringData& s, const tvec3* p, const tvec3* v,
+			tvec3* forces, Ksize begin, Ksize end) {
+#ifdef KSIMD_X86
+			switch (getLevel()) {
+			case SIMD_AVX2:
+				accumulateAVX2(s, p, v, forces, begin, end);
+				return;
+			case SIMD_SSE:
+				accumulateSSE(s, p, v, forces, begin, end);
+				return;
+			default:
+				break;
+			}
+#endif
+			accumulateScalar(s, p, v, forces, begin, end);
+		}
+	};
+}
+
+#endif // !SPRING_KERNEL_H
@@ -0,0 +1,276 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef SPRINGS_H
+#define SPRINGS_H
+
+#include <vector>
+#include <cmath>
+#include "../Core.h"
+#include "../math/Vec3.h"
+#include "../util/ThreadPool.h"
+#include "./SpringKernel.h"
+
+namespace KPhysics {
+	using tvec3 = KVector::Vec3;
+
+	enum SpringType {
+		STRUCTURAL = 0, SHEAR = 1, BEND = 2
+	};
+
+	//Flat spring list, every spring is stored once with both end points.
+	//Forces are evaluated once per spring and scattered to the two end points
+	//with opposite sign.
+	//Springs are sorted by color: no two springs of one color share an end point,
+	//so the springs of a color can scatter from many threads without atomics.
+	class Springs {
+	public:
+		static const Kuint TYPE_COUNT = 3;
+		static const Kuint MAX_COLORS = 32;
+
+	private:
+		std::vector<Kuint>* first;
+		std::vector<Kuint>* second;
+		std::vector<Kfloat>* rest_lengths;
+		std::vector<Kubyte>* types;
+		std::vector<Kuint>* color_offsets; //springs of color c are [offsets[c], offsets[c + 1])
+
+		//per thread forces for the non deterministic parallel path, all zero between calls
+		mutable std::vector<tvec3>* thread_forces;
+
+		Kfloat ks[TYPE_COUNT];
+		Kfloat kd[TYPE_COUNT];
+
+		SpringBackend backend;
+
+		template <typename T>
+		static void reorder(std::vector<T>* values, const std::vector<Kuint>& order) {
+			std::vector<T> tmp(values->size());
+			for (Ksize k = 0; k < order.size(); ++k) tmp[k] = (*values)[order[k]];
+			values->swap(tmp);
+		}
+
+		void accumulateForces(const tvec3* p, const tvec3* v, tvec3* forces,
+			Ksize begin, Ksize end)const {
+			if (backend == SIMD) {
+				SpringKernel::accumulate(getData(), p, v, forces, begin, end);
+				return;
+			}
+			const Kuint* a = first->data();
+			const Kuint* b = second->data();
+			const Kfloat* rest = rest_lengths->data();
+			const Kubyte* type = types->data();
+			for (Ksize k = begin; k < end; ++k) {
+				const Kuint i = a[k], j = b[k];
+				tvec3 dp(p[i] - p[j]);
+				const Kfloat len = dp.length<Kfloat>();
+				const Kfloat delta_length = len - rest[k];
+				if (delta_length <= 0.f) continue;
+				dp /= len;
+				dp *= ks[type[k]] * delta_length + kd[type[k]] * dp.dot<Kfloat>(v[i] - v[j]);
+				forces[i] -= dp;
+				forces[j] += dp;
+			}
+		}
+
+	public:
+		Springs() : first(nullptr), second(nullptr), rest_lengths(nullptr), types(nullptr),
+			color_offsets(nullptr), thread_forces(nullptr), backend(SCALAR) {
+			first = new std::vector<Kuint>();
+			second = new std::vector<Kuint>();
+			rest_lengths = new std::vector<Kfloat>();
+			types = new std::vector<Kubyte>();
+			color_offsets = new std::vector<Kuint>();
+			thread_forces = new std::vector<tvec3>();
+			for (Kuint i = 0; i < TYPE_COUNT; ++i) {
+				ks[i] = 0.f;
+				kd[i] = 0.f;
+			}
+		}
+		~Springs() {
+			delete first;
+			delete second;
+			delete rest_lengths;
+			delete types;
+			delete color_offsets;
+			delete thread_forces;
+		}
+
+		void clear() {
+			first->clear();
+			second->clear();
+			rest_lengths->clear();
+			types->clear();
+			color_offsets->clear();
+		}
+
+		void reserve(Ksize n) {
+			first->reserve(n);
+			second->reserve(n);
+			rest_lengths->reserve(n);
+			types->reserve(n);
+		}
+
+		void addSpring(Kuint one, Kuint other, Kfloat rest, SpringType type = STRUCTURAL) {
+			first->emplace_back(one);
+			second->emplace_back(other);
+			rest_lengths->emplace_back(rest);
+			types->emplace_back(static_cast<Kubyte>(type));
+		}
+
+		//Build the springs of a size_x * size_y row-major grid, every pair only once.
+		//mask is a bit set of (1 << SpringType).
+		void generateGrid(Ksize size_x, Ksize size_y, Kfloat rest_x, Kfloat rest_y,
+			Kuint mask = (1 << STRUCTURAL) | (1 << SHEAR) | (1 << BEND)) {
+			clear();
+			reserve(size_x * size_y * 6);
+			const Kfloat diag_length = sqrt(rest_x * rest_x + rest_y * rest_y);
+			for (Ksize i = 0; i < size_y; ++i) {
+				for (Ksize j = 0; j < size_x; ++j) {
+					const Kuint index = i * size_x + j;
+					if (mask & (1 << STRUCTURAL)) {
+						if (j < size_x - 1) addSpring(index, index + 1, rest_x, STRUCTURAL);
+						if (i < size_y - 1) addSpring(index, index + size_x, rest_y, STRUCTURAL);
+					}
+					if (mask & (1 << SHEAR) && i < size_y - 1) {
+						if (j < size_x - 1) addSpring(index, index + size_x + 1, diag_length, SHEAR);
+						if (j > 0) addSpring(index, index + size_x - 1, diag_length, SHEAR);
+					}
+					if (mask & (1 << BEND)) {
+						if (j + 2 < size_x) addSpring(index, index + 2, rest_x * 2, BEND);
+						if (i + 2 < size_y) addSpring(index, index + size_x * 2, rest_y * 2, BEND);
+					}
+				}
+			}
+			colorize(size_x * size_y);
+		}
+
+		//Greedy edge coloring, then sort the springs by color.
+		//Call it after adding springs by hand, the order inside a color is kept.
+		Kboolean colorize(Ksize particle_count) {
+			const Ksize n = size();
+			std::vector<Kuint> used(particle_count, 0); //color bits taken at every particle
+			std::vector<Kubyte> colors(n);
+			std::vector<Kuint> counts(MAX_COLORS + 1, 0);
+			Kuint color_count = 0;
+			for (Ksize k = 0; k < n; ++k) {
+				const Kuint i = (*first)[k], j = (*second)[k];
+				const Kuint taken = used[i] | used[j];
+				Kuint c = 0;
+				while (c < MAX_COLORS && (taken >> c & 1u)) ++c;
+				if (c == MAX_COLORS) {
+					std::cerr << "Too many spring colors!" << std::endl;
+					color_offsets->clear();
+					return false;
+				}
+				used[i] |= 1u << c;
+				used[j] |= 1u << c;
+				colors[k] = c;
+				++counts[c + 1];
+				if (c + 1 > color_count) color_count = c + 1;
+			}
+
+			color_offsets->assign(color_count + 1, 0);
+			for (Kuint c = 0; c < color_count; ++c) {
+				(*color_offsets)[c + 1] = (*color_offsets)[c] + counts[c + 1];
+			}
+			std::vector<Kuint> order(n);
+			std::vector<Kuint> next(color_offsets->begin(), color_offsets->end() - 1);
+			for (Ksize k = 0; k < n; ++k) order[next[colors[k]]++] = k;
+			reorder(first, order);
+			reorder(second, order);
+			reorder(rest_lengths, order);
+			reorder(types, order);
+			return true;
+		}
+
+		void setStiffness(SpringType type, Kfloat ks, Kfloat kd) {
+			this->ks[type] = ks;
+			this->kd[type] = kd;
+		}
+
+		void setBackend(SpringBackend backend) {
+			this->backend = backend;
+		}
+
+		SpringBackend getBackend()const {
+			return backend;
+		}
+
+		//Add the spring forces into forces, springs only pull (no force when compressed).
+		void accumulateForces(const tvec3* p, const tvec3* v, tvec3* forces)const {
+			accumulateForces(p, v, forces, 0, size());
+		}
+
+		//Same on a thread pool. With deterministic = true the springs go color by color,
+		//every particle sums its springs in the same order whatever the thread count is,
+		//so the result is the same bit for bit as the serial version above.
+		//With deterministic = false every thread takes one slice of springs into its own
+		//buffer and the buffers are summed at the end: two barriers instead of one per
+		//color, but the rounding depends on the thread count.
+		void accumulateForces(KThread::ThreadPool* pool, const tvec3* p, const tvec3* v,
+			tvec3* forces, Ksize particle_count, Kboolean deterministic = true)const {
+			const Kuint threads = pool->getThreadCount();
+			if (threads == 1 || (deterministic && color_offsets->empty())) {
+				accumulateForces(p, v, forces, 0, size());
+				return;
+			}
+			if (deterministic) {
+				for (Ksize c = 0; c + 1 < color_offsets->size(); ++c) {
+					pool->parallelFor((*color_offsets)[c], (*color_offsets)[c + 1],
+						[&](Ksize begin, Ksize end, Kuint) {
+						accumulateForces(p, v, forces, begin, end);
+					});
+				}
+				return;
+			}
+
+			//thread 0 adds straight into forces, others into their own buffer.
+			//A thread with an empty slice never runs, so the buffers are cleared
+			//while they are summed instead of before they are filled.
+			if (thread_forces->size() < (threads - 1) * particle_count) {
+				thread_forces->resize((threads - 1) * particle_count);
+			}
+			tvec3* buffers = thread_forces->data();
+			pool->parallelFor(0, size(), [&](Ksize begin, Ksize end, Kuint thread) {
+				tvec3* out = thread > 0 ? buffers + (thread - 1) * particle_count : forces;
+				accumulateForces(p, v, out, begin, end);
+			});
+			pool->parallelFor(0, particle_count, [&](Ksize begin, Ksize end, Kuint) {
+				for (Kuint t = 1; t < threads; ++t) {
+					tvec3* in = buffers + (t - 1) * particle_count;
+					for (Ksize i = begin; i < end; ++i) {
+						forces[i] += in[i];
+						in[i].set(0.f);
+					}
+				}
+			});
+		}
+
+		Kuint getColorCount()const {
+			return color_offsets->empty() ? 0 : color_offsets->size() - 1;
+		}
+
+		//Springs of color c are [offsets[c], offsets[c + 1]), getColorCount() + 1 entries.
+		const Kuint* getColorOffsets()const {
+			return color_offsets->data();
+		}
+
+		Ksize size()const {
+			return first->size();
+		}
+
+		const Kuint* getFirst()const { return first->data(); }
+		const Kuint* getSecond()const { return second->data(); }
+		const Kfloat* getRestLengths()const { return rest_lengths->data(); }
+		const Kubyte* getTypes()const { return types->data(); }
+		SpringData getData()const {
+			return SpringData{ first->data(), second->data(), rest_lengths->data(), types->data(), ks, kd };
+		}
+		Kfloat getKs(SpringType type)const { return ks[type]; }
+		Kfloat getKd(SpringType type)const { return kd[type]; }
+	};
+}
+
+#endif // !SPRINGS_H
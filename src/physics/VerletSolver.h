@@ -0,0 +1,261 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef VERLET_SOLVER_H
+#define VERLET_SOLVER_H
+
+#include <vector>
+#include <cmath>
+#include "../Core.h"
+#include "../math/Vec2.h"
+#include "../math/Vec3.h"
+#include "../util/ThreadPool.h"
+#include "./Particles.h"
+#include "./GridStencil.h"
+
+namespace KPhysics {
+	using tvec2 = KVector::Vec2;
+	using tvec3 = KVector::Vec3;
+
+	//Everything verlet.vert reads from uniforms except the object position and the sphere.
+	//Defaults are the ones VerletCloth has always used.
+	struct VerletParams {
+		Kint size_x, size_y;
+		tvec2 length;
+		tvec2 rest_length; //length / (size - 1)
+		Kfloat diag_length; //rest_length.length()
+
+		tvec3 gravity = tvec3(0.f, -0.0098f, 0.f);
+		Kfloat mass = 0.1f;
+		Kfloat a_resistance = -0.0125f;
+		tvec3 f_wind = tvec3(0.f, 0.0f, -0.0f);
+
+		Kfloat ks = 200.f;
+		Kfloat kd = 0.60f;
+		Kfloat ks_bend = 9.6f;
+		Kfloat kd_bend = 0.24f;
+
+		Kfloat delta_time = 1.f / 60.f;
+		Kuint substeps = 1; //passes per step, each one advances delta_time / substeps
+
+		VerletParams(Ksize size_x = 31, Ksize size_y = 21, const tvec2& length = tvec2(10.f)) :
+			size_x(size_x), size_y(size_y), length(length) {
+			rest_length = length / tvec2(size_x - 1, size_y - 1);
+			diag_length = rest_length.length();
+		}
+
+		GridStencil getStencil()const {
+			return GridStencil{ size_x, size_y, rest_length.x, rest_length.y, diag_length };
+		}
+
+		//The delta_time the shader sees.
+		Kfloat getSubstepTime()const {
+			return delta_time / (substeps > 0 ? substeps : 1);
+		}
+	};
+
+	//CPU version of res/verlet.vert, no GL context needed.
+	//It follows the shader line by line (same stencil, damping, sphere collision and
+	//ground clamp), so it can run headless batches and be diffed against GPU output.
+	class VerletSolverCPU {
+	private:
+		static const Kfloat EXPSION; //deal with Z fighting, same as the shader
+
+		VerletParams params;
+		GridStencil stencil;
+		tvec3 position; //u_position
+		tvec3 s_center;
+		Kfloat s_radius;
+
+		Particles* particles;
+		std::vector<tvec3>* next_positions;
+		std::vector<tvec3>* next_last_positions;
+
+		KThread::ThreadPool* pool;
+		Kboolean own_pool;
+
+		tvec3 calAirForce(const tvec3& velocity)const {
+			if (velocity == tvec3(0.f)) return tvec3(0.f);
+			return (params.a_resistance * velocity.length<Kfloat>()) * velocity;
+		}
+
+		void stepVertex(Kint id, Kfloat delta_time, const tvec3* last, const tvec3* now,
+			tvec3& o_last_vertex, tvec3& o_vertex)const {
+			const tvec3& last_p = last[id];
+			const tvec3& now_p = now[id];
+
+			if (particles->isPinned(id)) {
+				o_last_vertex = now_p;
+				o_vertex = now_p;
+				return;
+			}
+			if (delta_time == 0.f) {
+				o_last_vertex = last_p;
+				o_vertex = now_p;
+				return;
+			}
+
+			const Kint i = id / params.size_x;
+			const Kint j = id % params.size_x;
+			tvec3 delta_p(now_p - last_p);
+			tvec3 acceleration(0.f);
+			if (params.mass != 0.f) {
+				tvec3 vel(delta_p / delta_time);
+				acceleration = params.mass * params.gravity + params.f_wind + calAirForce(vel);
+				for (Kint k = 0; k < GridStencil::SPRING_COUNT; ++k) {
+					Kint index;
+					Kfloat r_length;
+					if (!stencil.getSpring(id, i, j, k, index, r_length)) continue;
+					const tvec3& n_now_p = now[index];
+					tvec3 dp(now_p - n_now_p);
+					const Kfloat delta_length = dp.length<Kfloat>();
+					if (delta_length - r_length <= 0.f) continue;
+
+					tvec3 n_vel((n_now_p - last[index]) / delta_time);
+					const Kfloat damp = dp.dot<Kfloat>(vel - n_vel) / delta_length;
+					dp /= delta_length;
+					if (r_length != params.diag_length) {
+						acceleration -= (params.ks * (delta_length - r_length) + params.kd * damp) * dp;
+					}
+					else {
+						acceleration -= (params.ks_bend * (delta_length - r_length) + params.kd_bend * damp) * dp;
+					}
+				}
+				acceleration /= params.mass;
+			}
+
+			o_last_vertex = now_p;
+			o_vertex = now_p + delta_p + acceleration * (delta_time * delta_time);
+			dealCollision(o_last_vertex, o_vertex);
+		}
+
+		void dealCollision(tvec3& o_last_vertex, tvec3& o_vertex)const {
+			o_vertex += position;
+			tvec3 d(o_vertex - s_center);
+			const Kfloat dis = d.length<Kfloat>();
+			if (dis <= s_radius) {
+				o_vertex = (d / dis) * (s_radius + EXPSION) + s_center;
+				o_last_vertex = o_vertex - position;
+			}
+			if (o_vertex.y < EXPSION) {
+				o_vertex.y = EXPSION;
+			}
+			o_vertex -= position;
+		}
+
+	public:
+		VerletSolverCPU(const VerletParams& params, KThread::ThreadPool* pool = nullptr) :
+			params(params), stencil(params.getStencil()), position(0.f), s_center(0.f), s_radius(0.f),
+			particles(nullptr), next_positions(nullptr), next_last_positions(nullptr),
+			pool(pool), own_pool(pool == nullptr) {
+			if (own_pool) this->pool = new KThread::ThreadPool();
+
+			const Ksize count = params.size_x * params.size_y;
+			particles = new Particles(count, params.mass);
+			next_positions = new std::vector<tvec3>(count);
+			next_last_positions = new std::vector<tvec3>(count);
+
+			std::vector<tvec3> vertices;
+			generateVertices(params, &vertices);
+			for (Ksize i = 0; i < count; ++i) particles->setPosition(i, vertices[i]);
+			particles->setPinned(0);
+			particles->setPinned(params.size_x - 1);
+		}
+		~VerletSolverCPU() {
+			delete particles;
+			delete next_positions;
+			delete next_last_positions;
+			if (own_pool) delete pool;
+		}
+
+		//Rest positions of the grid, the same VerletCloth uploads.
+		static void generateVertices(const VerletParams& params, std::vector<tvec3>* vertices) {
+			vertices->clear();
+			vertices->reserve(params.size_x * params.size_y);
+			Kfloat y = params.length.y / 2.f;
+			for (int i = 0; i < params.size_y; ++i, y -= params.rest_length.y) {
+				Kfloat x = params.length.x / -2.f;
+				for (int j = 0; j < params.size_x; ++j, x += params.rest_length.x) {
+					//vertices->emplace_back(x, y, 0.f);
+					vertices->emplace_back(x, params.length.y, y);
+				}
+			}
+		}
+
+		//One step, params.substeps passes of the shader over every vertex.
+		void step() {
+			const Kint count = particles->size();
+			const Kuint substeps = params.substeps > 0 ? params.substeps : 1;
+			const Kfloat delta_time = params.getSubstepTime();
+			for (Kuint s = 0; s < substeps; ++s) {
+				const tvec3* last = particles->getLastPositions();
+				const tvec3* now = particles->getPositions();
+				tvec3* o_last = next_last_positions->data();
+				tvec3* o_now = next_positions->data();
+				pool->parallelFor(0, count, [&](Ksize begin, Ksize end, Kuint) {
+					for (Ksize id = begin; id < end; ++id) {
+						stepVertex(id, delta_time, last, now, o_last[id], o_now[id]);
+					}
+				});
+				particles->swapPositions(next_positions, next_last_positions);
+			}
+		}
+
+		void step(Kuint passes) {
+			while (passes--) step();
+		}
+
+		void setPosition(const tvec3& position) {
+			this->position = position;
+		}
+
+		void setSphere(const tvec3& center, Kfloat radius) {
+			s_center = center;
+			s_radius = radius;
+		}
+
+		void setDeltaTime(Kfloat delta_time) {
+			params.delta_time = delta_time;
+		}
+
+		void setSubsteps(Kuint substeps) {
+			params.substeps = substeps > 0 ? substeps : 1;
+		}
+
+		//Params and every particle array. position and the sphere belong to the scene,
+		//the caller sets them again as it does for VerletCloth.
+		void saveState(KCache::Checkpoint* checkpoint)const {
+			checkpoint->put(KCache::PARAMS, &params, 1);
+			particles->saveState(checkpoint);
+		}
+
+		//checkpoint has to be of a cloth of the same size, from this solver or VerletCloth.
+		Kboolean loadState(const KCache::Checkpoint& checkpoint) {
+			if (!checkpoint.matches(KCache::VERLET_SOLVER, params.size_x, params.size_y)) return false;
+			VerletParams loaded;
+			if (!checkpoint.get(KCache::PARAMS, &loaded, 1)) {
+				std::cerr << "Checkpoint has no params" << std::endl;
+				return false;
+			}
+			if (!particles->loadState(checkpoint)) return false;
+			params = loaded;
+			stencil = params.getStencil();
+			return true;
+		}
+
+		const VerletParams& getParams()const {
+			return params;
+		}
+
+		Particles* getParticles() {
+			return particles;
+		}
+
+		const Particles* getParticles()const {
+			return particles;
+		}
+	};
+}
+
+#endif // !VERLET_SOLVER_H
@@ -0,0 +1,192 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef XPBD_SOLVER_H
+#define XPBD_SOLVER_H
+
+#include <vector>
+#include <cmath>
+#include "../Core.h"
+#include "../math/Vec3.h"
+#include "../util/ThreadPool.h"
+#include "./Particles.h"
+#include "./Springs.h"
+
+namespace KPhysics {
+	using tvec3 = KVector::Vec3;
+
+	//Extended position based dynamics (Macklin et al. 2016) over the spring grid.
+	//Every spring is a distance constraint with a compliance (inverse stiffness, m/N),
+	//bend springs skip one particle, so they act as the bending constraints.
+	//Like the springs they only resist stretching.
+	//Compliance is scaled by 1 / h^2 of the substep, so stiffness does not change
+	//with the time step or the substep count.
+	//Constraints are projected Gauss-Seidel style color by color: springs of one color
+	//share no particle, so a color runs on the pool without atomics and the result
+	//is the same for any thread count.
+	class XPBDSolver {
+	private:
+		static const Kfloat EXPSION; //ground offset, same as Cloth
+
+		Particles* particles;
+		const Springs* springs;
+		KThread::ThreadPool* pool;
+
+		std::vector<Kfloat>* lambdas; //one per spring, reset every substep
+		std::vector<Kfloat>* inv_masses;
+
+		Kfloat compliance[Springs::TYPE_COUNT];
+		Kuint substeps;
+		Kuint iterations; //per substep
+		Kuint budget; //max projections of the whole set per step, 0 means no limit
+		Kfloat ground;
+
+		void project(Ksize begin, Ksize end, Kfloat h2) {
+			const Kuint* a = springs->getFirst();
+			const Kuint* b = springs->getSecond();
+			const Kfloat* rest = springs->getRestLengths();
+			const Kubyte* type = springs->getTypes();
+			const Kfloat* w = inv_masses->data();
+			Kfloat* lambda = lambdas->data();
+			tvec3* p = particles->getPositions();
+			for (Ksize k = begin; k < end; ++k) {
+				const Kuint i = a[k], j = b[k];
+				const Kfloat w_sum = w[i] + w[j];
+				if (w_sum == 0.f) continue;
+				tvec3 dp(p[i] - p[j]);
+				const Kfloat len = dp.length<Kfloat>();
+				const Kfloat c = len - rest[k];
+				if (c <= 0.f) continue;
+
+				const Kfloat alpha = compliance[type[k]] / h2;
+				const Kfloat delta_lambda = (-c - alpha * lambda[k]) / (w_sum + alpha);
+				lambda[k] += delta_lambda;
+				dp *= delta_lambda / len;
+				p[i] += dp * w[i];
+				p[j] -= dp * w[j];
+			}
+		}
+
+	public:
+		XPBDSolver(Particles* particles, const Springs* springs, KThread::ThreadPool* pool) :
+			particles(particles), springs(springs), pool(pool), lambdas(nullptr), inv_masses(nullptr),
+			substeps(4), iterations(2), budget(0), ground(0.f) {
+			lambdas = new std::vector<Kfloat>();
+			inv_masses = new std::vector<Kfloat>();
+			//same stiffness as the spring forces to start with
+			for (Kuint t = 0; t < Springs::TYPE_COUNT; ++t) {
+				const Kfloat ks = springs->getKs(SpringType(t));
+				compliance[t] = ks > 0.f ? 1.f / ks : 0.f;
+			}
+			rebuild();
+		}
+		~XPBDSolver() {
+			delete lambdas;
+			delete inv_masses;
+		}
+
+		//Call again when particles, masses, pins or springs change.
+		void rebuild() {
+			const Ksize n = particles->size();
+			const Kfloat* m = particles->getMasses();
+			lambdas->assign(springs->size(), 0.f);
+			inv_masses->resize(n);
+			for (Ksize i = 0; i < n; ++i) {
+				(*inv_masses)[i] = particles->isPinned(i) || m[i] == 0.f ? 0.f : 1.f / m[i];
+			}
+		}
+
+		//0 makes the constraints of the type rigid.
+		void setCompliance(SpringType type, Kfloat compliance) {
+			this->compliance[type] = compliance;
+		}
+
+		Kfloat getCompliance(SpringType type)const {
+			return compliance[type];
+		}
+
+		void setSubsteps(Kuint substeps) {
+			this->substeps = substeps > 0 ? substeps : 1;
+		}
+
+		Kuint getSubsteps()const {
+			return substeps;
+		}
+
+		void setIterations(Kuint iterations) {
+			this->iterations = iterations > 0 ? iterations : 1;
+		}
+
+		Kuint getIterations()const {
+			return iterations;
+		}
+
+		//Caps substeps * iterations, iterations drop first but every substep keeps one.
+		void setIterationBudget(Kuint budget) {
+			this->budget = budget;
+		}
+
+		Kuint getIterationBudget()const {
+			return budget;
+		}
+
+		//Particles are kept above this height.
+		void setGround(Kfloat ground) {
+			this->ground = ground;
+		}
+
+		//Advance by h. forces are the external forces (gravity, wind, drag),
+		//they stay constant over the substeps.
+		void step(Kfloat h, const tvec3* forces) {
+			const Ksize n = particles->size();
+			const Kfloat sub_h = h / substeps;
+			const Kfloat h2 = sub_h * sub_h;
+			Kuint passes = iterations;
+			if (budget > 0 && substeps * passes > budget) passes = budget / substeps > 0 ? budget / substeps : 1;
+
+			tvec3* p = particles->getPositions();
+			tvec3* last_p = particles->getLastPositions();
+			tvec3* v = particles->getVelocities();
+			const Kfloat* w = inv_masses->data();
+			const Kuint colors = springs->getColorCount();
+			const Kuint* offsets = springs->getColorOffsets();
+			for (Kuint s = 0; s < substeps; ++s) {
+				pool->parallelFor(0, n, [&](Ksize begin, Ksize end, Kuint) {
+					for (Ksize i = begin; i < end; ++i) {
+						last_p[i] = p[i];
+						if (w[i] == 0.f) continue;
+						v[i] += forces[i] * (w[i] * sub_h);
+						p[i] += v[i] * sub_h;
+					}
+				});
+
+				lambdas->assign(lambdas->size(), 0.f);
+				for (Kuint it = 0; it < passes; ++it) {
+					if (colors == 0) {
+						project(0, springs->size(), h2);
+						continue;
+					}
+					for (Kuint c = 0; c < colors; ++c) {
+						pool->parallelFor(offsets[c], offsets[c + 1], [&](Ksize begin, Ksize end, Kuint) {
+							project(begin, end, h2);
+						});
+					}
+				}
+
+				pool->parallelFor(0, n, [&](Ksize begin, Ksize end, Kuint) {
+					for (Ksize i = begin; i < end; ++i) {
+						if (w[i] == 0.f) {
+							v[i].set(0.f);
+							continue;
+						}
+						if (p[i].y < ground) p[i].y = ground + EXPSION;
+						v[i] = (p[i] - last_p[i]) / sub_h;
+					}
+				});
+			}
+		}
+	};
+}
+
+#endif // !XPBD_SOLVER_H
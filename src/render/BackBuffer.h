@@ -25,8 +25,7 @@ namespace KBuffer {
 		BackBuffer(const KShader::Shader* shader, const std::vector<const char*>& varyings,
 			const std::vector<Kuint>& buffers_size, GLenum mode = GL_INTERLEAVED_ATTRIBS):
 			buffers_size(buffers_size), buffers(nullptr) {
-			glTransformFeedbackVaryings(shader->program, varyings.size(), varyings.data(), mode);
-			glLinkProgram(shader->program);
+			shader->setFeedbackVaryings(varyings, mode);
 
 			n_buffers = buffers_size.size();
 			if (n_buffers == 0) return;
@@ -66,6 +65,7 @@ namespace KBuffer {
 			glCopyBufferSubData(GL_TRANSFORM_FEEDBACK_BUFFER, type, 0, 0, buffers_size[index]);
 		}
 
+		//Synchronous, it stalls until the GPU is done, delete[] the data after use.
 		template <typename T>
 		const T* getData(Kuint index = 0)const {
 			static_assert(false, "BlockBuffer::getData<T> is just for some type");
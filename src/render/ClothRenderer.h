@@ -23,8 +23,8 @@ namespace KRenderer {
 		KLight::Light* light;
 
 	public:
-		ClothRenderer() : Renderer(RES_PATH + "phong.vert",
-			RES_PATH + "phong.frag", "ClothSimulation"),
+		ClothRenderer(Kboolean headless = false) : Renderer(RES_PATH + "phong.vert",
+			RES_PATH + "phong.frag", "ClothSimulation", 1000, 700, headless),
 			floor(nullptr), sphere(nullptr),
 			camera(nullptr), light(nullptr) {
 
@@ -36,6 +36,7 @@ namespace KRenderer {
 
 			Kuint size = 30;
 			cloth = new KObject::Cloth(size);
+			clock->setStep(0.01);
 
 			camera = new KCamera::Camera(tvec3(0, size, size * 2));
 			tvec2 wSize = window->getWindowSize();
@@ -63,7 +64,7 @@ namespace KRenderer {
 
 			tvec2 wSize;
 			tvec2 last_mouse = mouse_pos;
-			Kfloat now_time = window->getRunTime();
+			clock->reset(window->getRunTime());
 
 			shader->bind();
 			camera->bindUniform(shader);
@@ -77,36 +78,43 @@ namespace KRenderer {
 				wSize = window->getWindowSize();
 
 #ifdef IMGUI_ENABLE
-				ImGui_ImplGlfwGL3_NewFrame();
-				ImGuiWindowFlags flags = ImGuiWindowFlags_HorizontalScrollbar
-					| ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize;
+				if (!window->isHeadless()) {
+					GPUTimer timer(gpu_profiler, "gui");
+					ImGui_ImplGlfwGL3_NewFrame();
+					ImGuiWindowFlags flags = ImGuiWindowFlags_HorizontalScrollbar
+						| ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize;
 
-				ImGui::Begin("GUI", nullptr, flags);
-				ImGui::SetWindowPos(ImVec2(wSize.x, 0));
-				ImGui::SetWindowSize(ImVec2(300, wSize.y));
+					ImGui::Begin("GUI", nullptr, flags);
+					ImGui::SetWindowPos(ImVec2(wSize.x, 0));
+					ImGui::SetWindowSize(ImVec2(300, wSize.y));
 
-				ImGui::SetWindowFontScale(1.2);
-				ImGui::Text("Your screen now is %.2f fps.", ImGui::GetIO().Framerate);
-				ImGui::Text("Your mouse pos is %.0f, %.0f", mouse_pos.x, mouse_pos.y);
-				ImGui::Text("Your last mouse pos is %.0f, %.0f", last_mouse.x, last_mouse.y);
+					ImGui::SetWindowFontScale(1.2);
+					ImGui::Text("Your screen now is %.2f fps.", ImGui::GetIO().Framerate);
+					ImGui::Text("Your mouse pos is %.0f, %.0f", mouse_pos.x, mouse_pos.y);
+					ImGui::Text("Your last mouse pos is %.0f, %.0f", last_mouse.x, last_mouse.y);
+					ImGui::Text("Simulation steps: %lu, dropped %.2fs", clock->getTotalSteps(), clock->getDroppedTime());
 
-				cloth->drawGui();
+					cloth->drawGui();
+					drawCache();
 
-				//floor->drawImGui();
-				//floor->bindPosition(shader);
-				//floor->bindScale(shader);
+					//floor->drawImGui();
+					//floor->bindPosition(shader);
+					//floor->bindScale(shader);
 
-				//ImGui::DragFloat("angle", &angle, 0.1, 0, 360);
-				//camera->setRotation(angle, tvec3(0, 1, 0));
-				//camera->bindPosition(shader);
+					//ImGui::DragFloat("angle", &angle, 0.1, 0, 360);
+					//camera->setRotation(angle, tvec3(0, 1, 0));
+					//camera->bindPosition(shader);
 
-				ImGui::Checkbox("light", &light_enable);
+					ImGui::Checkbox("light", &light_enable);
+
+					drawProfiler();
+
+					ImGui::End();
+					ImGui::Render();
+					ImGui_ImplGlfwGL3_RenderDrawData(ImGui::GetDrawData());
+				}
 				if (light_enable) light->active(shader);
 				else light->unActive(shader);
-
-				ImGui::End();
-				ImGui::Render();
-				ImGui_ImplGlfwGL3_RenderDrawData(ImGui::GetDrawData());
 #endif // IMGUI_ENABLE
 
 				if (mouse[GLFW_MOUSE_BUTTON_LEFT] &&
@@ -117,24 +125,81 @@ namespace KRenderer {
 				}
 				last_mouse = mouse_pos;
 
-// 				cloth->bindUniform(shader);
-// 				//cloth->updatePosition(window->getRunTime() - now_time);
-// 				cloth->updatePosition(0.01f);
-// 				now_time = window->getRunTime();
-// 				cloth->render();
-
-				floor->bindUniform(shader);
-				floor->render();
-				floor->unActiveTexture(shader);
-
-				sphere->bindUniform(shader);
-				sphere->render();
-				sphere->unActiveTexture(shader);
+				{
+					GPUTimer timer(gpu_profiler, "simulate");
+					Kuint steps = clock->advance(window->getRunTime());
+					const KPhysics::Particles* particles = cloth->getSolver()->getParticles();
+					while (steps--) {
+						if (cache_reader != nullptr) {
+							const Kuint frame = nextCacheFrame();
+							cloth->loadFrame(cache_reader->getPositions(frame), cache_reader->getVelocities(frame));
+							continue;
+						}
+						cloth->updatePosition(clock->getStep());
+						if (cache_writer != nullptr) {
+							cache_writer->addFrame(particles->getPositions(), particles->getVelocities());
+						}
+						const Kulong step = clock->getTotalSteps() - steps; //the clock counted the frame's steps
+						if (isCheckpointDue(step)) {
+							const Kuint size = cloth->getSolver()->getSize();
+							auto state = new KCache::Checkpoint(KCache::CLOTH_SOLVER, size, size);
+							cloth->getSolver()->saveState(state);
+							saveCheckpoint(state, step);
+						}
+					}
+				}
+				{
+					GPUTimer timer(gpu_profiler, "upload");
+					cloth->interpolate(clock->getAlpha());
+				}
+				{
+					GPUTimer timer(gpu_profiler, "render");
+					cloth->bindUniform(shader);
+					cloth->render();
+
+					floor->bindUniform(shader);
+					floor->render();
+					floor->unActiveTexture(shader);
+
+					sphere->bindUniform(shader);
+					sphere->render();
+					sphere->unActiveTexture(shader);
+				}
 
+				finishFrame();
 				window->update();
 			}
 		}
 
+		//Positions and velocities of every step.
+		Kboolean recordCache(const std::string& path, Kboolean compress = false)override {
+			delete cache_writer;
+			const Kuint size = cloth->getSolver()->getSize();
+			const std::vector<Kuint>* indices = cloth->getIndices();
+			cache_writer = new KCache::CacheWriter(path, size, size, indices->data(), indices->size(),
+				clock->getStep(), KCache::HAS_VELOCITIES | (compress ? KCache::COMPRESSED : 0));
+			if (cache_writer->isOpen()) return true;
+			delete cache_writer;
+			cache_writer = nullptr;
+			return false;
+		}
+
+		Kboolean playCache(const std::string& path)override {
+			return openCache(path, cloth->getSolver()->getParticles()->size());
+		}
+
+		//A copy of the particles every interval steps.
+		Kboolean checkpoint(const std::string& path, Kuint interval = 600)override {
+			return openCheckpoint(path, interval);
+		}
+
+		Kboolean restore(const std::string& path)override {
+			KCache::Checkpoint state;
+			if (!state.read(path) || !cloth->loadState(state)) return false;
+			restoreClock(state);
+			return true;
+		}
+
 		void resize(Kint w, Kint h)override {
 #ifdef IMGUI_ENABLE
 			Renderer::resize(w - 300, h);
@@ -25,13 +25,20 @@ namespace KRenderer {
 		KLight::Light* light;
 
 	public:
-		EulerClothRenderer(): Renderer(RES_PATH + "phong.vert",
-			RES_PATH + "phong.frag", "ClothSimulation"),
+		EulerClothRenderer(Kboolean headless = false): Renderer(RES_PATH + "phong.vert",
+			RES_PATH + "phong.frag", "ClothSimulation", 1000, 700, headless),
 			back_shader(nullptr), cloth(nullptr),
 			floor(nullptr), sphere(nullptr),
 			camera(nullptr), light(nullptr) {
 			back_shader = new KShader::Shader();
-			back_shader->addShader(GL_VERTEX_SHADER, RES_PATH + "euler.vert");
+			const Kboolean compute = KShader::Shader::isComputeSupported() &&
+				back_shader->addShader(GL_COMPUTE_SHADER, RES_PATH + "euler.comp");
+			if (!compute) {
+				//GL 3.3, transform feedback
+				delete back_shader;
+				back_shader = new KShader::Shader();
+				back_shader->addShader(GL_VERTEX_SHADER, RES_PATH + "euler.vert");
+			}
 
 			floor = new KObject::Plane(80, 80, 40, 40);
 			floor->rotate(90, tvec3(-1, 0, 0));
@@ -41,6 +48,7 @@ namespace KRenderer {
 
 			Kuint size = 30;
 			cloth = new KObject::EulerCloth(size);
+			if (compute) cloth->initCompute();
 			cloth->setPosition(tvec3(0.f, 2.f, 0.f));
 
 			camera = new KCamera::Camera(tvec3(0, 10, 15));
@@ -71,11 +79,12 @@ namespace KRenderer {
 
 			tvec2 wSize;
 			tvec2 last_mouse = mouse_pos;
-			Kfloat now_time = window->getRunTime();
 
 			back_shader->bind();
-			cloth->initBackBuffer(back_shader);
+			if (!cloth->isCompute()) cloth->initBackBuffer(back_shader);
 			cloth->bindBackUniform(back_shader);
+			clock->setStep(cloth->getParams().delta_time);
+			clock->reset(window->getRunTime());
 
 			shader->bind();
 			camera->bindUniform(shader);
@@ -91,28 +100,35 @@ namespace KRenderer {
 				wSize = window->getWindowSize();
 
 #ifdef IMGUI_ENABLE
-				ImGui_ImplGlfwGL3_NewFrame();
-				ImGuiWindowFlags flags = ImGuiWindowFlags_HorizontalScrollbar
-					| ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize;
-
-				ImGui::Begin("GUI", nullptr, flags);
-				ImGui::SetWindowPos(ImVec2(wSize.x, 0));
-				ImGui::SetWindowSize(ImVec2(300, wSize.y));
-
-				ImGui::SetWindowFontScale(1.2);
-				ImGui::Text("Your screen now is %.2f fps.", ImGui::GetIO().Framerate);
-				ImGui::Text("Your mouse pos is %.0f, %.0f", mouse_pos.x, mouse_pos.y);
-				ImGui::Text("Your last mouse pos is %.0f, %.0f", last_mouse.x, last_mouse.y);
-
-				ImGui::Checkbox("light", &light_enable);
-				ImGui::SameLine(150);
-				ImGui::Checkbox("sphere", &sphere_enable);
+				if (!window->isHeadless()) {
+					GPUTimer timer(gpu_profiler, "gui");
+					ImGui_ImplGlfwGL3_NewFrame();
+					ImGuiWindowFlags flags = ImGuiWindowFlags_HorizontalScrollbar
+						| ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize;
+
+					ImGui::Begin("GUI", nullptr, flags);
+					ImGui::SetWindowPos(ImVec2(wSize.x, 0));
+					ImGui::SetWindowSize(ImVec2(300, wSize.y));
+
+					ImGui::SetWindowFontScale(1.2);
+					ImGui::Text("Your screen now is %.2f fps.", ImGui::GetIO().Framerate);
+					ImGui::Text("Your mouse pos is %.0f, %.0f", mouse_pos.x, mouse_pos.y);
+					ImGui::Text("Your last mouse pos is %.0f, %.0f", last_mouse.x, last_mouse.y);
+					ImGui::Text("Simulation steps: %lu, dropped %.2fs", clock->getTotalSteps(), clock->getDroppedTime());
+					ImGui::Text("Solver: %s", cloth->isCompute() ? "compute shader" : "transform feedback");
+
+					ImGui::Checkbox("light", &light_enable);
+					ImGui::SameLine(150);
+					ImGui::Checkbox("sphere", &sphere_enable);
+
+					drawProfiler();
+
+					ImGui::End();
+					ImGui::Render();
+					ImGui_ImplGlfwGL3_RenderDrawData(ImGui::GetDrawData());
+				}
 				if (light_enable) light->active(shader);
 				else light->unActive(shader);
-
-				ImGui::End();
-				ImGui::Render();
-				ImGui_ImplGlfwGL3_RenderDrawData(ImGui::GetDrawData());
 #endif // IMGUI_ENABLE
 
 				if (mouse[GLFW_MOUSE_BUTTON_LEFT] &&
@@ -123,32 +139,35 @@ namespace KRenderer {
 				}
 				last_mouse = mouse_pos;
 
-				//now_time = window->getRunTime() - now_time;
-				//if (!KFunction::isZero(now_time)) {
-				//	back_shader->bind();
-				//	back_shader->bindUniform1f("delta_time", now_time);
-				//	cloth->renderBack();
-				//}
-				//now_time = window->getRunTime();
-
-				back_shader->bind();
-				back_shader->bindUniform1f("delta_time", 1.f / 60.f);
-				cloth->renderBack();
-
-				shader->bind();
-				cloth->bindUniform(shader);
-				cloth->render();
-
-				floor->bindUniform(shader);
-				floor->render();
-				floor->unActiveTexture(shader);
-
-				if (sphere_enable) {
-					sphere->bindUniform(shader);
-					sphere->render();
-					sphere->unActiveTexture(shader);
+				{
+					GPUTimer timer(gpu_profiler, "simulate");
+					back_shader->bind();
+					Kuint steps = clock->advance(window->getRunTime());
+					while (steps--) cloth->renderBack();
+				}
+				{
+					GPUTimer timer(gpu_profiler, "upload");
+					cloth->interpolate(clock->getAlpha());
+				}
+
+				{
+					GPUTimer timer(gpu_profiler, "render");
+					shader->bind();
+					cloth->bindUniform(shader);
+					cloth->render();
+
+					floor->bindUniform(shader);
+					floor->render();
+					floor->unActiveTexture(shader);
+
+					if (sphere_enable) {
+						sphere->bindUniform(shader);
+						sphere->render();
+						sphere->unActiveTexture(shader);
+					}
 				}
 
+				finishFrame();
 				window->update();
 			}
 		}
@@ -0,0 +1,147 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef FRAME_RECORDER_H
+#define FRAME_RECORDER_H
+
+#include <deque>
+#include <vector>
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <stb_image_write.h>
+#include "../Header.h"
+#include "./ReadbackRing.h"
+#include "../util/WorkQueue.h"
+
+namespace KRenderer {
+	//Writes every frame as directory/frame_000000.png.
+	//capture() reads the framebuffer into a ring of pixel pack buffers and goes on,
+	//the frames are mapped a few captures later and encoded on worker threads, so
+	//drawing, readback and PNG encoding run at the same time.
+	//No frame is dropped: when the ring or the encoders are behind, capture waits.
+	//Only a readback that never finishes (a GL error, a lost context) is given up
+	//after MAP_RETRIES seconds and counted as failed.
+	class FrameRecorder {
+	private:
+		static const Kuint MAP_RETRIES = 5; //waits of a second for one readback
+
+		struct Pending {
+			std::uint64_t ticket;
+			Kuint frame;
+		};
+
+		Kuint width, height;
+		std::string directory;
+		KBuffer::ReadbackRing* ring;
+		KThread::WorkQueue* encoders;
+		std::deque<Pending>* pending;
+		Kuint frame; //next to capture
+		std::atomic<Kuint> written;
+		std::atomic<Kuint> failed;
+
+		Kuint getRowSize()const {
+			return (width * 3 + 3) / 4 * 4; //GL_PACK_ALIGNMENT 4
+		}
+
+		//Hands the finished readbacks to the encoders in order, wait for the first one if asked.
+		void collect(Kboolean wait) {
+			Kuint retries = 0;
+			while (!pending->empty()) {
+				const Pending front = pending->front();
+				const Kubyte* data = ring->map<Kubyte>(front.ticket, wait ? 1000000000ull : 0);
+				if (data == nullptr) {
+					if (!wait) break;
+					if (++retries < MAP_RETRIES) continue;
+					std::cerr << "Frame " << front.frame << " was never read back, dropped" << std::endl;
+					ring->release(front.ticket);
+					pending->pop_front();
+					++failed;
+					break;
+				}
+				wait = false;
+
+				auto* pixels = new std::vector<Kubyte>(data, data + ring->getSize(front.ticket));
+				ring->release(front.ticket);
+				pending->pop_front();
+
+				const std::string filename = getFileName(front.frame);
+				const Kint w = width, h = height, row = getRowSize();
+				encoders->push([this, pixels, filename, w, h, row]() {
+					//rows come bottom up, start at the last one with a negative stride
+					const Kubyte* top = pixels->data() + (h - 1) * row;
+					if (stbi_write_png(filename.data(), w, h, 3, top, -row)) ++written;
+					else ++failed;
+					delete pixels;
+				});
+			}
+		}
+
+	public:
+		//0 threads means one encoder per hardware thread.
+		FrameRecorder(Kuint width, Kuint height, const std::string& directory,
+			Kuint threads = 0, Kuint ring_count = 3) :
+			width(width), height(height), directory(directory), ring(nullptr), encoders(nullptr),
+			pending(nullptr), frame(0), written(0), failed(0) {
+			if (!makeDirectory(directory)) {
+				std::cerr << "Cannot create directory: " << directory << std::endl;
+			}
+			ring = new KBuffer::ReadbackRing(getRowSize() * height, ring_count);
+			encoders = new KThread::WorkQueue(threads);
+			pending = new std::deque<Pending>();
+		}
+		~FrameRecorder() {
+			finish();
+			delete pending;
+			delete encoders;
+			delete ring;
+		}
+
+		//After drawing and before the swap, the lower left width x height of framebuffer.
+		void capture(Kuint framebuffer = 0) {
+			GLint read_framebuffer, alignment;
+			glGetIntegerv(GL_READ_FRAMEBUFFER_BINDING, &read_framebuffer);
+			glGetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, framebuffer);
+			glPixelStorei(GL_PACK_ALIGNMENT, 4);
+
+			std::uint64_t ticket = ring->requestPixels(0, 0, width, height);
+			while (ticket == 0 && !pending->empty()) {
+				collect(true); //the ring is full
+				ticket = ring->requestPixels(0, 0, width, height);
+			}
+			if (ticket != 0) pending->push_back({ ticket, frame++ });
+
+			glPixelStorei(GL_PACK_ALIGNMENT, alignment);
+			glBindFramebuffer(GL_READ_FRAMEBUFFER, read_framebuffer);
+			collect(false);
+		}
+
+		//Waits until every captured frame is on disk.
+		void finish() {
+			while (!pending->empty()) collect(true);
+			encoders->wait();
+		}
+
+		std::string getFileName(Kuint frame)const {
+			char name[32];
+			sprintf(name, "/frame_%06u.png", frame);
+			return directory + name;
+		}
+
+		Kuint getFrameCount()const {
+			return frame;
+		}
+
+		Kuint getWrittenCount()const {
+			return written;
+		}
+
+		Kuint getFailedCount()const {
+			return failed;
+		}
+	};
+}
+
+#endif // !FRAME_RECORDER_H
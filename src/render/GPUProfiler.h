@@ -0,0 +1,111 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef GPU_PROFILER_H
+#define GPU_PROFILER_H
+
+#include <vector>
+#include <deque>
+#include "../Header.h"
+#include "../util/Profiler.h"
+
+namespace KRenderer {
+	//GL timestamp queries for KTime::Profiler, one per context.
+	//GPUTimer puts a query before and after its scope, collect hands the finished
+	//ones to the profiler without waiting for the GPU.
+	class GPUProfiler {
+		friend class GPUTimer;
+
+	private:
+		struct Query {
+			const char* name;
+			GLuint begin, end;
+			Kuint frame;
+		};
+
+		Kboolean supported;
+		std::vector<GLuint>* free_queries;
+		std::deque<Query>* queries;
+
+		GLuint acquire() {
+			if (free_queries->empty()) {
+				GLuint query;
+				glGenQueries(1, &query);
+				return query;
+			}
+			const GLuint query = free_queries->back();
+			free_queries->pop_back();
+			return query;
+		}
+
+	public:
+		GPUProfiler() : supported(false), free_queries(nullptr), queries(nullptr) {
+			supported = GLEW_VERSION_3_3 || GLEW_ARB_timer_query;
+			free_queries = new std::vector<GLuint>();
+			queries = new std::deque<Query>();
+		}
+		//Needs the context.
+		~GPUProfiler() {
+			for (auto &it : *queries) {
+				free_queries->emplace_back(it.begin);
+				free_queries->emplace_back(it.end);
+			}
+			if (!free_queries->empty()) glDeleteQueries(free_queries->size(), free_queries->data());
+			delete free_queries;
+			delete queries;
+		}
+
+		//Before KTime::Profiler::endFrame, the finished queries in order.
+		void collect() {
+			KTime::Profiler& profiler = KTime::Profiler::instance();
+			while (!queries->empty()) {
+				const Query& query = queries->front();
+				GLint available = GL_FALSE;
+				glGetQueryObjectiv(query.end, GL_QUERY_RESULT_AVAILABLE, &available);
+				if (available == GL_FALSE) break;
+				GLuint64 begin, end;
+				glGetQueryObjectui64v(query.begin, GL_QUERY_RESULT, &begin);
+				glGetQueryObjectui64v(query.end, GL_QUERY_RESULT, &end);
+				profiler.addGPUScope(query.name, query.frame, begin, end);
+				free_queries->emplace_back(query.begin);
+				free_queries->emplace_back(query.end);
+				queries->pop_front();
+			}
+		}
+
+		Kboolean isSupported()const {
+			return supported;
+		}
+	};
+
+	//A KTime::ScopeTimer that also times the GL commands of the scope on the GPU.
+	class GPUTimer {
+	private:
+		KTime::ScopeTimer cpu;
+		GPUProfiler* profiler;
+		const char* name;
+		GLuint begin;
+		Kuint frame;
+
+	public:
+		GPUTimer(GPUProfiler* profiler, const char* name) : cpu(name), profiler(profiler),
+			name(name), begin(0), frame(0) {
+			if (!KTime::Profiler::instance().isEnabled() || !profiler->isSupported()) return;
+			begin = profiler->acquire();
+			frame = KTime::Profiler::instance().getFrame();
+			glQueryCounter(begin, GL_TIMESTAMP);
+		}
+		~GPUTimer() {
+			if (begin == 0) return;
+			const GLuint end = profiler->acquire();
+			glQueryCounter(end, GL_TIMESTAMP);
+			profiler->queries->push_back({ name, begin, end, frame });
+		}
+
+		GPUTimer(const GPUTimer&) = delete;
+		GPUTimer& operator=(const GPUTimer&) = delete;
+	};
+}
+
+#endif // !GPU_PROFILER_H
@@ -0,0 +1,164 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef READBACK_RING_H
+#define READBACK_RING_H
+
+#include <vector>
+#include <cstdint>
+#include "../Header.h"
+
+namespace KBuffer {
+	//Asynchronous buffer readback.
+	//request() queues a GPU copy into one of a ring of staging (pixel pack) buffers and
+	//puts a fence after it, so nothing waits. A frame or two later map() hands the data
+	//out once the fence is signaled, release() gives the staging buffer back to the ring.
+	//Tickets start at 1, 0 means no request.
+	class ReadbackRing {
+	private:
+		struct Slot {
+			Kuint buffer;
+			Kuint size; //bytes of the last request
+			GLsync fence;
+			std::uint64_t ticket; //0 when the slot is free
+			void* data; //while mapped
+		};
+
+		std::vector<Slot>* slots;
+		Kuint capacity; //bytes of every staging buffer
+		std::uint64_t next_ticket;
+
+		Slot* find(std::uint64_t ticket)const {
+			if (ticket == 0) return nullptr;
+			Slot& slot = (*slots)[ticket % slots->size()];
+			return slot.ticket == ticket ? &slot : nullptr;
+		}
+
+		//The next slot if it is released and size fits, its buffer is bound to GL_PIXEL_PACK_BUFFER.
+		Slot* acquire(Kuint size) {
+			if (size > capacity) {
+				std::cerr << "Readback of " << size << " bytes is over the ring capacity!" << std::endl;
+				return nullptr;
+			}
+			Slot& slot = (*slots)[next_ticket % slots->size()];
+			if (slot.ticket != 0) return nullptr;
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+			return &slot;
+		}
+
+		std::uint64_t submit(Slot* slot, Kuint size) {
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			slot->fence = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			slot->size = size;
+			slot->ticket = next_ticket;
+			return next_ticket++;
+		}
+
+	public:
+		ReadbackRing(Kuint capacity, Kuint count = 3) : slots(nullptr), capacity(capacity), next_ticket(1) {
+			slots = new std::vector<Slot>(count > 0 ? count : 1);
+			for (auto& slot : *slots) {
+				glGenBuffers(1, &slot.buffer);
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+				glBufferData(GL_PIXEL_PACK_BUFFER, capacity, nullptr, GL_STREAM_READ);
+				slot.size = 0;
+				slot.fence = nullptr;
+				slot.ticket = 0;
+				slot.data = nullptr;
+			}
+			glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+		}
+		~ReadbackRing() {
+			for (auto& slot : *slots) {
+				if (slot.data != nullptr) {
+					glBindBuffer(GL_PIXEL_PACK_BUFFER, slot.buffer);
+					glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+				}
+				if (slot.fence != nullptr) glDeleteSync(slot.fence);
+				if (glIsBuffer(slot.buffer)) glDeleteBuffers(1, &slot.buffer);
+			}
+			delete slots;
+		}
+
+		//Copy size bytes of buffer from offset. Returns 0 when the next staging buffer
+		//is not released yet (the reader is behind) or size is over the capacity.
+		std::uint64_t request(Kuint buffer, Kuint size, Kuint offset = 0) {
+			Slot* slot = acquire(size);
+			if (slot == nullptr) return 0;
+			glBindBuffer(GL_COPY_READ_BUFFER, buffer);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_PIXEL_PACK_BUFFER, offset, 0, size);
+			return submit(slot, size);
+		}
+
+		//Unsigned byte pixels of the bound read framebuffer, rows bottom up as glReadPixels
+		//gives them, every row padded to GL_PACK_ALIGNMENT.
+		std::uint64_t requestPixels(Kint x, Kint y, Kuint width, Kuint height, GLenum format = GL_RGB) {
+			GLint alignment = 4;
+			glGetIntegerv(GL_PACK_ALIGNMENT, &alignment);
+			const Kuint row = (width * (format == GL_RGBA ? 4 : format == GL_RGB ? 3 : 1)
+				+ alignment - 1) / alignment * alignment;
+			Slot* slot = acquire(row * height);
+			if (slot == nullptr) return 0;
+			glReadPixels(x, y, width, height, format, GL_UNSIGNED_BYTE, nullptr);
+			return submit(slot, row * height);
+		}
+
+		//Without waiting it only checks the fence (and flushes so it will be signaled).
+		Kboolean isReady(std::uint64_t ticket, std::uint64_t timeout_ns = 0)const {
+			Slot* slot = find(ticket);
+			if (slot == nullptr) return false;
+			if (slot->fence == nullptr) return true;
+			GLenum state = glClientWaitSync(slot->fence, GL_SYNC_FLUSH_COMMANDS_BIT, timeout_ns);
+			if (state != GL_ALREADY_SIGNALED && state != GL_CONDITION_SATISFIED) return false;
+			glDeleteSync(slot->fence);
+			slot->fence = nullptr;
+			return true;
+		}
+
+		//nullptr while the copy is not done, the pointer holds until release().
+		template <typename T = void>
+		const T* map(std::uint64_t ticket, std::uint64_t timeout_ns = 0) {
+			if (!isReady(ticket, timeout_ns)) return nullptr;
+			Slot* slot = find(ticket);
+			if (slot->data == nullptr) {
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+				slot->data = glMapBufferRange(GL_PIXEL_PACK_BUFFER, 0, slot->size, GL_MAP_READ_BIT);
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+			}
+			return static_cast<const T*>(slot->data);
+		}
+
+		Kuint getSize(std::uint64_t ticket)const {
+			Slot* slot = find(ticket);
+			return slot == nullptr ? 0 : slot->size;
+		}
+
+		//The staging buffer goes back to the ring, mapped or not.
+		void release(std::uint64_t ticket) {
+			Slot* slot = find(ticket);
+			if (slot == nullptr) return;
+			if (slot->data != nullptr) {
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, slot->buffer);
+				glUnmapBuffer(GL_PIXEL_PACK_BUFFER);
+				glBindBuffer(GL_PIXEL_PACK_BUFFER, 0);
+				slot->data = nullptr;
+			}
+			if (slot->fence != nullptr) {
+				glDeleteSync(slot->fence);
+				slot->fence = nullptr;
+			}
+			slot->ticket = 0;
+		}
+
+		Kuint getCapacity()const {
+			return capacity;
+		}
+
+		Kuint getCount()const {
+			return slots->size();
+		}
+	};
+}
+
+#endif // !READBACK_RING_H
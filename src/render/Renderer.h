@@ -8,6 +8,14 @@
 #include "../Header.h"
 #include "../Window.h"
 #include "./Shader.h"
+#include "./UniformBuffer.h"
+#include "./FrameRecorder.h"
+#include "./GPUProfiler.h"
+#include "../util/Camera.h"
+#include "../object/Object3D.h"
+#include "../util/SimulationClock.h"
+#include "../util/SimulationCache.h"
+#include "../util/Checkpoint.h"
 #include "../math/Vec4.h"
 
 namespace KRenderer {
@@ -26,6 +34,15 @@ namespace KRenderer {
 	protected:
 		KWindow::Window* window;
 		KShader::Shader* shader;
+		KTime::SimulationClock* clock; //fixed steps for the simulation, set its step in the renderer
+		FrameRecorder* recorder; //see record()
+		GPUProfiler* gpu_profiler; //GPU times of the profiled scopes
+		KCache::CacheWriter* cache_writer; //see recordCache()
+		KCache::CacheReader* cache_reader; //see playCache()
+		Kuint cache_frame; //next frame to play
+		KCache::CheckpointWriter* checkpoint_writer; //see checkpoint()
+		Kuint checkpoint_interval; //steps between checkpoints
+		Kulong checkpoint_step; //of the last checkpoint taken or restored
 		Kboolean keys[512]; //-1, 32-162, 256-248
 		Kboolean mouse[3]; //left, right, wheel
 
@@ -46,16 +63,122 @@ namespace KRenderer {
 
 	protected:
 		Renderer(const std::string& v_shader, const std::string& f_shader,
-			const std::string& title, Ksize swidth = 1000, Ksize sheight = 700) :
-			window(nullptr), shader(nullptr) {
-			window = new KWindow::Window(title, swidth, sheight);
+			const std::string& title, Ksize swidth = 1000, Ksize sheight = 700, Kboolean headless = false) :
+			window(nullptr), shader(nullptr), clock(nullptr), recorder(nullptr), gpu_profiler(nullptr),
+			cache_writer(nullptr), cache_reader(nullptr), cache_frame(0),
+			checkpoint_writer(nullptr), checkpoint_interval(0), checkpoint_step(0) {
+			window = new KWindow::Window(title, swidth, sheight, headless);
+			gpu_profiler = new GPUProfiler();
+			clock = new KTime::SimulationClock();
 			shader = new KShader::Shader(v_shader, f_shader);
-			if (window->actived()) {
+			shader->bindUniformBlock(KCamera::Camera::U_BLOCK, KBuffer::CAMERA_BLOCK);
+			shader->bindUniformBlock(KObject::Object3D::U_BLOCK, KBuffer::OBJECT_BLOCK);
+			if (window->actived() && !window->isHeadless()) {
 				glfwSetWindowUserPointer(window->window, this);
 				initAction();
+				KTime::Profiler::instance().setEnabled(); //for the GUI
 			}
 		}
 
+		//Every renderer calls it right before window->update().
+		void finishFrame()const {
+			if (recorder != nullptr) {
+				KTime::ScopeTimer timer("record");
+				recorder->capture(window->getFramebuffer());
+			}
+			gpu_profiler->collect();
+			KTime::Profiler::instance().endFrame();
+		}
+
+		//For playCache: path has to hold particles per frame, the clock runs at its step.
+		Kboolean openCache(const std::string& path, Kuint particles) {
+			delete cache_reader;
+			cache_reader = new KCache::CacheReader(path);
+			if (cache_reader->isOpen() && (cache_reader->getParticleCount() != particles
+				|| cache_reader->getFrameCount() == 0)) {
+				std::cerr << "Cache file is empty or of another cloth: " << path << std::endl;
+			}
+			else if (cache_reader->isOpen()) {
+				clock->setStep(cache_reader->getDeltaTime());
+				cache_frame = 0;
+				return true;
+			}
+			delete cache_reader;
+			cache_reader = nullptr;
+			return false;
+		}
+
+		//The frame to play this step, the last one stays once the cache is played through.
+		Kuint nextCacheFrame() {
+			const Kuint frame = cache_frame;
+			if (cache_frame + 1 < cache_reader->getFrameCount()) ++cache_frame;
+			return frame;
+		}
+
+		//For checkpoint: a writer for path, one checkpoint every interval steps.
+		Kboolean openCheckpoint(const std::string& path, Kuint interval) {
+			delete checkpoint_writer;
+			checkpoint_writer = new KCache::CheckpointWriter(path);
+			checkpoint_interval = interval > 0 ? interval : 1;
+			return true;
+		}
+
+		//After the simulated step number step: a checkpoint is due and the writer is free.
+		Kboolean isCheckpointDue(Kulong step)const {
+			return checkpoint_writer != nullptr && step >= checkpoint_step + checkpoint_interval &&
+				!checkpoint_writer->isBusy();
+		}
+
+		//The state of step to the writer, it is written in the background.
+		void saveCheckpoint(KCache::Checkpoint* state, Kulong step) {
+			state->setStep(step, step * clock->getStep());
+			checkpoint_step = step;
+			checkpoint_writer->save(state);
+		}
+
+		//For restore, once the cloth took state: steps go on counting from it.
+		void restoreClock(const KCache::Checkpoint& state) {
+			clock->setTotalSteps(state.getStep());
+			checkpoint_step = state.getStep();
+			std::cerr << "Restored step " << state.getStep() << " (" << state.getTime() << "s)" << std::endl;
+		}
+
+#ifdef IMGUI_ENABLE
+		//Frames recorded, or a slider to seek in the played cache, and the checkpoints.
+		void drawCache() {
+			if (checkpoint_writer != nullptr) {
+				ImGui::Text("Checkpoints: %u, last at step %lu", checkpoint_writer->getCount(),
+					Kulong(checkpoint_writer->getLastStep()));
+			}
+			if (cache_writer != nullptr) {
+				ImGui::Text("Cache: %u frames, %.1f MB", cache_writer->getFrameCount(),
+					cache_writer->getSize() / 1048576.0);
+			}
+			if (cache_reader == nullptr) return;
+			Kint frame = cache_frame;
+			if (ImGui::SliderInt("cache frame", &frame, 0, cache_reader->getFrameCount() - 1)) cache_frame = frame;
+		}
+
+		//Phases of the last frame in the GUI panel, see KTime::Profiler.
+		void drawProfiler()const {
+			if (!ImGui::CollapsingHeader("Profiler", ImGuiTreeNodeFlags_DefaultOpen)) return;
+			const KTime::Profiler& profiler = KTime::Profiler::instance();
+			const Kint count = KTime::Profiler::HISTORY;
+			const Kint offset = profiler.getFrame() % count; //the oldest frame
+			const Kfloat frame_ms = profiler.getFrameTime();
+			ImGui::Text("Frame %.2f ms", frame_ms);
+			ImGui::PlotLines("##frame", profiler.getFrameHistory().data(), count, offset, nullptr,
+				0.f, FLT_MAX, ImVec2(-1, 40));
+			for (auto &it : profiler.getPhases()) {
+				if (it.gpu_ms > 0.0) ImGui::Text("%-10s %6.2f ms  gpu %6.2f ms", it.name, it.cpu_ms, it.gpu_ms);
+				else ImGui::Text("%-10s %6.2f ms  x%u", it.name, it.cpu_ms, it.calls);
+				ImGui::PlotHistogram(it.name, it.history->data(), count, offset, "",
+					0.f, frame_ms > 0.f ? frame_ms : FLT_MAX, ImVec2(-1, 20));
+			}
+			if (profiler.getDroppedCount() > 0) ImGui::Text("Dropped %u scopes", profiler.getDroppedCount());
+		}
+#endif // IMGUI_ENABLE
+
 		virtual void keyEvent(Kint key, Kint action) {
 			keys[key] = action != GLFW_RELEASE;
 			if (keys[GLFW_KEY_ESCAPE]) {
@@ -93,6 +216,13 @@ namespace KRenderer {
 
 	public:
 		virtual ~Renderer() {
+			delete recorder; //finishes the frames, needs the context
+			delete cache_writer;
+			delete cache_reader;
+			delete checkpoint_writer; //finishes the one being written
+			KTime::Profiler::instance().closeCSV();
+			delete gpu_profiler;
+			delete clock;
 			delete shader;
 			delete window;
 		}
@@ -116,6 +246,52 @@ namespace KRenderer {
 		const tvec2& getMouse()const {
 			return mouse_pos;
 		}
+
+		//Every frame from now on goes to directory as a PNG, see FrameRecorder.
+		//Headless with the default frame time it is one simulation step a frame.
+		void record(const std::string& directory, Kuint threads = 0) {
+			delete recorder;
+			const tvec2 size = window->getWindowSize();
+			recorder = new FrameRecorder(Kuint(size.x), Kuint(size.y), directory, threads);
+		}
+
+		//Every profiled scope from now on to a CSV file, see KTime::Profiler.
+		void profile(const std::string& path) {
+			KTime::Profiler& profiler = KTime::Profiler::instance();
+			if (profiler.openCSV(path)) profiler.setEnabled();
+		}
+
+		//Every simulation step from now on to a cache file, see KCache::CacheWriter.
+		//compress trades some precision for a few times less disk, see KCache::FrameCodec.
+		virtual Kboolean recordCache(const std::string& path, Kboolean compress = false) {
+			std::cerr << "This renderer can not record a cache" << std::endl;
+			return false;
+		}
+
+		//The steps come from a cache file instead of the simulation, see KCache::CacheReader.
+		virtual Kboolean playCache(const std::string& path) {
+			std::cerr << "This renderer can not play a cache" << std::endl;
+			return false;
+		}
+
+		//A checkpoint of the whole simulation state to path every interval steps, written
+		//in the background so the steps do not wait for the disk, see KCache::CheckpointWriter.
+		virtual Kboolean checkpoint(const std::string& path, Kuint interval = 600) {
+			std::cerr << "This renderer can not write checkpoints" << std::endl;
+			return false;
+		}
+
+		//The simulation goes on from a checkpoint (of the CPU or the GPU solver of this
+		//renderer's kind), see KCache::Checkpoint. Call it before exec.
+		virtual Kboolean restore(const std::string& path) {
+			std::cerr << "This renderer can not restore checkpoints" << std::endl;
+			return false;
+		}
+
+		//Headless runs close after this many frames, 0 runs until closeWindow.
+		void setFrameLimit(Kuint frames) {
+			window->setFrameLimit(frames);
+		}
 	};
 
 
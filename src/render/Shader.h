@@ -7,9 +7,17 @@
 
 #include <GL/glew.h>
 #include <unordered_map>
+#include <vector>
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
 #include "../Header.h"
 #include "../math/Mat4.h"
 
+//Linked programs are saved here with glGetProgramBinary and loaded next run
+//instead of compiling, empty turns the cache off.
+std::string SHADER_CACHE_PATH = "./shader_cache/";
+
 static Kuint getSize(GLenum type) {
 	switch (type)
 	{
@@ -34,8 +42,6 @@ static Kuint getSize(GLenum type) {
 	}
 }
 
-namespace KBuffer { class BackBuffer; }
-
 namespace KShader{
 	using tvec4 = KVector::Vec4;
 	using tvec3 = KVector::Vec3;
@@ -44,12 +50,156 @@ namespace KShader{
 	using tmat3 = KMatrix::Mat3;
 
     class Shader{
-		friend class KBuffer::BackBuffer;
-
     private:
         Kuint program;
         std::unordered_map<std::string, int> *uniforms;
 
+		//The program is linked from these every time, so it can be keyed and cached.
+		std::vector<std::pair<GLenum, std::string>> *sources;
+		std::vector<std::string> *varyings; //transform feedback
+		mutable GLenum varyings_mode;
+		mutable Kboolean cacheable; //not after a shader object is attached by addShader(Kuint)
+
+		static const Kuint CACHE_MAGIC;
+		static const Kuint CACHE_VERSION;
+
+		static std::uint64_t hash(const std::string &data, std::uint64_t h = 14695981039346656037ull) {
+			//FNV-1a
+			for (Kubyte c : data) {
+				h ^= c;
+				h *= 1099511628211ull;
+			}
+			return h;
+		}
+
+		//Driver, stages and varyings, a new driver or an edited shader is a miss.
+		std::uint64_t getCacheKey()const {
+			std::uint64_t h = hash(reinterpret_cast<const char*>(glGetString(GL_VENDOR)));
+			h = hash(reinterpret_cast<const char*>(glGetString(GL_RENDERER)), h);
+			h = hash(reinterpret_cast<const char*>(glGetString(GL_VERSION)), h);
+			for (auto &source : *sources) {
+				h = hash(std::to_string(source.first), h);
+				h = hash(source.second, h);
+			}
+			for (auto &varying : *varyings) h = hash(varying, h);
+			return hash(std::to_string(varyings_mode), h);
+		}
+
+		std::string getCacheFile(std::uint64_t key)const {
+			char name[17];
+			sprintf(name, "%016llx", static_cast<unsigned long long>(key));
+			return SHADER_CACHE_PATH + name + ".bin";
+		}
+
+		//A file that is cut short, from another key or rejected by the driver is a miss.
+		bool loadBinary(std::uint64_t key)const {
+			const std::string filename = getCacheFile(key);
+			FILE* file = fopen(filename.data(), "rb");
+			if (file == nullptr) return false;
+			Kuint header[3]; //magic, version, format
+			std::uint64_t file_key = 0;
+			Kuint length = 0;
+			std::vector<Kubyte> binary;
+			bool ok = fread(header, sizeof(header), 1, file) == 1 &&
+				fread(&file_key, sizeof(file_key), 1, file) == 1 &&
+				fread(&length, sizeof(length), 1, file) == 1 &&
+				header[0] == CACHE_MAGIC && header[1] == CACHE_VERSION && file_key == key && length > 0;
+			if (ok) {
+				binary.resize(length);
+				ok = fread(binary.data(), 1, length, file) == length;
+			}
+			fclose(file);
+			if (!ok) return false;
+
+			glProgramBinary(program, header[2], binary.data(), length);
+			GLint flag;
+			glGetProgramiv(program, GL_LINK_STATUS, &flag);
+			if (flag == GL_FALSE) {
+				remove(filename.data());
+				return false;
+			}
+			return true;
+		}
+
+		//Written to a temporary file first, so a run that starts meanwhile never reads half of it.
+		void saveBinary(std::uint64_t key)const {
+			GLint length = 0;
+			glGetProgramiv(program, GL_PROGRAM_BINARY_LENGTH, &length);
+			if (length <= 0) return;
+			std::vector<Kubyte> binary(length);
+			GLenum format;
+			glGetProgramBinary(program, length, nullptr, &format, binary.data());
+
+			makeDirectory(SHADER_CACHE_PATH);
+			const std::string filename = getCacheFile(key);
+			const std::string temp = filename + "." +
+				std::to_string(std::chrono::high_resolution_clock::now().time_since_epoch().count());
+			FILE* file = fopen(temp.data(), "wb");
+			if (file == nullptr) {
+				std::cerr << "Cannot write shader cache: " << temp << std::endl;
+				return;
+			}
+			const Kuint header[3] = { CACHE_MAGIC, CACHE_VERSION, format };
+			const Kuint size = length;
+			bool ok = fwrite(header, sizeof(header), 1, file) == 1 &&
+				fwrite(&key, sizeof(key), 1, file) == 1 &&
+				fwrite(&size, sizeof(size), 1, file) == 1 &&
+				fwrite(binary.data(), 1, size, file) == size;
+			fclose(file);
+			remove(filename.data()); //rename does not replace on Windows
+			if (!ok || rename(temp.data(), filename.data()) != 0) remove(temp.data());
+		}
+
+		//From the cache, or compile every source and link.
+		bool link()const {
+			if (!glIsProgram(program)) return false;
+			const bool cache = cacheable && isCacheSupported();
+			const std::uint64_t key = cache ? getCacheKey() : 0;
+			if (cache && loadBinary(key)) {
+				uniforms->clear();
+				return true;
+			}
+
+			std::vector<Kuint> shaders;
+			bool ok = true;
+			for (auto &source : *sources) {
+				Kuint shader = compileShader(source.first, source.second);
+				if (shader == 0) {
+					ok = false;
+					break;
+				}
+				glAttachShader(program, shader);
+				shaders.emplace_back(shader);
+			}
+			if (ok) {
+				std::vector<const char*> names;
+				for (auto &varying : *varyings) names.emplace_back(varying.c_str());
+				glTransformFeedbackVaryings(program, names.size(), names.data(), varyings_mode);
+				if (cache) glProgramParameteri(program, GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+				glLinkProgram(program);
+			}
+			for (auto shader : shaders) {
+				glDetachShader(program, shader);
+				glDeleteShader(shader);
+			}
+			if (!ok) return false;
+
+			GLint flag;
+			glGetProgramiv(program, GL_LINK_STATUS, &flag);
+			if (GL_FALSE == flag) {
+				Kint length;
+				glGetProgramiv(program, GL_INFO_LOG_LENGTH, &length);
+				auto *error_log = new GLchar[length + 1];
+				glGetProgramInfoLog(program, length, nullptr, error_log);
+				std::cerr << "Error linking program: " << error_log << std::endl;
+				delete error_log;
+				return false;
+			}
+			uniforms->clear();
+			if (cache) saveBinary(key);
+			return true;
+		}
+
         bool readFile(const std::string &filename, std::string &content)const {
 #if 1
 			FILE* file = fopen(filename.data(), "rt"); //read text
@@ -91,19 +241,25 @@ namespace KShader{
         }
 
     public:
-        Shader():uniforms(new std::unordered_map<std::string, int>()) {
+        Shader():uniforms(new std::unordered_map<std::string, int>()),
+			sources(new std::vector<std::pair<GLenum, std::string>>()), varyings(new std::vector<std::string>()),
+			varyings_mode(GL_INTERLEAVED_ATTRIBS), cacheable(true) {
 			program = glCreateProgram(); 
 			if (program == 0) {
 				std::cerr << "Create program failed!" << std::endl;
 			}
 		}
         Shader(const std::string &vs_filename, const std::string &fs_filename):
-        uniforms(new std::unordered_map<std::string, int>()){
+        uniforms(new std::unordered_map<std::string, int>()),
+			sources(new std::vector<std::pair<GLenum, std::string>>()), varyings(new std::vector<std::string>()),
+			varyings_mode(GL_INTERLEAVED_ATTRIBS), cacheable(true) {
             createProgram(vs_filename, fs_filename);
         }
         ~Shader(){
 			uniforms->clear();
             delete uniforms;
+			delete sources;
+			delete varyings;
 			if (glIsProgram(program)) glDeleteProgram(program);
         }
 
@@ -114,24 +270,21 @@ namespace KShader{
                 return false;
             }
 
-            Kuint vertShader = createShader(GL_VERTEX_SHADER, vs_filename);
-            Kuint fragShader = createShader(GL_FRAGMENT_SHADER, fs_filename);
-            glAttachShader(program, vertShader);
-            glAttachShader(program, fragShader);
-            glLinkProgram(program);
-            glDeleteShader(vertShader);
-            glDeleteShader(fragShader);
-
-            GLint flag;
-            auto *error_log = new GLchar[1024];
-            glGetProgramiv(program, GL_LINK_STATUS, &flag);
-            if(GL_FALSE == flag){
-                glGetProgramInfoLog(program, 1024, nullptr, error_log);
-                std::cerr << "Error linking program: " << error_log << std::endl;
+            std::string vs_content, fs_content;
+            if(!readFile(vs_filename, vs_content) || !readFile(fs_filename, fs_content)){
+                glDeleteProgram(program);
+                return false;
+            }
+            sources->clear();
+            sources->emplace_back(GL_VERTEX_SHADER, vs_content);
+            sources->emplace_back(GL_FRAGMENT_SHADER, fs_content);
+            if(!link()){
                 glDeleteProgram(program);
                 return false;
             }
 
+            GLint flag;
+            auto *error_log = new GLchar[1024];
             glValidateProgram(program);
             glGetProgramiv(program, GL_VALIDATE_STATUS, &flag);
             if(GL_FALSE == flag){
@@ -157,6 +310,16 @@ namespace KShader{
                 glDeleteShader(shader);
                 return 0;
             }
+            glDeleteShader(shader);
+            return compileShader(type, content);
+        }
+
+        Kuint compileShader(GLenum type, const std::string &content)const {
+            Kuint shader = glCreateShader(type);
+            if(shader == 0){
+                std::cerr << "Create shader failed with type: " << type << std::endl;
+                return shader;
+            }
 
             const char *sources = content.c_str();
             glShaderSource(shader, 1, &sources, nullptr);
@@ -172,7 +335,7 @@ namespace KShader{
                 auto *error_log = new GLchar[length+1];
                 glGetShaderInfoLog(shader, length, nullptr, error_log);
                 std::cerr << "Error compiling " <<
-					(type == GL_VERTEX_SHADER ? "vecter" : "fragment")
+					(type == GL_VERTEX_SHADER ? "vecter" : type == GL_COMPUTE_SHADER ? "compute" : "fragment")
 					<< " shader: \n" << error_log << std::endl;
                 glDeleteShader(shader);
                 delete error_log;
@@ -182,8 +345,10 @@ namespace KShader{
             return shader;
         }
 
+        //The shader stays attached and is not in the key, the program is never cached then.
         bool addShader(Kuint shader)const {
             if(!glIsShader(shader) || !glIsProgram(program)) return false;
+            cacheable = false;
             glAttachShader(program, shader);
             glLinkProgram(program);
 
@@ -203,7 +368,39 @@ namespace KShader{
 		}
 
 		bool addShader(GLenum type, const std::string &filename)const {
-			return addShader(createShader(type, filename));
+			std::string content;
+			if (!readFile(filename, content)) return false;
+			sources->emplace_back(type, content);
+			if (link()) return true;
+			sources->pop_back();
+			return false;
+		}
+
+		//Relinks with the varyings, the transform feedback outputs are part of the cache key.
+		bool setFeedbackVaryings(const std::vector<const char*> &names, GLenum mode)const {
+			varyings->assign(names.begin(), names.end());
+			varyings_mode = mode;
+			return link();
+		}
+
+		//Program binaries, GL 4.1 or ARB_get_program_binary with at least one format.
+		static bool isCacheSupported() {
+			if (SHADER_CACHE_PATH.empty()) return false;
+			if (!GLEW_VERSION_4_1 && !GLEW_ARB_get_program_binary) return false;
+			GLint formats = 0;
+			glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formats);
+			return formats > 0;
+		}
+
+		//Compute shaders with storage buffers, GL 4.3 or the two extensions.
+		//Build with NO_COMPUTE_SHADER to always take the GL 3.3 path.
+		static bool isComputeSupported() {
+#ifdef NO_COMPUTE_SHADER
+			return false;
+#else
+			return GLEW_VERSION_4_3 ||
+				(GLEW_ARB_compute_shader && GLEW_ARB_shader_storage_buffer_object);
+#endif
 		}
 
         bool isValid()const {
@@ -218,6 +415,16 @@ namespace KShader{
             glUseProgram(0);
         }
 
+		//Once after linking, the block then reads the buffer bound at binding.
+		//false when the shader has no such block, not every shader has every block.
+		bool bindUniformBlock(const std::string &name, Kuint binding)const {
+			if (!isValid()) return false;
+			Kuint index = glGetUniformBlockIndex(program, name.c_str());
+			if (index == GL_INVALID_INDEX) return false;
+			glUniformBlockBinding(program, index, binding);
+			return true;
+		}
+
 		Kint getAttribLocation(const char* name)const {
 			if (!isValid()) return -2;
 			return glGetAttribLocation(program, name);
@@ -272,6 +479,9 @@ namespace KShader{
 			glUniformMatrix4fv(getLocation(name), 1, GL_TRUE, m.data()); //our matrix is row-first
 		}
     };
+
+	const Kuint Shader::CACHE_MAGIC = 0x4253504B; //KPSB
+	const Kuint Shader::CACHE_VERSION = 1;
 }
 
 #endif //SHADER_H
@@ -8,6 +8,7 @@
 #include "../Header.h"
 #include "./Shader.h"
 #include "./BackBuffer.h"
+#include "./ReadbackRing.h"
 
 namespace KBuffer {
 	class TextureBuffer {
@@ -45,6 +46,36 @@ namespace KBuffer {
 			shader->bindUniform1i(name, index);
 		}
 
+		//Only the texture unit, the sampler uniform is already set.
+		void bind(Kint index)const {
+			glActiveTexture(GL_TEXTURE0 + index);
+			glBindTexture(GL_TEXTURE_BUFFER, tex_id);
+		}
+
+		//The buffer behind the texture, to read it as vertex attribute for example.
+		void bindBuffer(GLenum target = GL_ARRAY_BUFFER)const {
+			glBindBuffer(target, buffer);
+		}
+
+		//Copy on the GPU, nothing comes back to the CPU.
+		void copyDataFromBuffer(const TextureBuffer* other, Kuint size)const {
+			if (other == nullptr) return;
+			glBindBuffer(GL_COPY_READ_BUFFER, other->buffer);
+			glBindBuffer(GL_COPY_WRITE_BUFFER, buffer);
+			glCopyBufferSubData(GL_COPY_READ_BUFFER, GL_COPY_WRITE_BUFFER, 0, 0, size);
+		}
+
+		//The buffer as the storage block with binding = index, for compute shaders.
+		void bindToStorage(Kuint index)const {
+			glBindBufferBase(GL_SHADER_STORAGE_BUFFER, index, buffer);
+		}
+
+		//Asynchronous, see ReadbackRing.
+		std::uint64_t requestData(ReadbackRing* ring, Kuint size, Kuint offset = 0)const {
+			if (ring == nullptr) return 0;
+			return ring->request(buffer, size, offset);
+		}
+
 		void copyDataFromBuffer(Kuint index, const BackBuffer* back)const {
 			if (back == nullptr) return;
 			back->copyDataToBuffer(index, buffer, GL_TEXTURE_BUFFER);
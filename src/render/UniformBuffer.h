@@ -0,0 +1,59 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef UNIFORM_BUFFER_H
+#define UNIFORM_BUFFER_H
+
+#include <GL/glew.h>
+#include "../Header.h"
+
+namespace KBuffer {
+	//Binding points of the std140 blocks, every shader that has a block binds it
+	//here with Shader::bindUniformBlock once after linking.
+	enum UniformBlock {
+		CAMERA_BLOCK = 0, //Camera, phong
+		OBJECT_BLOCK = 1, //Object, phong
+		SOLVER_BLOCK = 2 //VerletParams or EulerParams, back shaders
+	};
+
+	//A uniform block's buffer. The owner keeps a std140 struct of it, uploads it
+	//when something changed and binds it before drawing.
+	class UniformBuffer {
+	private:
+		Kuint id;
+		Kuint size;
+		Kuint binding;
+
+	public:
+		UniformBuffer(Kuint size, Kuint binding, const void* data = nullptr) : size(size), binding(binding) {
+			glGenBuffers(1, &id);
+			glBindBuffer(GL_UNIFORM_BUFFER, id);
+			glBufferData(GL_UNIFORM_BUFFER, size, data, GL_DYNAMIC_DRAW);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		}
+		~UniformBuffer() {
+			if (glIsBuffer(id)) glDeleteBuffers(1, &id);
+		}
+
+		void allocate(Kuint offset, Kuint size, const void* data)const {
+			glBindBuffer(GL_UNIFORM_BUFFER, id);
+			glBufferSubData(GL_UNIFORM_BUFFER, offset, size, data);
+			glBindBuffer(GL_UNIFORM_BUFFER, 0);
+		}
+
+		void allocate(const void* data)const {
+			allocate(0, size, data);
+		}
+
+		void bind()const {
+			glBindBufferBase(GL_UNIFORM_BUFFER, binding, id);
+		}
+
+		Kuint getBinding()const {
+			return binding;
+		}
+	};
+}
+
+#endif // !UNIFORM_BUFFER_H
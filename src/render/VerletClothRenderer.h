@@ -5,7 +5,9 @@
 #ifndef VERLET_CLOTH_RENDERER_H
 #define VERLET_CLOTH_RENDERER_H
 
+#include <deque>
 #include "./Renderer.h"
+#include "./ReadbackRing.h"
 #include "../util/Camera.h"
 #include "../util/Light.h"
 #include "../object/Plane.h"
@@ -20,6 +22,14 @@ namespace KRenderer {
 		KObject::Plane* floor;
 		KObject::Sphere* sphere;
 		KObject::VerletCloth* cloth;
+		KBuffer::ReadbackRing* readback;
+		//positions of the recorded steps on their way to cache_writer
+		KBuffer::ReadbackRing* cache_readback;
+		std::deque<std::uint64_t>* cache_pending;
+		//positions and last positions of a checkpoint on their way to checkpoint_writer
+		KBuffer::ReadbackRing* checkpoint_readback;
+		std::uint64_t checkpoint_tickets[2]; //0 when none is on its way
+		Kulong checkpoint_pending; //its step
 
 		KCamera::Camera* camera;
 		KLight::Light* light;
@@ -34,14 +44,81 @@ namespace KRenderer {
 			camera->bindPosition(shader);
 		}
 
+		//Hands the finished readbacks to the cache in order, wait for the first one if asked.
+		void collectCache(Kboolean wait) {
+			while (!cache_pending->empty()) {
+				const tvec3* positions = cache_readback->map<tvec3>(cache_pending->front(), wait ? 1000000000ull : 0);
+				if (positions == nullptr) {
+					if (wait) continue;
+					break;
+				}
+				wait = false;
+				cache_writer->addFrame(positions);
+				cache_readback->release(cache_pending->front());
+				cache_pending->pop_front();
+			}
+		}
+
+		//The state after step, it comes back a few frames later, see collectCheckpoint.
+		void requestCheckpoint(Kulong step) {
+			if (checkpoint_readback == nullptr) {
+				checkpoint_readback = new KBuffer::ReadbackRing(cloth->getSizeX() * cloth->getSizeY() * sizeof(tvec3), 2);
+			}
+			checkpoint_tickets[0] = cloth->requestPositions(checkpoint_readback);
+			checkpoint_tickets[1] = cloth->requestLastPositions(checkpoint_readback);
+			if (checkpoint_tickets[0] == 0 || checkpoint_tickets[1] == 0) {
+				for (Kuint i = 0; i < 2; ++i) {
+					if (checkpoint_tickets[i] != 0) checkpoint_readback->release(checkpoint_tickets[i]);
+					checkpoint_tickets[i] = 0;
+				}
+				return;
+			}
+			checkpoint_pending = step;
+		}
+
+		//Hands the checkpoint on its way to the writer once both arrays are back,
+		//wait for them if asked.
+		void collectCheckpoint(Kboolean wait) {
+			if (checkpoint_tickets[0] == 0) return;
+			const std::uint64_t timeout = wait ? 1000000000ull : 0;
+			const tvec3* positions = checkpoint_readback->map<tvec3>(checkpoint_tickets[0], timeout);
+			const tvec3* last_positions = checkpoint_readback->map<tvec3>(checkpoint_tickets[1], timeout);
+			if (positions == nullptr || last_positions == nullptr) return;
+			auto state = new KCache::Checkpoint(KCache::VERLET_SOLVER, cloth->getSizeX(), cloth->getSizeY());
+			cloth->saveState(state, positions, last_positions);
+			for (Kuint i = 0; i < 2; ++i) {
+				checkpoint_readback->release(checkpoint_tickets[i]);
+				checkpoint_tickets[i] = 0;
+			}
+			saveCheckpoint(state, checkpoint_pending);
+		}
+
+		//After a step, its positions come back a few frames later.
+		void requestCacheFrame() {
+			std::uint64_t ticket = cloth->requestPositions(cache_readback);
+			while (ticket == 0 && !cache_pending->empty()) {
+				collectCache(true); //the ring is full
+				ticket = cloth->requestPositions(cache_readback);
+			}
+			if (ticket != 0) cache_pending->push_back(ticket);
+		}
+
 	public:
-		VerletClothRenderer(): Renderer(RES_PATH + "phong.vert",
-			RES_PATH + "phong.frag", "ClothSimulation"),
-			back_shader(nullptr), cloth(nullptr),
-			floor(nullptr), sphere(nullptr),
+		VerletClothRenderer(Kboolean headless = false): Renderer(RES_PATH + "phong.vert",
+			RES_PATH + "phong.frag", "ClothSimulation", 1000, 700, headless),
+			back_shader(nullptr), floor(nullptr), sphere(nullptr), cloth(nullptr), readback(nullptr),
+			cache_readback(nullptr), cache_pending(nullptr),
+			checkpoint_readback(nullptr), checkpoint_tickets{ 0, 0 }, checkpoint_pending(0),
 			camera(nullptr), light(nullptr) {
 			back_shader = new KShader::Shader();
-			back_shader->addShader(GL_VERTEX_SHADER, RES_PATH + "verlet.vert");
+			const Kboolean compute = KShader::Shader::isComputeSupported() &&
+				back_shader->addShader(GL_COMPUTE_SHADER, RES_PATH + "verlet.comp");
+			if (!compute) {
+				//GL 3.3, transform feedback
+				delete back_shader;
+				back_shader = new KShader::Shader();
+				back_shader->addShader(GL_VERTEX_SHADER, RES_PATH + "verlet.vert");
+			}
 
 			floor = new KObject::Plane(80, 80, 40, 40);
 			floor->rotate(90, tvec3(-1, 0, 0));
@@ -51,6 +128,9 @@ namespace KRenderer {
 
 			Kuint size_x = 100, size_y = 100;
 			cloth = new KObject::VerletCloth(size_x, size_y);
+			if (compute) cloth->initCompute();
+			readback = new KBuffer::ReadbackRing((size_x + 1) * (size_y + 1) * sizeof(tvec3));
+			cache_pending = new std::deque<std::uint64_t>();
 			//cloth->setPosition(tvec3(0.f, 3.f, 0.f));
 
 			camera = new KCamera::Camera(tvec3(0, 10, 15));
@@ -62,9 +142,15 @@ namespace KRenderer {
 			light->factor = 1.5;
 		}
 		~VerletClothRenderer()override {
+			if (cache_writer != nullptr) collectCache(true);
+			collectCheckpoint(true);
+			delete cache_readback;
+			delete checkpoint_readback;
+			delete cache_pending;
 			delete floor;
 			delete sphere;
 			delete cloth;
+			delete readback;
 			delete camera;
 			delete light;
 			delete back_shader;
@@ -77,16 +163,23 @@ namespace KRenderer {
 			Kboolean light_enable = true;
 			Kboolean sphere_enable = true;
 			Kfloat angle = 0.0;
+			Kint substeps = cloth->getSubsteps();
+			Kboolean substeps_changed = false;
+			Kboolean readback_enable = false;
+			//positions come back a few frames late, nothing waits for them
+			std::deque<std::uint64_t> pending;
+			Kfloat lowest = 0.f;
 #endif // IMGUI_ENABLE
 
 			tvec2 wSize;
 			tvec2 last_mouse = mouse_pos;
-			Kfloat now_time = window->getRunTime();
 
 			back_shader->bind();
-			cloth->initBackBuffer(back_shader);
+			if (!cloth->isCompute()) cloth->initBackBuffer(back_shader);
 			cloth->bindBackUniform(back_shader);
 			back_shader->bindUniform3f("s_center", sphere->getPosition());
+			clock->setStep(cache_reader != nullptr ? cache_reader->getDeltaTime() : cloth->getParams().delta_time);
+			clock->reset(window->getRunTime());
 
 			shader->bind();
 			camera->bindUniform(shader);
@@ -102,28 +195,41 @@ namespace KRenderer {
 				wSize = window->getWindowSize();
 
 #ifdef IMGUI_ENABLE
-				ImGui_ImplGlfwGL3_NewFrame();
-				ImGuiWindowFlags flags = ImGuiWindowFlags_HorizontalScrollbar
-					| ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize;
-
-				ImGui::Begin("GUI", nullptr, flags);
-				ImGui::SetWindowPos(ImVec2(wSize.x, 0));
-				ImGui::SetWindowSize(ImVec2(300, wSize.y));
-
-				ImGui::SetWindowFontScale(1.2);
-				ImGui::Text("Your screen now is %.2f fps.", ImGui::GetIO().Framerate);
-				ImGui::Text("Your mouse pos is %.0f, %.0f", mouse_pos.x, mouse_pos.y);
-				ImGui::Text("Your last mouse pos is %.0f, %.0f", last_mouse.x, last_mouse.y);
-
-				ImGui::Checkbox("light", &light_enable);
-				ImGui::SameLine(150);
-				ImGui::Checkbox("sphere", &sphere_enable);
+				if (!window->isHeadless()) {
+					GPUTimer timer(gpu_profiler, "gui");
+					ImGui_ImplGlfwGL3_NewFrame();
+					ImGuiWindowFlags flags = ImGuiWindowFlags_HorizontalScrollbar
+						| ImGuiWindowFlags_NoMove | ImGuiWindowFlags_NoResize;
+
+					ImGui::Begin("GUI", nullptr, flags);
+					ImGui::SetWindowPos(ImVec2(wSize.x, 0));
+					ImGui::SetWindowSize(ImVec2(300, wSize.y));
+
+					ImGui::SetWindowFontScale(1.2);
+					ImGui::Text("Your screen now is %.2f fps.", ImGui::GetIO().Framerate);
+					ImGui::Text("Your mouse pos is %.0f, %.0f", mouse_pos.x, mouse_pos.y);
+					ImGui::Text("Your last mouse pos is %.0f, %.0f", last_mouse.x, last_mouse.y);
+					ImGui::Text("Simulation steps: %lu, dropped %.2fs", clock->getTotalSteps(), clock->getDroppedTime());
+					ImGui::Text("Solver: %s", cloth->isCompute() ? "compute shader" : "transform feedback");
+
+					ImGui::Checkbox("light", &light_enable);
+					ImGui::SameLine(150);
+					ImGui::Checkbox("sphere", &sphere_enable);
+					substeps_changed = ImGui::SliderInt("substeps", &substeps, 1, 20);
+					ImGui::Checkbox("readback", &readback_enable);
+					if (readback_enable) {
+						ImGui::Text("Lowest point %.3f, %u frames behind", lowest, Kuint(pending.size()));
+					}
+
+					drawCache();
+					drawProfiler();
+
+					ImGui::End();
+					ImGui::Render();
+					ImGui_ImplGlfwGL3_RenderDrawData(ImGui::GetDrawData());
+				}
 				if (light_enable) light->active(shader);
 				else light->unActive(shader);
-
-				ImGui::End();
-				ImGui::Render();
-				ImGui_ImplGlfwGL3_RenderDrawData(ImGui::GetDrawData());
 #endif // IMGUI_ENABLE
 
 				if (mouse[GLFW_MOUSE_BUTTON_LEFT] &&
@@ -135,33 +241,111 @@ namespace KRenderer {
 				}
 				last_mouse = mouse_pos;
 
-				back_shader->bind();
-				if (sphere_enable) {
-					back_shader->bindUniform1f("s_radius", sphere->getRadius());
+				{
+					GPUTimer timer(gpu_profiler, "simulate");
+					back_shader->bind();
+#ifdef IMGUI_ENABLE
+					if (substeps_changed) cloth->setSubsteps(substeps);
+#endif // IMGUI_ENABLE
+					if (sphere_enable) {
+						back_shader->bindUniform1f("s_radius", sphere->getRadius());
+					}
+					else {
+						back_shader->bindUniform1f("s_radius", 0.f);
+					}
+					Kuint steps = clock->advance(window->getRunTime());
+					while (steps--) {
+						if (cache_reader != nullptr) {
+							cloth->loadFrame(cache_reader->getPositions(nextCacheFrame()));
+							continue;
+						}
+						cloth->renderBack();
+						if (cache_writer != nullptr) requestCacheFrame();
+						const Kulong step = clock->getTotalSteps() - steps; //the clock counted the frame's steps
+						if (checkpoint_tickets[0] == 0 && isCheckpointDue(step)) requestCheckpoint(step);
+					}
+					if (cache_writer != nullptr) collectCache(false);
+					collectCheckpoint(false);
 				}
-				else {
-					back_shader->bindUniform1f("s_radius", 0.f);
+				{
+					GPUTimer timer(gpu_profiler, "upload");
+					cloth->interpolate(clock->getAlpha());
+#ifdef IMGUI_ENABLE
+					if (readback_enable) {
+						std::uint64_t ticket = cloth->requestPositions(readback);
+						if (ticket != 0) pending.push_back(ticket);
+					}
+					while (!pending.empty()) {
+						const tvec3* positions = readback->map<tvec3>(pending.front());
+						if (positions == nullptr) break;
+						const Kuint n = readback->getSize(pending.front()) / sizeof(tvec3);
+						lowest = positions[0].y;
+						for (Kuint i = 1; i < n; ++i) {
+							if (positions[i].y < lowest) lowest = positions[i].y;
+						}
+						readback->release(pending.front());
+						pending.pop_front();
+					}
+#endif // IMGUI_ENABLE
 				}
-				cloth->renderBack();
 
-				shader->bind();
-				cloth->bindUniform(shader);
-				cloth->render();
-
-				floor->bindUniform(shader);
-				floor->render();
-				floor->unActiveTexture(shader);
-
-				if (sphere_enable) {
-					sphere->bindUniform(shader);
-					sphere->render();
-					sphere->unActiveTexture(shader);
+				{
+					GPUTimer timer(gpu_profiler, "render");
+					shader->bind();
+					cloth->bindUniform(shader);
+					cloth->render();
+
+					floor->bindUniform(shader);
+					floor->render();
+					floor->unActiveTexture(shader);
+
+					if (sphere_enable) {
+						sphere->bindUniform(shader);
+						sphere->render();
+						sphere->unActiveTexture(shader);
+					}
 				}
 
+				finishFrame();
 				window->update();
 			}
 		}
 
+		//Positions of every step, read back without waiting for them.
+		Kboolean recordCache(const std::string& path, Kboolean compress = false)override {
+			if (cache_writer != nullptr) collectCache(true);
+			delete cache_writer;
+			const std::vector<Kuint>* indices = cloth->getIndices();
+			cache_writer = new KCache::CacheWriter(path, cloth->getSizeX(), cloth->getSizeY(),
+				indices->data(), indices->size(), cloth->getParams().delta_time, compress ? KCache::COMPRESSED : 0);
+			if (!cache_writer->isOpen()) {
+				delete cache_writer;
+				cache_writer = nullptr;
+				return false;
+			}
+			if (cache_readback == nullptr) {
+				cache_readback = new KBuffer::ReadbackRing(cloth->getSizeX() * cloth->getSizeY() * sizeof(tvec3), 4);
+			}
+			return true;
+		}
+
+		Kboolean playCache(const std::string& path)override {
+			return openCache(path, cloth->getSizeX() * cloth->getSizeY());
+		}
+
+		//Positions and last positions every interval steps, read back without waiting for them.
+		Kboolean checkpoint(const std::string& path, Kuint interval = 600)override {
+			return openCheckpoint(path, interval);
+		}
+
+		//From this renderer or a VerletSolverCPU of the same size.
+		Kboolean restore(const std::string& path)override {
+			KCache::Checkpoint state;
+			if (!state.read(path) || !cloth->loadState(state)) return false;
+			restoreClock(state);
+			return true;
+		}
+
 		void resize(Kint w, Kint h)override {
 #ifdef IMGUI_ENABLE
 			Renderer::resize(w - 300, h);
@@ -10,6 +10,7 @@
 #include "../Header.h"
 #include "../math/Vec3.h"
 #include "./VertexBuffer.h"
+#include "./TextureBuffer.h"
 
 namespace KBuffer {
 	class VertexArray {
@@ -17,6 +18,12 @@ namespace KBuffer {
 		Kuint id;
 		std::unordered_set<Kint> *locations;
 
+		void setPointer(Kint location, Kuint size, GLenum type, bool normalized, Kuint stride, Kuint offset) {
+			if (locations == nullptr) locations = new std::unordered_set<Kint>();
+			locations->insert(location);
+			glVertexAttribPointer(location, size, type, normalized, stride, (void*)offset);
+		}
+
 	public:
 		VertexArray() {
 			glGenVertexArrays(1, &id);
@@ -40,9 +47,16 @@ namespace KBuffer {
 			bool normalized = false, Kuint stride = 0, Kuint offset = 0) {
 			bind();
 			vb->bind();
-			if (locations == nullptr) locations = new std::unordered_set<Kint>();
-			locations->insert(location);
-			glVertexAttribPointer(location, size, type, normalized, stride, (void*)offset);
+			setPointer(location, size, type, normalized, stride, offset);
+		}
+
+		//Point the attribute at a texture buffer, e.g. a state written by transform feedback.
+		//Call it again to switch buffers, nothing is copied.
+		void allocate(const TextureBuffer* tb, Kint location, Kuint size, GLenum type,
+			bool normalized = false, Kuint stride = 0, Kuint offset = 0) {
+			bind();
+			tb->bindBuffer(GL_ARRAY_BUFFER);
+			setPointer(location, size, type, normalized, stride, offset);
 		}
 
 		void setVertexAttrib3f(Kint location, const KVector::Vec3& v)const {
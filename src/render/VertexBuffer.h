@@ -15,23 +15,108 @@ namespace KBuffer {
 		VERTEX, INDEX
 	};
 
+	//STREAM is rewritten by the CPU every frame, see beginWrite.
+	enum BufferUsage {
+		STATIC, STREAM
+	};
+
 	class VertexBuffer {
 	private:
+		static const Kuint STREAM_FRAMES = 3; //regions of a persistent stream buffer
+
 		Kuint id;
 		GLenum type;
 
+		//stream only
+		Kuint size; //bytes of one frame
+		Kboolean persistent; //GL 4.4 buffer storage, else the buffer is orphaned every frame
+		Kubyte* mapped; //all regions while persistent, the orphaned storage between begin/endWrite else
+		GLsync fences[STREAM_FRAMES];
+		Kuint region;
+
+		void waitFence(Kuint index) {
+			if (fences[index] == nullptr) return;
+			//the region was drawn at least a frame ago, this almost never waits
+			while (glClientWaitSync(fences[index], GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+			glDeleteSync(fences[index]);
+			fences[index] = nullptr;
+		}
+
 	public:
-		VertexBuffer(Kuint size, const void *data = nullptr, BufferType bufferType = VERTEX) {
+		VertexBuffer(Kuint size, const void *data = nullptr, BufferType bufferType = VERTEX,
+			BufferUsage usage = STATIC): size(size), persistent(false), mapped(nullptr),
+			fences{ nullptr, nullptr, nullptr }, region(0) {
 			if (bufferType == VERTEX) this->type = GL_ARRAY_BUFFER;
 			else this->type = GL_ELEMENT_ARRAY_BUFFER;
 			glGenBuffers(1, &id);
 			glBindBuffer(this->type, id);
-			glBufferData(this->type, size, data, GL_STATIC_DRAW);
+			if (usage == STATIC) {
+				glBufferData(this->type, size, data, GL_STATIC_DRAW);
+				return;
+			}
+
+			persistent = GLEW_VERSION_4_4 || GLEW_ARB_buffer_storage;
+			if (!persistent) {
+				glBufferData(this->type, size, data, GL_STREAM_DRAW);
+				return;
+			}
+			const GLbitfield flags = GL_MAP_WRITE_BIT | GL_MAP_PERSISTENT_BIT | GL_MAP_COHERENT_BIT;
+			glBufferStorage(this->type, size * STREAM_FRAMES, nullptr, flags);
+			mapped = static_cast<Kubyte*>(glMapBufferRange(this->type, 0, size * STREAM_FRAMES, flags));
+			if (mapped == nullptr) {
+				std::cerr << "Map stream buffer failed!" << std::endl;
+				return;
+			}
+			if (data != nullptr) memcpy(mapped, data, size);
 		}
 		~VertexBuffer() {
+			for (auto& fence : fences) {
+				if (fence != nullptr) glDeleteSync(fence);
+			}
+			if (persistent && mapped != nullptr) {
+				glBindBuffer(type, id);
+				glUnmapBuffer(type);
+			}
 			if (glIsBuffer(id)) glDeleteBuffers(1, &id);
 		}
 
+		//Where the CPU writes this frame's size bytes, then endWrite.
+		//A persistent buffer moves to its next region (fencing the one left, it is only drawn
+		//from up to now) and waits for the GPU only if that region is still being drawn.
+		//Without buffer storage the old storage is orphaned and a fresh one is mapped.
+		void* beginWrite() {
+			if (!persistent) {
+				glBindBuffer(type, id);
+				glBufferData(type, size, nullptr, GL_STREAM_DRAW);
+				mapped = static_cast<Kubyte*>(glMapBufferRange(type, 0, size,
+					GL_MAP_WRITE_BIT | GL_MAP_INVALIDATE_BUFFER_BIT));
+				return mapped;
+			}
+			if (mapped == nullptr) return nullptr;
+			if (fences[region] != nullptr) glDeleteSync(fences[region]);
+			fences[region] = glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0);
+			region = (region + 1) % STREAM_FRAMES;
+			waitFence(region);
+			return mapped + region * size;
+		}
+
+		void endWrite() {
+			if (persistent || mapped == nullptr) return;
+			glBindBuffer(type, id);
+			glUnmapBuffer(type);
+			mapped = nullptr;
+		}
+
+		//Byte offset of the data written last, for the attribute pointer.
+		Kuint getOffset()const {
+			return persistent ? region * size : 0;
+		}
+
+		Kboolean isPersistent()const {
+			return persistent;
+		}
+
+		//Not for persistent stream buffers, their storage is immutable.
 		void allocate(Kuint offset, Kuint size, const void* data)const {
 			glBindBuffer(type, id);
 			glBufferSubData(type, offset, size, data);
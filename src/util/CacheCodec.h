@@ -0,0 +1,292 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef CACHE_CODEC_H
+#define CACHE_CODEC_H
+
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <cstdint>
+#include <cfloat>
+#include "../Core.h"
+#include "../math/Vec3.h"
+
+namespace KCache {
+	using tvec3 = KVector::Vec3;
+
+	//Lossy frames for the cache, a few times smaller than the raw ones.
+	//Every channel (positions, velocities) of a frame is quantized to 16 bits inside
+	//its bounding box of the frame. A key frame stores the difference to the particle
+	//before, the others the difference to a prediction from the one or two frames
+	//before (constant or linear, whichever is smaller). Differences are zigzag varints,
+	//x, y and z each in a run of their own, zeros as run lengths.
+	//Predictions use what the decoder will have, so the error never adds up.
+	//
+	//A frame: Kuint size (with itself), Kubyte key, then per channel
+	//Kfloat min[3], max[3], Kubyte predictor, Kuint bytes and the residuals.
+	class FrameCodec {
+	private:
+		enum Predictor {
+			SPATIAL = 0, //key frames
+			CONSTANT = 1,
+			LINEAR = 2
+		};
+
+		static const Kuint LEVELS = 65535;
+
+		Kuint particles;
+		Kuint channels;
+		//decoded frames before, per channel
+		std::vector<tvec3>* last;
+		std::vector<tvec3>* second_last;
+		Kuint history; //frames since the key frame, up to 2
+		std::vector<Kint>* quantized;
+		std::vector<Kint>* residuals[2]; //SPATIAL or CONSTANT, LINEAR
+
+		//NaN (a cloth that blew up) ends at 0.
+		static Kint quantize(Kfloat value, Kfloat min, Kfloat inverse) {
+			const Kfloat q = std::floor((value - min) * inverse + 0.5f);
+			if (!(q > 0.f)) return 0;
+			return q < Kfloat(LEVELS) ? Kint(q) : Kint(LEVELS);
+		}
+
+		template <typename T>
+		static void put(std::vector<Kubyte>* out, const T& value) {
+			const Kubyte* p = reinterpret_cast<const Kubyte*>(&value);
+			out->insert(out->end(), p, p + sizeof(T));
+		}
+
+		template <typename T>
+		static Kboolean get(const Kubyte*& in, const Kubyte* end, T& value) {
+			if (end - in < Kint(sizeof(T))) return false;
+			memcpy(&value, in, sizeof(T));
+			in += sizeof(T);
+			return true;
+		}
+
+		static void putVarint(std::vector<Kubyte>* out, Kuint value) {
+			while (value >= 0x80) {
+				out->emplace_back(Kubyte(value | 0x80));
+				value >>= 7;
+			}
+			out->emplace_back(Kubyte(value));
+		}
+
+		static Kboolean getVarint(const Kubyte*& in, const Kubyte* end, Kuint& value) {
+			value = 0;
+			for (Kuint shift = 0; in < end && shift < 35; shift += 7) {
+				const Kubyte byte = *in++;
+				value |= Kuint(byte & 0x7F) << shift;
+				if ((byte & 0x80) == 0) return true;
+			}
+			return false;
+		}
+
+		//Zigzag varints, a 0 byte starts a run of zeros (a varint of anything else never
+		//starts with it) followed by the run length - 1.
+		static void pack(const std::vector<Kint>& values, std::vector<Kubyte>* out) {
+			const Ksize n = values.size();
+			for (Ksize i = 0; i < n;) {
+				if (values[i] == 0) {
+					Ksize run = 1;
+					while (i + run < n && values[i + run] == 0) ++run;
+					out->emplace_back(0);
+					putVarint(out, Kuint(run - 1));
+					i += run;
+					continue;
+				}
+				const Kint v = values[i++];
+				putVarint(out, (Kuint(v) << 1) ^ Kuint(v >> 31));
+			}
+		}
+
+		static Kboolean unpack(const Kubyte* in, const Kubyte* end, std::vector<Kint>* values) {
+			const Ksize n = values->size();
+			for (Ksize i = 0; i < n;) {
+				if (in >= end) return false;
+				Kuint v;
+				if (*in == 0) {
+					++in;
+					if (!getVarint(in, end, v) || i + v + 1 > n) return false;
+					for (Kuint j = 0; j <= v; ++j) (*values)[i++] = 0;
+					continue;
+				}
+				if (!getVarint(in, end, v)) return false;
+				(*values)[i++] = Kint(v >> 1) ^ -Kint(v & 1);
+			}
+			return in == end;
+		}
+
+		//What the decoder predicts for particle i, axis a of channel c.
+		Kfloat predict(Kuint c, Predictor predictor, Ksize i, Kuint a)const {
+			const Kfloat l = last[c][i][a];
+			if (predictor == LINEAR) return l + (l - second_last[c][i][a]);
+			return l;
+		}
+
+		//Residuals of channel c for predictor, planar x, y, z. Sum of their sizes.
+		std::uint64_t residualsOf(Kuint c, Predictor predictor, const Kfloat* min, const Kfloat* inverse,
+			std::vector<Kint>* out)const {
+			std::uint64_t cost = 0;
+			for (Kuint a = 0; a < 3; ++a) {
+				const Kint* q = quantized->data() + a * particles;
+				Kint* r = out->data() + a * particles;
+				for (Ksize i = 0; i < particles; ++i) {
+					const Kint p = predictor == SPATIAL ? (i > 0 ? q[i - 1] : 0) :
+						quantize(predict(c, predictor, i, a), min[a], inverse[a]);
+					r[i] = q[i] - p;
+					cost += r[i] < 0 ? -r[i] : r[i];
+				}
+			}
+			return cost;
+		}
+
+		//q back to values of channel c into data, they become the last frame.
+		void reconstruct(Kuint c, const Kfloat* min, const Kfloat* scale, tvec3* data) {
+			second_last[c].swap(last[c]);
+			for (Kuint a = 0; a < 3; ++a) {
+				const Kint* q = quantized->data() + a * particles;
+				for (Ksize i = 0; i < particles; ++i) {
+					last[c][i][a] = min[a] + Kfloat(q[i]) * scale[a];
+				}
+			}
+			if (data != nullptr) std::copy(last[c].begin(), last[c].end(), data);
+		}
+
+	public:
+		FrameCodec(Kuint particles, Kuint channels = 1) : particles(particles), channels(channels),
+			last(nullptr), second_last(nullptr), history(0), quantized(nullptr), residuals{ nullptr, nullptr } {
+			last = new std::vector<tvec3>[channels];
+			second_last = new std::vector<tvec3>[channels];
+			for (Kuint c = 0; c < channels; ++c) {
+				last[c].resize(particles);
+				second_last[c].resize(particles);
+			}
+			quantized = new std::vector<Kint>(particles * 3);
+			for (Kuint i = 0; i < 2; ++i) residuals[i] = new std::vector<Kint>(particles * 3);
+		}
+		~FrameCodec() {
+			delete[] last;
+			delete[] second_last;
+			delete quantized;
+			for (Kuint i = 0; i < 2; ++i) delete residuals[i];
+		}
+
+		FrameCodec(const FrameCodec&) = delete;
+		FrameCodec& operator=(const FrameCodec&) = delete;
+
+		//Appends a frame of data[channel] to out, the first one has to be a key frame.
+		void encode(const tvec3* const* data, Kboolean key, std::vector<Kubyte>* out) {
+			if (history == 0) key = true;
+			const Ksize start = out->size();
+			put(out, Kuint(0)); //size, set at the end
+			put(out, Kubyte(key));
+			if (key) history = 0;
+
+			for (Kuint c = 0; c < channels; ++c) {
+				const tvec3* v = data[c];
+				Kfloat min[3], max[3], scale[3], inverse[3];
+				for (Kuint a = 0; a < 3; ++a) {
+					min[a] = FLT_MAX;
+					max[a] = -FLT_MAX;
+				}
+				for (Ksize i = 0; i < particles; ++i) {
+					for (Kuint a = 0; a < 3; ++a) {
+						if (v[i][a] < min[a]) min[a] = v[i][a];
+						if (v[i][a] > max[a]) max[a] = v[i][a];
+					}
+				}
+				for (Kuint a = 0; a < 3; ++a) {
+					if (min[a] > max[a]) min[a] = max[a] = 0.f; //nothing but NaN
+					scale[a] = (max[a] - min[a]) / LEVELS;
+					inverse[a] = scale[a] > 0.f ? 1.f / scale[a] : 0.f;
+					Kint* q = quantized->data() + a * particles;
+					for (Ksize i = 0; i < particles; ++i) q[i] = quantize(v[i][a], min[a], inverse[a]);
+				}
+
+				Predictor predictor = SPATIAL;
+				Kuint best = 0;
+				if (!key) {
+					predictor = CONSTANT;
+					const std::uint64_t constant = residualsOf(c, CONSTANT, min, inverse, residuals[0]);
+					if (history > 1 && residualsOf(c, LINEAR, min, inverse, residuals[1]) < constant) {
+						predictor = LINEAR;
+						best = 1;
+					}
+				}
+				else residualsOf(c, SPATIAL, min, inverse, residuals[0]);
+
+				for (Kuint a = 0; a < 3; ++a) {
+					put(out, min[a]);
+				}
+				for (Kuint a = 0; a < 3; ++a) {
+					put(out, max[a]);
+				}
+				put(out, Kubyte(predictor));
+				const Ksize bytes_at = out->size();
+				put(out, Kuint(0));
+				pack(*residuals[best], out);
+				const Kuint bytes = Kuint(out->size() - bytes_at - sizeof(Kuint));
+				memcpy(out->data() + bytes_at, &bytes, sizeof(Kuint));
+
+				reconstruct(c, min, scale, nullptr);
+			}
+			if (history < 2) ++history;
+			const Kuint size = Kuint(out->size() - start);
+			memcpy(out->data() + start, &size, sizeof(Kuint));
+		}
+
+		//One frame from in into data[channel], false when it is broken. A frame that is
+		//not a key frame needs the frame before it decoded last.
+		Kboolean decode(const Kubyte* in, std::uint64_t size, tvec3* const* data) {
+			const Kubyte* end = in + size;
+			Kuint frame_size;
+			Kubyte key;
+			if (!get(in, end, frame_size) || frame_size != size || !get(in, end, key)) return false;
+			if (key) history = 0;
+			else if (history == 0) return false;
+
+			for (Kuint c = 0; c < channels; ++c) {
+				Kfloat min[3], max[3], scale[3], inverse[3];
+				Kubyte predictor;
+				Kuint bytes;
+				for (Kuint a = 0; a < 3; ++a) {
+					if (!get(in, end, min[a])) return false;
+				}
+				for (Kuint a = 0; a < 3; ++a) {
+					if (!get(in, end, max[a])) return false;
+				}
+				if (!get(in, end, predictor) || !get(in, end, bytes) || std::uint64_t(end - in) < bytes) return false;
+				if (predictor > LINEAR || (predictor == LINEAR && history < 2) || (predictor == SPATIAL) != (key != 0)) {
+					return false;
+				}
+				if (!unpack(in, in + bytes, residuals[0])) return false;
+				in += bytes;
+
+				for (Kuint a = 0; a < 3; ++a) {
+					scale[a] = (max[a] - min[a]) / LEVELS;
+					inverse[a] = scale[a] > 0.f ? 1.f / scale[a] : 0.f;
+					Kint* q = quantized->data() + a * particles;
+					const Kint* r = residuals[0]->data() + a * particles;
+					for (Ksize i = 0; i < particles; ++i) {
+						const Kint p = predictor == SPATIAL ? (i > 0 ? q[i - 1] : 0) :
+							quantize(predict(c, Predictor(predictor), i, a), min[a], inverse[a]);
+						q[i] = p + r[i];
+					}
+				}
+				reconstruct(c, min, scale, data[c]);
+			}
+			if (history < 2) ++history;
+			return in == end;
+		}
+
+		Kuint getChannelCount()const {
+			return channels;
+		}
+	};
+}
+
+#endif // !CACHE_CODEC_H
@@ -8,6 +8,7 @@
 #include <string>
 #include "../Header.h"
 #include "../render/Shader.h"
+#include "../render/UniformBuffer.h"
 #include "../math/Vec3.h"
 #include "../math/Mat4.h"
 #include "../math/transform.h"
@@ -24,15 +25,24 @@ namespace KCamera{
 		using tquaternion = KMatrix::Quaternion;
 		using tmat4 = KMatrix::Mat4;
 
+	private:
+		//std140 layout of the Camera block in phong.vert (row_major)
+		struct CameraBlock {
+			Kfloat view[16]; //u_view
+			Kfloat projection[16]; //u_proj
+			Kfloat eye[3]; //p_eye
+			Kfloat padding;
+		};
+
+		mutable KBuffer::UniformBuffer* ubo; //made on the first bind
+		mutable Kboolean dirty;
+
 	protected:
         tvec3 position;
         tquaternion view; //view rotation
         tmat4 projection;
         tquaternion rotate; //camera rotation
 
-		const static std::string EYE; //p_eye
-		const static std::string VIEW; //u_view
-		const static std::string PROJ; //u_proj
 
 		tmat4 toViewMatrix()const {
 			tmat3 tmp(view.toMat3());
@@ -40,39 +50,56 @@ namespace KCamera{
 		}
 
     public:
-        explicit Camera(const tvec3 &pos = tvec3()): position(pos),
-                 view(tquaternion()), rotate(tquaternion()){
+        explicit Camera(const tvec3 &pos = tvec3()): ubo(nullptr), dirty(true),
+                 position(pos), view(tquaternion()), rotate(tquaternion()) {
 			setOrtho(-1, 1, -1, 1, -1, 1);
 		} //ortho
         Camera(const tvec3 &eye, const tvec3 &center, const tvec3 &up):
-			rotate(tquaternion()) {
+			ubo(nullptr), dirty(true), rotate(tquaternion()) {
 			setOrtho(-1, 1, -1, 1, -1, 1);
             setView(eye, center, up);
         }
         Camera(const Kfloat &fovy, const Kfloat &aspect,
                const Kfloat &zNear, const Kfloat &zFar,
-               const tvec3 &pos = tvec3()):position(pos),
-			view(tquaternion()), rotate(tquaternion()) {
+               const tvec3 &pos = tvec3()):ubo(nullptr), dirty(true),
+			position(pos), view(tquaternion()), rotate(tquaternion()) {
             setPerspective(fovy, aspect, zNear, zFar);
         }
-		virtual ~Camera() = default;
+		virtual ~Camera() {
+			delete ubo;
+		}
 
+		const static std::string U_BLOCK; //Camera: u_view, u_proj, p_eye
+
+		//The Camera block, uploaded only after a change. The shader needs
+		//bindUniformBlock(U_BLOCK, CAMERA_BLOCK) once.
 		void bindUniform(const KShader::Shader *shader)const {
-			shader->bindUniform3f(EYE, rotate * position);
-			shader->bindUniformMat4(VIEW, toViewMatrix());
-			shader->bindUniformMat4(PROJ, projection);
+			if (ubo == nullptr) ubo = new KBuffer::UniformBuffer(sizeof(CameraBlock), KBuffer::CAMERA_BLOCK);
+			if (dirty) {
+				CameraBlock block;
+				memcpy(block.view, toViewMatrix().data(), sizeof(block.view));
+				memcpy(block.projection, projection.data(), sizeof(block.projection));
+				const tvec3 eye(rotate * position);
+				memcpy(block.eye, eye.data(), sizeof(block.eye));
+				block.padding = 0.f;
+				ubo->allocate(&block);
+				dirty = false;
+			}
+			ubo->bind();
 		}
 
+		//The whole block goes at once now.
 		void bindPosition(const KShader::Shader* shader)const {
-			shader->bindUniform3f(EYE, rotate * position);
-			shader->bindUniformMat4(VIEW, toViewMatrix());
+			bindUniform(shader);
 		}
 
         void setPosition(const tvec3 &v){
             position = v;
+            dirty = true;
         }
 		void setRotation(const Kfloat& angle, const tvec3& axis) {
 			rotate = tquaternion(-angle, axis);
+			dirty = true;
 		}
         void setView(const tvec3 &eye, const tvec3 &center, const tvec3 &up){
             //u-v-n is left-hand coordinate
@@ -82,23 +109,27 @@ namespace KCamera{
 
             position = eye;
             view = tquaternion().fromMatrix(tmat3(u, v, -n));
+            dirty = true;
         }
         void setPerspective(const Kfloat &fovy, const Kfloat &aspect,
 			                const Kfloat &zNear, const Kfloat &zFar){
             projection = KFunction::perspective(fovy, aspect, zNear, zFar);
-
+            dirty = true;
         }
         void setOrtho(const Kfloat &left, const Kfloat &right, const Kfloat &bottom,
 			          const Kfloat &top, const Kfloat &near, const Kfloat &far){
             projection = KFunction::ortho(left, right, bottom, top, near, far);
+            dirty = true;
         }
         void setFrustum(const Kfloat &left, const Kfloat &right, const Kfloat &bottom,
                            const Kfloat &top, const Kfloat &near, const Kfloat &far){
             projection = KFunction::frustum(left, right, bottom, top, near, far);
+            dirty = true;
         }
 
         void rotateCamera(const Kfloat &angle, const tvec3 &v){
             rotate *= tquaternion(-angle, v);
+            dirty = true;
         }
         void rotateView(const Kfloat &angle, const tvec3 &v){
             //note: view is a inverse rotate matrix(also transpose matrix),
@@ -106,10 +137,12 @@ namespace KCamera{
             //you should right multiply a transpose rotate matrix
             //(rot * originView).inverse = originView.inverse * rot.inverse = view * rot.transpose
             view *= tquaternion(-angle, v); //view *= tquaternion(angle, v).getConjugate();
+            dirty = true;
         }
 
 		void translate(const tvec3 &v) {
 			position += v;
+			dirty = true;
 		}
 
 		tvec3 getDirection(DirectionType type = FORWARD)const {
@@ -135,15 +168,13 @@ namespace KCamera{
 			//Be sure to use it between ImGui::Begin() and ImGui::End();
 			//Maybe the function will be private in the future.
 			//Remember to rebind the value when you want to change the value in OpenGL.
-			ImGui::SliderFloat3("camera", &position[0], -10, 10);
+			if (ImGui::SliderFloat3("camera", &position[0], -10, 10)) dirty = true;
 		}
 #endif // IMGUI_ENABLE
 
     };
 
-	const std::string Camera::EYE("p_eye");
-	const std::string Camera::VIEW("u_view");
-	const std::string Camera::PROJ("u_proj");
+	const std::string Camera::U_BLOCK("Camera");
 }
 
 #endif CAMERA_H
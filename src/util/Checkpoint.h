@@ -0,0 +1,321 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef CHECKPOINT_H
+#define CHECKPOINT_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include <algorithm>
+#include <type_traits>
+#include "../Core.h"
+#include "./WorkQueue.h"
+
+namespace KCache {
+	//What wrote a checkpoint, it restores into a solver of the same kind only.
+	//VERLET and EULER are shared by the CPU solver and the GPU cloth of their kind.
+	enum CheckpointSolver {
+		CLOTH_SOLVER = 0, //KPhysics::ClothSolver
+		VERLET_SOLVER = 1, //KPhysics::VerletSolverCPU, KObject::VerletCloth
+		EULER_SOLVER = 2 //KPhysics::EulerSolverCPU, KObject::EulerCloth
+	};
+
+	enum CheckpointTag {
+		PARAMS = 0, //the params struct of the solver, as it is
+		SOLVER_STATE = 1, //what else the solver keeps, see its saveState
+		POSITIONS = 2,
+		LAST_POSITIONS = 3,
+		VELOCITIES = 4,
+		ACCELERATIONS = 5,
+		MASSES = 6,
+		PINNED = 7, //bitmask, one bit per particle as in KPhysics::Particles
+		FIRST_GUESS = 8 //where an iterative solver starts its next solve
+	};
+
+	struct CheckpointHeader {
+		char magic[4]; //KSCP
+		Kuint version;
+		Kuint solver; //CheckpointSolver
+		Kuint particles;
+		Kuint size_x, size_y;
+		Kuint section_count;
+		Kuint reserved;
+		std::uint64_t step; //steps done when it was taken
+		Kdouble time; //simulated seconds
+		std::uint64_t bytes; //of the sections
+		std::uint64_t checksum; //FNV-1a of the sections
+	};
+	static_assert(sizeof(CheckpointHeader) == 64, "CheckpointHeader is written as it is");
+
+	struct CheckpointSection {
+		Kuint tag; //CheckpointTag
+		Kuint element_size;
+		std::uint64_t bytes; //without the padding to 8 bytes
+	};
+	static_assert(sizeof(CheckpointSection) == 16, "CheckpointSection is written as it is");
+
+	static const char CHECKPOINT_MAGIC[4] = { 'K', 'S', 'C', 'P' };
+	static const Kuint CHECKPOINT_VERSION = 1;
+
+	//The whole state of a solver at one step: a header and tagged sections.
+	//Sections a reader does not know are skipped, so later versions only add tags;
+	//a section of another size than the solver expects fails the restore.
+	//Params are written as their struct, a change of its layout needs a new version.
+	class Checkpoint {
+	private:
+		CheckpointHeader header;
+		std::vector<Kubyte>* data; //the sections, as in the file
+
+		static std::uint64_t hash(const Kubyte* data, std::uint64_t bytes) {
+			std::uint64_t key = 14695981039346656037ull;
+			for (std::uint64_t i = 0; i < bytes; ++i) {
+				key ^= data[i];
+				key *= 1099511628211ull;
+			}
+			return key;
+		}
+
+		const CheckpointSection* find(Kuint tag)const {
+			std::uint64_t offset = 0;
+			while (offset + sizeof(CheckpointSection) <= data->size()) {
+				const CheckpointSection* section = reinterpret_cast<const CheckpointSection*>(data->data() + offset);
+				//the checksum does not catch a length written wrong on purpose
+				if (section->bytes > data->size() - offset - sizeof(CheckpointSection)) {
+					std::cerr << "Checkpoint section " << section->tag << " runs past the end" << std::endl;
+					return nullptr;
+				}
+				if (section->tag == tag) return section;
+				offset += sizeof(CheckpointSection) + (section->bytes + 7) / 8 * 8;
+			}
+			return nullptr;
+		}
+
+	public:
+		Checkpoint(Kuint solver = CLOTH_SOLVER, Kuint size_x = 0, Kuint size_y = 0) : data(nullptr) {
+			memset(&header, 0, sizeof(CheckpointHeader));
+			memcpy(header.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC));
+			header.version = CHECKPOINT_VERSION;
+			header.solver = solver;
+			header.particles = size_x * size_y;
+			header.size_x = size_x;
+			header.size_y = size_y;
+			data = new std::vector<Kubyte>();
+		}
+		~Checkpoint() {
+			delete data;
+		}
+
+		Checkpoint(const Checkpoint&) = delete;
+		Checkpoint& operator=(const Checkpoint&) = delete;
+
+		//count values of T as the section tag.
+		template <typename T>
+		void put(Kuint tag, const T* values, Ksize count) {
+			static_assert(std::is_trivially_copyable<T>::value, "Checkpoint sections are written as bytes");
+			CheckpointSection section;
+			section.tag = tag;
+			section.element_size = sizeof(T);
+			section.bytes = std::uint64_t(count) * sizeof(T);
+			const Kubyte* p = reinterpret_cast<const Kubyte*>(&section);
+			data->insert(data->end(), p, p + sizeof(CheckpointSection));
+			p = reinterpret_cast<const Kubyte*>(values);
+			data->insert(data->end(), p, p + section.bytes);
+			data->resize((data->size() + 7) / 8 * 8, 0);
+			++header.section_count;
+		}
+
+		//False when there is no such section, it is left alone then.
+		//A section of another size is an error.
+		template <typename T>
+		Kboolean get(Kuint tag, T* values, Ksize count)const {
+			static_assert(std::is_trivially_copyable<T>::value, "Checkpoint sections are read as bytes");
+			const CheckpointSection* section = find(tag);
+			if (section == nullptr) return false;
+			if (section->element_size != sizeof(T) || section->bytes != std::uint64_t(count) * sizeof(T)) {
+				std::cerr << "Checkpoint section " << tag << " is of another size" << std::endl;
+				return false;
+			}
+			//sections start at 8 bytes, aligned for every T
+			std::copy_n(reinterpret_cast<const T*>(section + 1), count, values);
+			return true;
+		}
+
+		Kboolean has(Kuint tag)const {
+			return find(tag) != nullptr;
+		}
+
+		//For the solver it is restored into, false with the reason when it does not fit.
+		Kboolean matches(Kuint solver, Kuint size_x, Kuint size_y)const {
+			if (header.solver != solver) {
+				std::cerr << "Checkpoint is of another solver" << std::endl;
+				return false;
+			}
+			if (header.size_x != size_x || header.size_y != size_y) {
+				std::cerr << "Checkpoint is of a " << header.size_x << " x " << header.size_y
+					<< " cloth, not " << size_x << " x " << size_y << std::endl;
+				return false;
+			}
+			return true;
+		}
+
+		//Loads path as it is, the sections are checked by their checksum.
+		Kboolean read(const std::string& path) {
+			std::ifstream file(path, std::ios::binary | std::ios::ate);
+			if (!file.is_open()) {
+				std::cerr << "Cannot open checkpoint: " << path << std::endl;
+				return false;
+			}
+			const std::uint64_t size = file.tellg();
+			file.seekg(0);
+			CheckpointHeader loaded;
+			if (!file.read(reinterpret_cast<char*>(&loaded), sizeof(CheckpointHeader)) ||
+				memcmp(loaded.magic, CHECKPOINT_MAGIC, sizeof(CHECKPOINT_MAGIC)) != 0) {
+				std::cerr << "Not a checkpoint: " << path << std::endl;
+				return false;
+			}
+			if (loaded.version > CHECKPOINT_VERSION) {
+				std::cerr << "Checkpoint of a newer version " << loaded.version << ": " << path << std::endl;
+				return false;
+			}
+			if (loaded.bytes != size - sizeof(CheckpointHeader)) {
+				std::cerr << "Checkpoint is broken: " << path << std::endl;
+				return false;
+			}
+			std::vector<Kubyte> sections(loaded.bytes);
+			if (!file.read(reinterpret_cast<char*>(sections.data()), loaded.bytes) ||
+				hash(sections.data(), loaded.bytes) != loaded.checksum) {
+				std::cerr << "Checkpoint is broken: " << path << std::endl;
+				return false;
+			}
+			header = loaded;
+			data->swap(sections);
+			return true;
+		}
+
+		//To path + ".tmp" first, it only replaces path once it is complete, so a run
+		//stopped in the middle of a write still has the checkpoint before.
+		Kboolean write(const std::string& path) {
+			header.bytes = data->size();
+			header.checksum = hash(data->data(), data->size());
+			const std::string tmp(path + ".tmp");
+			{
+				std::ofstream file(tmp, std::ios::binary | std::ios::trunc);
+				if (!file.is_open()) {
+					std::cerr << "Cannot open checkpoint: " << tmp << std::endl;
+					return false;
+				}
+				file.write(reinterpret_cast<const char*>(&header), sizeof(CheckpointHeader));
+				file.write(reinterpret_cast<const char*>(data->data()), data->size());
+				file.flush();
+				if (!file.good()) {
+					std::cerr << "Cannot write checkpoint: " << tmp << std::endl;
+					return false;
+				}
+			}
+			if (!replaceFile(tmp, path)) {
+				std::cerr << "Cannot replace checkpoint: " << path << std::endl;
+				return false;
+			}
+			return true;
+		}
+
+		void setStep(std::uint64_t step, Kdouble time) {
+			header.step = step;
+			header.time = time;
+		}
+
+		std::uint64_t getStep()const {
+			return header.step;
+		}
+
+		Kdouble getTime()const {
+			return header.time;
+		}
+
+		Kuint getSolver()const {
+			return header.solver;
+		}
+
+		Kuint getParticleCount()const {
+			return header.particles;
+		}
+
+		Kuint getSizeX()const {
+			return header.size_x;
+		}
+
+		Kuint getSizeY()const {
+			return header.size_y;
+		}
+
+		Kuint getVersion()const {
+			return header.version;
+		}
+	};
+
+	//Writes checkpoints to one path on a worker thread. The step loop only fills a
+	//Checkpoint (copies of the state arrays) and hands it over; one that comes while
+	//the one before is still being written is dropped, ask isBusy before filling it.
+	class CheckpointWriter {
+	private:
+		std::string path;
+		KThread::WorkQueue* worker;
+		std::atomic<Kboolean> busy;
+		std::atomic<Kuint> written;
+		std::atomic<std::uint64_t> last_step; //of the last one written
+
+	public:
+		CheckpointWriter(const std::string& path) : path(path), worker(nullptr),
+			busy(false), written(0), last_step(0) {
+			worker = new KThread::WorkQueue(1, 1);
+		}
+		~CheckpointWriter() {
+			delete worker; //finishes the one being written
+		}
+
+		Kboolean isBusy()const {
+			return busy;
+		}
+
+		//Takes checkpoint over, false (and it is deleted) while the one before is written.
+		Kboolean save(Checkpoint* checkpoint) {
+			if (busy.exchange(true)) {
+				delete checkpoint;
+				return false;
+			}
+			worker->push([this, checkpoint]() {
+				if (checkpoint->write(path)) {
+					last_step = checkpoint->getStep();
+					++written;
+				}
+				delete checkpoint;
+				busy = false;
+			});
+			return true;
+		}
+
+		//Until the one being written is on disk.
+		void wait() {
+			worker->wait();
+		}
+
+		const std::string& getPath()const {
+			return path;
+		}
+
+		Kuint getCount()const {
+			return written;
+		}
+
+		std::uint64_t getLastStep()const {
+			return last_step;
+		}
+	};
+}
+
+#endif // !CHECKPOINT_H
@@ -0,0 +1,271 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <atomic>
+#include <mutex>
+#include <chrono>
+#include <cstring>
+#include <cstdint>
+#include "../Core.h"
+
+namespace KTime {
+	//Where a frame goes. ScopeTimer times a scope on the CPU, the GL side adds GPU times
+	//with addGPUScope (see KRenderer::GPUTimer). Every thread writes its scopes into a
+	//ring of its own, endFrame (once a frame, on the main thread) drains the rings, adds
+	//the scopes up by name and streams them to the CSV file if one is open.
+	//Nothing is recorded until setEnabled, a scope costs one atomic load then.
+	class Profiler {
+		friend class ScopeTimer;
+
+	public:
+		//Totals of one name over the last frame.
+		struct Phase {
+			const char* name;
+			Kdouble cpu_ms; //summed over the threads
+			Kdouble gpu_ms; //GPU times come a few frames late
+			Kuint calls;
+			std::vector<Kfloat>* history; //cpu_ms of the last HISTORY frames
+		};
+
+		static const Kuint HISTORY;
+
+	private:
+		struct Event {
+			const char* name;
+			std::uint64_t begin, end; //ns
+			Kuint frame;
+			Kuint depth;
+		};
+
+		//Written by its thread only, read by endFrame only.
+		struct ThreadRing {
+			Kuint thread;
+			Kuint depth; //of the open scopes
+			std::vector<Event>* events;
+			std::atomic<std::uint64_t> head; //next to write
+			std::atomic<std::uint64_t> tail; //next to read
+		};
+
+		static const Kuint RING_SIZE;
+
+		std::atomic<Kboolean> enabled;
+		std::atomic<Kuint> frame;
+		std::atomic<Kuint> dropped; //scopes lost to a full ring
+		std::chrono::steady_clock::time_point start;
+		std::uint64_t frame_begin;
+
+		std::mutex mutex; //rings
+		std::vector<ThreadRing*>* rings;
+		//current is filled while draining, last is what the GUI shows
+		std::vector<Phase>* current;
+		std::vector<Phase>* last;
+		std::vector<Kfloat>* frame_history;
+		Kdouble frame_ms;
+
+		std::uint64_t gpu_start; //first GPU timestamp, the CSV begins at 0
+
+		std::ofstream* csv;
+
+		Profiler() : enabled(false), frame(0), dropped(0), start(std::chrono::steady_clock::now()),
+			frame_begin(0), rings(nullptr), current(nullptr), last(nullptr), frame_history(nullptr),
+			frame_ms(0.0), gpu_start(0), csv(nullptr) {
+			rings = new std::vector<ThreadRing*>();
+			current = new std::vector<Phase>();
+			last = new std::vector<Phase>();
+			frame_history = new std::vector<Kfloat>(HISTORY, 0.f);
+		}
+
+		std::uint64_t getTime()const {
+			return std::chrono::duration_cast<std::chrono::nanoseconds>(
+				std::chrono::steady_clock::now() - start).count();
+		}
+
+		//The ring of the calling thread, made on its first scope.
+		ThreadRing* getRing() {
+			static thread_local ThreadRing* ring = nullptr;
+			if (ring != nullptr) return ring;
+			ring = new ThreadRing();
+			ring->depth = 0;
+			ring->events = new std::vector<Event>(RING_SIZE);
+			ring->head = 0;
+			ring->tail = 0;
+			std::lock_guard<std::mutex> lock(mutex);
+			ring->thread = rings->size();
+			rings->emplace_back(ring);
+			return ring;
+		}
+
+		void push(ThreadRing* ring, const Event& event) {
+			const std::uint64_t head = ring->head.load(std::memory_order_relaxed);
+			if (head - ring->tail.load(std::memory_order_acquire) >= RING_SIZE) {
+				++dropped;
+				return;
+			}
+			(*ring->events)[head % RING_SIZE] = event;
+			ring->head.store(head + 1, std::memory_order_release);
+		}
+
+		Phase& getPhase(const char* name) {
+			for (auto &it : *current) {
+				if (it.name == name || strcmp(it.name, name) == 0) return it;
+			}
+			current->push_back({ name, 0.0, 0.0, 0, new std::vector<Kfloat>(HISTORY, 0.f) });
+			return current->back();
+		}
+
+	public:
+		~Profiler() {
+			closeCSV();
+			for (auto &it : *rings) {
+				delete it->events;
+				delete it;
+			}
+			for (auto &it : *current) delete it.history;
+			delete rings;
+			delete current;
+			delete last;
+			delete frame_history;
+		}
+
+		static Profiler& instance() {
+			static Profiler profiler;
+			return profiler;
+		}
+
+		void setEnabled(Kboolean enable = true) {
+			if (enable && !enabled) frame_begin = getTime();
+			enabled = enable;
+		}
+
+		Kboolean isEnabled()const {
+			return enabled.load(std::memory_order_relaxed);
+		}
+
+		//Every scope from now on as a row, begin and duration in microseconds.
+		Kboolean openCSV(const std::string& path) {
+			closeCSV();
+			csv = new std::ofstream(path);
+			if (!csv->is_open()) {
+				std::cerr << "Cannot open profile file: " << path << std::endl;
+				delete csv;
+				csv = nullptr;
+				return false;
+			}
+			*csv << "frame,device,thread,phase,depth,begin_us,duration_us\n";
+			return true;
+		}
+
+		void closeCSV() {
+			if (csv == nullptr) return;
+			csv->flush();
+			delete csv;
+			csv = nullptr;
+		}
+
+		//A GPU scope, begin and end are GL timestamps in ns. On the thread of endFrame.
+		void addGPUScope(const char* name, Kuint frame, std::uint64_t begin, std::uint64_t end) {
+			if (!enabled) return;
+			if (gpu_start == 0) gpu_start = begin;
+			getPhase(name).gpu_ms += (end - begin) / 1e6;
+			if (csv != nullptr) {
+				*csv << frame << ",gpu,0," << name << ",0,"
+					<< (begin - gpu_start) / 1e3 << "," << (end - begin) / 1e3 << "\n";
+			}
+		}
+
+		//Once a frame on the main thread, after the last scope of the frame.
+		void endFrame() {
+			if (!enabled) return;
+			const std::uint64_t now = getTime();
+			frame_ms = (now - frame_begin) / 1e6;
+			frame_begin = now;
+
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				for (auto ring : *rings) {
+					const std::uint64_t head = ring->head.load(std::memory_order_acquire);
+					for (std::uint64_t i = ring->tail.load(std::memory_order_relaxed); i < head; ++i) {
+						const Event& event = (*ring->events)[i % RING_SIZE];
+						Phase& phase = getPhase(event.name);
+						phase.cpu_ms += (event.end - event.begin) / 1e6;
+						++phase.calls;
+						if (csv != nullptr) {
+							*csv << event.frame << ",cpu," << ring->thread << "," << event.name << ","
+								<< event.depth << "," << event.begin / 1e3 << ","
+								<< (event.end - event.begin) / 1e3 << "\n";
+						}
+					}
+					ring->tail.store(head, std::memory_order_release);
+				}
+			}
+
+			const Kuint index = frame % HISTORY;
+			(*frame_history)[index] = frame_ms;
+			for (auto &it : *current) (*it.history)[index] = it.cpu_ms;
+			*last = *current;
+			for (auto &it : *current) {
+				it.cpu_ms = it.gpu_ms = 0.0;
+				it.calls = 0;
+			}
+			++frame;
+		}
+
+		const std::vector<Phase>& getPhases()const {
+			return *last;
+		}
+
+		Kdouble getFrameTime()const {
+			return frame_ms;
+		}
+
+		Kuint getFrame()const {
+			return frame;
+		}
+
+		Kuint getDroppedCount()const {
+			return dropped;
+		}
+
+		//The last HISTORY frame times, index getFrame() % HISTORY is the oldest.
+		const std::vector<Kfloat>& getFrameHistory()const {
+			return *frame_history;
+		}
+	};
+
+	//Times the scope it lives in on the CPU, name has to outlive the profiler (a literal).
+	class ScopeTimer {
+	private:
+		Profiler::ThreadRing* ring;
+		const char* name;
+		std::uint64_t begin;
+		Kuint frame;
+
+	public:
+		explicit ScopeTimer(const char* name) : ring(nullptr), name(name), begin(0), frame(0) {
+			Profiler& profiler = Profiler::instance();
+			if (!profiler.isEnabled()) return;
+			ring = profiler.getRing();
+			++ring->depth;
+			frame = profiler.frame;
+			begin = profiler.getTime();
+		}
+		~ScopeTimer() {
+			if (ring == nullptr) return;
+			Profiler& profiler = Profiler::instance();
+			--ring->depth;
+			profiler.push(ring, { name, begin, profiler.getTime(), frame, ring->depth });
+		}
+
+		ScopeTimer(const ScopeTimer&) = delete;
+		ScopeTimer& operator=(const ScopeTimer&) = delete;
+	};
+}
+
+#endif // !PROFILER_H
@@ -0,0 +1,398 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef SIMULATION_CACHE_H
+#define SIMULATION_CACHE_H
+
+#include <vector>
+#include <string>
+#include <fstream>
+#include <cstring>
+#include <cstdint>
+#include <atomic>
+#include "../Core.h"
+#include "../math/Vec3.h"
+#include "./WorkQueue.h"
+#include "./CacheCodec.h"
+
+namespace KCache {
+	using tvec3 = KVector::Vec3;
+
+	//A simulation written once and played back many times.
+	//The file is a header, the topology (triangle indices of a size_x * size_y grid),
+	//the frames from frames_offset on and a table with the offset of every frame.
+	//A frame is the positions of every particle and, with HAS_VELOCITIES, the velocities,
+	//all in the local space of the cloth. With COMPRESSED the frames are FrameCodec frames,
+	//one in key_interval is a key frame. A file that was not closed has no table,
+	//then the frames are counted from the file size (or walked, compressed).
+	enum CacheFlag {
+		HAS_VELOCITIES = 1 << 0,
+		COMPRESSED = 1 << 1
+	};
+
+	struct CacheHeader {
+		char magic[4]; //KSCC
+		Kuint version;
+		Kuint particles;
+		Kuint size_x, size_y;
+		Kuint flags;
+		Kuint index_count;
+		Kuint frame_count;
+		Kuint key_interval; //COMPRESSED only
+		Kfloat delta_time; //of a frame
+		std::uint64_t frame_size; //bytes, before compression
+		std::uint64_t frames_offset; //page aligned
+		std::uint64_t table_offset; //0 while the file is written
+	};
+	static_assert(sizeof(CacheHeader) == 64, "CacheHeader is written as it is");
+
+	static const char CACHE_MAGIC[4] = { 'K', 'S', 'C', 'C' };
+	static const Kuint CACHE_VERSION = 2;
+	static const Kuint CACHE_ALIGNMENT = 4096;
+	static const Kuint CACHE_CHUNK = 1 << 22; //bytes per write
+
+	//A file mapped read only, the definitions are in core.cpp.
+	class MappedFile {
+	private:
+		const Kubyte* data;
+		std::uint64_t size;
+		void* file; //HANDLE on Windows
+		void* mapping; //HANDLE on Windows
+
+	public:
+		MappedFile() : data(nullptr), size(0), file(nullptr), mapping(nullptr) {}
+		~MappedFile() {
+			close();
+		}
+
+		MappedFile(const MappedFile&) = delete;
+		MappedFile& operator=(const MappedFile&) = delete;
+
+		bool open(const std::string& path);
+		void close();
+
+		const Kubyte* getData()const {
+			return data;
+		}
+
+		std::uint64_t getSize()const {
+			return size;
+		}
+	};
+
+	//Streams frames to a cache file. addFrame hands a copy of the frame to a worker
+	//thread that compresses it and writes CACHE_CHUNK bytes at once, the caller only
+	//waits when the worker is a few frames behind.
+	class CacheWriter {
+	private:
+		CacheHeader header;
+		std::ofstream* file;
+		FrameCodec* codec; //COMPRESSED only
+		KThread::WorkQueue* worker;
+		//the worker's from here on
+		std::vector<Kubyte>* chunk;
+		std::vector<std::uint64_t>* table;
+		std::uint64_t end; //where the next chunk goes
+		std::atomic<Kuint> written;
+		std::atomic<std::uint64_t> bytes; //of the written frames
+
+		void flush() {
+			if (chunk->empty()) return;
+			file->seekp(end);
+			file->write(reinterpret_cast<const char*>(chunk->data()), chunk->size());
+			end += chunk->size();
+			chunk->clear();
+		}
+
+		//On the worker, channels one after the other in frame.
+		void write(const std::vector<tvec3>* frame) {
+			const Kuint index = table->size();
+			const Ksize start = chunk->size();
+			table->emplace_back(end + start);
+			if (codec != nullptr) {
+				const tvec3* channels[2] = { frame->data(), frame->data() + header.particles };
+				codec->encode(channels, index % header.key_interval == 0, chunk);
+			}
+			else {
+				const Kubyte* p = reinterpret_cast<const Kubyte*>(frame->data());
+				chunk->insert(chunk->end(), p, p + header.frame_size);
+			}
+			bytes += chunk->size() - start;
+			if (chunk->size() >= CACHE_CHUNK) flush();
+			++written;
+		}
+
+	public:
+		//flags are CacheFlag, a key frame every key_interval frames with COMPRESSED.
+		CacheWriter(const std::string& path, Kuint size_x, Kuint size_y,
+			const Kuint* indices, Kuint index_count, Kfloat delta_time,
+			Kuint flags = 0, Kuint key_interval = 30) :
+			file(nullptr), codec(nullptr), worker(nullptr), chunk(nullptr), table(nullptr), end(0), written(0), bytes(0) {
+			const Kboolean velocities = (flags & HAS_VELOCITIES) != 0;
+			memset(&header, 0, sizeof(CacheHeader));
+			memcpy(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC));
+			header.version = CACHE_VERSION;
+			header.particles = size_x * size_y;
+			header.size_x = size_x;
+			header.size_y = size_y;
+			header.flags = flags & (HAS_VELOCITIES | COMPRESSED);
+			header.index_count = index_count;
+			header.key_interval = (flags & COMPRESSED) ? (key_interval > 0 ? key_interval : 1) : 0;
+			header.delta_time = delta_time;
+			header.frame_size = std::uint64_t(header.particles) * sizeof(tvec3) * (velocities ? 2 : 1);
+			const std::uint64_t topology_end = sizeof(CacheHeader) + std::uint64_t(index_count) * sizeof(Kuint);
+			header.frames_offset = (topology_end + CACHE_ALIGNMENT - 1) / CACHE_ALIGNMENT * CACHE_ALIGNMENT;
+			end = header.frames_offset;
+
+			chunk = new std::vector<Kubyte>();
+			chunk->reserve(CACHE_CHUNK + header.frame_size);
+			table = new std::vector<std::uint64_t>();
+			if (flags & COMPRESSED) codec = new FrameCodec(header.particles, velocities ? 2 : 1);
+
+			file = new std::ofstream(path, std::ios::binary | std::ios::trunc);
+			if (!file->is_open()) {
+				std::cerr << "Cannot open cache file: " << path << std::endl;
+				delete file;
+				file = nullptr;
+				return;
+			}
+			file->write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+			if (index_count > 0) file->write(reinterpret_cast<const char*>(indices), index_count * sizeof(Kuint));
+			//one worker keeps the frames in order, the codec needs the ones before
+			worker = new KThread::WorkQueue(1, 4);
+		}
+		~CacheWriter() {
+			close();
+			delete worker;
+			delete codec;
+			delete chunk;
+			delete table;
+		}
+
+		Kboolean isOpen()const {
+			return file != nullptr;
+		}
+
+		//velocities is only read with HAS_VELOCITIES. Both are copied, they can change
+		//as soon as this returns.
+		void addFrame(const tvec3* positions, const tvec3* velocities = nullptr) {
+			if (file == nullptr) return;
+			auto* frame = new std::vector<tvec3>(positions, positions + header.particles);
+			if (header.flags & HAS_VELOCITIES) {
+				if (velocities == nullptr) frame->resize(header.particles * 2, tvec3(0.f));
+				else frame->insert(frame->end(), velocities, velocities + header.particles);
+			}
+			worker->push([this, frame]() {
+				write(frame);
+				delete frame;
+			});
+		}
+
+		//Waits for the worker, writes what is left, the table and the final header.
+		Kboolean close() {
+			if (file == nullptr) return false;
+			worker->wait();
+			flush();
+			header.frame_count = table->size();
+			//the reader loads the table straight from the mapping
+			const char pad[sizeof(std::uint64_t)] = { 0 };
+			file->seekp(end);
+			file->write(pad, (sizeof(std::uint64_t) - end % sizeof(std::uint64_t)) % sizeof(std::uint64_t));
+			header.table_offset = (end + sizeof(std::uint64_t) - 1) / sizeof(std::uint64_t) * sizeof(std::uint64_t);
+			file->write(reinterpret_cast<const char*>(table->data()), table->size() * sizeof(std::uint64_t));
+			file->seekp(0);
+			file->write(reinterpret_cast<const char*>(&header), sizeof(CacheHeader));
+			const Kboolean good = file->good();
+			if (!good) std::cerr << "Cannot write cache file" << std::endl;
+			delete file;
+			file = nullptr;
+			return good;
+		}
+
+		//Frames written so far, a few behind addFrame.
+		Kuint getFrameCount()const {
+			return written;
+		}
+
+		//Bytes of the frames written so far, compressed or not.
+		std::uint64_t getSize()const {
+			return bytes;
+		}
+	};
+
+	//Maps a cache file, a raw frame is a pointer into the mapping.
+	//Compressed frames are decoded into a frame of the reader's own, going on from the
+	//frame before when it can and from the key frame before otherwise.
+	class CacheReader {
+	private:
+		MappedFile* file;
+		CacheHeader header;
+		const Kuint* indices;
+		const std::uint64_t* table; //nullptr when the file was not closed and is not compressed
+		std::vector<std::uint64_t>* walked; //the table of a compressed file that was not closed
+
+		FrameCodec* codec; //COMPRESSED only
+		std::vector<tvec3>* decoded; //positions, then velocities
+		Kuint decoded_frame; //the one in decoded, frame_count when none
+
+		std::uint64_t getOffset(Kuint frame)const {
+			return table != nullptr ? table[frame] : header.frames_offset + frame * header.frame_size;
+		}
+
+		//The frames of a compressed file that was not closed, each one starts with its size.
+		void walk() {
+			walked = new std::vector<std::uint64_t>();
+			std::uint64_t offset = header.frames_offset;
+			Kuint size;
+			while (offset + sizeof(Kuint) <= file->getSize()) {
+				memcpy(&size, file->getData() + offset, sizeof(Kuint));
+				if (size < sizeof(Kuint) || offset + size > file->getSize()) break;
+				walked->emplace_back(offset);
+				offset += size;
+			}
+			table = walked->data();
+			header.frame_count = walked->size();
+		}
+
+		const tvec3* decode(Kuint frame) {
+			if (frame == decoded_frame) return decoded->data();
+			Kuint next = frame - frame % header.key_interval;
+			if (decoded_frame < frame && decoded_frame >= next) next = decoded_frame + 1;
+			tvec3* channels[2] = { decoded->data(), decoded->data() + header.particles };
+			for (; next <= frame; ++next) {
+				const std::uint64_t offset = getOffset(next);
+				Kuint size = 0;
+				if (offset + sizeof(Kuint) <= file->getSize()) memcpy(&size, file->getData() + offset, sizeof(Kuint));
+				if (offset + size > file->getSize() || !codec->decode(file->getData() + offset, size, channels)) {
+					std::cerr << "Broken frame in cache file: " << next << std::endl;
+					decoded_frame = header.frame_count;
+					return decoded->data();
+				}
+				decoded_frame = next;
+			}
+			return decoded->data();
+		}
+
+	public:
+		CacheReader(const std::string& path) : file(nullptr), indices(nullptr), table(nullptr), walked(nullptr),
+			codec(nullptr), decoded(nullptr), decoded_frame(0) {
+			memset(&header, 0, sizeof(CacheHeader));
+			file = new MappedFile();
+			if (!file->open(path)) {
+				std::cerr << "Cannot open cache file: " << path << std::endl;
+				return;
+			}
+			if (file->getSize() < sizeof(CacheHeader)) {
+				std::cerr << "Not a cache file: " << path << std::endl;
+				file->close();
+				return;
+			}
+			memcpy(&header, file->getData(), sizeof(CacheHeader));
+			if (memcmp(header.magic, CACHE_MAGIC, sizeof(CACHE_MAGIC)) != 0 || header.version != CACHE_VERSION
+				|| header.frame_size == 0 || header.frames_offset > file->getSize()
+				|| ((header.flags & COMPRESSED) && header.key_interval == 0)) {
+				std::cerr << "Not a cache file or another version: " << path << std::endl;
+				file->close();
+				return;
+			}
+			//frames are read as particles values and the topology lies before them
+			const std::uint64_t particles = std::uint64_t(header.size_x) * header.size_y;
+			if (header.particles != particles ||
+				header.frame_size != particles * sizeof(tvec3) * (hasVelocities() ? 2 : 1) ||
+				sizeof(CacheHeader) + std::uint64_t(header.index_count) * sizeof(Kuint) > header.frames_offset) {
+				std::cerr << "Broken cache file header: " << path << std::endl;
+				file->close();
+				return;
+			}
+			indices = reinterpret_cast<const Kuint*>(file->getData() + sizeof(CacheHeader));
+
+			if (header.table_offset >= header.frames_offset && header.table_offset % sizeof(std::uint64_t) == 0 &&
+				header.table_offset <= file->getSize() &&
+				header.table_offset + std::uint64_t(header.frame_count) * sizeof(std::uint64_t) <= file->getSize()) {
+				table = reinterpret_cast<const std::uint64_t*>(file->getData() + header.table_offset);
+				//a raw frame is read straight from the mapping, a compressed one checks its size
+				const std::uint64_t frame_size = isCompressed() ? sizeof(Kuint) : header.frame_size;
+				for (Kuint k = 0; k < header.frame_count && table != nullptr; ++k) {
+					if (table[k] < header.frames_offset || table[k] + frame_size > header.table_offset) {
+						table = nullptr; //cut short
+					}
+				}
+			}
+			if (table == nullptr) {
+				//the writer did not get to close, keep the whole frames
+				if (isCompressed()) walk();
+				else header.frame_count = Kuint((file->getSize() - header.frames_offset) / header.frame_size);
+				header.table_offset = 0;
+				std::cerr << "Cache file was not closed, " << header.frame_count << " frames: " << path << std::endl;
+			}
+
+			if (isCompressed()) {
+				codec = new FrameCodec(header.particles, hasVelocities() ? 2 : 1);
+				decoded = new std::vector<tvec3>(header.particles * (hasVelocities() ? 2 : 1));
+				decoded_frame = header.frame_count;
+			}
+		}
+		~CacheReader() {
+			delete codec;
+			delete decoded;
+			delete walked;
+			delete file;
+		}
+
+		Kboolean isOpen()const {
+			return file->getData() != nullptr;
+		}
+
+		//frame has to be below getFrameCount(). A compressed frame holds until the next
+		//getPositions or getVelocities of another frame.
+		const tvec3* getPositions(Kuint frame) {
+			if (codec != nullptr) return decode(frame);
+			return reinterpret_cast<const tvec3*>(file->getData() + getOffset(frame));
+		}
+
+		//nullptr without HAS_VELOCITIES.
+		const tvec3* getVelocities(Kuint frame) {
+			if (!hasVelocities()) return nullptr;
+			return getPositions(frame) + header.particles;
+		}
+
+		const Kuint* getIndices()const {
+			return indices;
+		}
+
+		Kuint getIndexCount()const {
+			return header.index_count;
+		}
+
+		Kuint getFrameCount()const {
+			return header.frame_count;
+		}
+
+		Kuint getParticleCount()const {
+			return header.particles;
+		}
+
+		Kuint getSizeX()const {
+			return header.size_x;
+		}
+
+		Kuint getSizeY()const {
+			return header.size_y;
+		}
+
+		Kfloat getDeltaTime()const {
+			return header.delta_time;
+		}
+
+		Kboolean hasVelocities()const {
+			return (header.flags & HAS_VELOCITIES) != 0;
+		}
+
+		Kboolean isCompressed()const {
+			return (header.flags & COMPRESSED) != 0;
+		}
+	};
+}
+
+#endif // !SIMULATION_CACHE_H
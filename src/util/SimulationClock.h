@@ -0,0 +1,99 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef SIMULATION_CLOCK_H
+#define SIMULATION_CLOCK_H
+
+#include "../Core.h"
+
+namespace KTime {
+	//Fixed step accumulator (Fiedler, Fix Your Timestep!).
+	//Frame time goes into an accumulator and comes out as whole steps of a fixed
+	//length, so the simulation runs the same whatever the frame rate is.
+	//At most max_substeps steps run per frame, time above that is dropped so a
+	//slow frame (or a break point) can not make the next frames slower and slower.
+	//What is left in the accumulator gives the alpha to draw between the last
+	//two states.
+	class SimulationClock {
+	private:
+		Kdouble step;
+		Kuint max_substeps;
+
+		Kdouble accumulator;
+		Kdouble last_time;
+		Kboolean started;
+
+		Kulong total_steps;
+		Kdouble dropped_time;
+
+	public:
+		SimulationClock(Kdouble step = 1.0 / 60.0, Kuint max_substeps = 8) :
+			step(step), max_substeps(max_substeps), accumulator(0.0), last_time(0.0),
+			started(false), total_steps(0), dropped_time(0.0) {}
+
+		//The next advance starts counting from now.
+		void reset(Kdouble now) {
+			accumulator = 0.0;
+			last_time = now;
+			started = true;
+		}
+
+		//Returns how many steps to run for the time up to now.
+		Kuint advance(Kdouble now) {
+			if (!started) reset(now);
+			Kdouble frame_time = now - last_time;
+			last_time = now;
+			if (frame_time < 0.0) frame_time = 0.0;
+			accumulator += frame_time;
+
+			Kuint steps = Kuint(accumulator / step);
+			if (steps > max_substeps) {
+				dropped_time += (steps - max_substeps) * step;
+				steps = max_substeps;
+			}
+			accumulator -= steps * step;
+			if (accumulator >= step) accumulator = fmod(accumulator, step);
+			total_steps += steps;
+			return steps;
+		}
+
+		//Between 0 and 1, how far the frame is between the last state and the next one.
+		Kfloat getAlpha()const {
+			return Kfloat(accumulator / step);
+		}
+
+		void setStep(Kdouble step) {
+			if (step > 0.0) this->step = step;
+		}
+
+		Kdouble getStep()const {
+			return step;
+		}
+
+		//0 stops the simulation but the clock keeps time.
+		void setMaxSubsteps(Kuint max_substeps) {
+			this->max_substeps = max_substeps;
+		}
+
+		Kuint getMaxSubsteps()const {
+			return max_substeps;
+		}
+
+		Kulong getTotalSteps()const {
+			return total_steps;
+		}
+
+		//A run restored from a checkpoint goes on counting from its step.
+		void setTotalSteps(Kulong total_steps) {
+			this->total_steps = total_steps;
+		}
+
+		//Simulation time lost to the substep cap.
+		Kdouble getDroppedTime()const {
+			return dropped_time;
+		}
+	};
+}
+
+#endif // !SIMULATION_CLOCK_H
@@ -0,0 +1,160 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <atomic>
+#include <condition_variable>
+#include "../Core.h"
+
+namespace KThread {
+	//A fixed pool of workers for data parallel loops.
+	//The calling thread works as thread 0, so a pool with one thread spawns nothing
+	//and parallelFor just runs the loop in place.
+	class ThreadPool {
+	private:
+		using Invoker = void(*)(const void*, Ksize, Ksize, Kuint);
+
+		std::vector<std::thread>* workers;
+		Kuint thread_count;
+
+		std::mutex mutex;
+		std::condition_variable start_cond;
+		std::condition_variable done_cond;
+		Kulong generation;
+		Kuint pending;
+		Kboolean stop;
+
+		//current job
+		Invoker invoker;
+		const void* job;
+		Ksize job_begin, job_end, job_grain;
+		Kboolean job_dynamic;
+		std::atomic<Ksize> job_next;
+
+		void runJob(Kuint thread) {
+			if (job_dynamic) {
+				for (;;) {
+					Ksize begin = job_next.fetch_add(job_grain);
+					if (begin >= job_end) break;
+					Ksize end = begin + job_grain < job_end ? begin + job_grain : job_end;
+					invoker(job, begin, end, thread);
+				}
+			}
+			else {
+				//static schedule, thread t always gets the t-th slice
+				Ksize n = job_end - job_begin;
+				Ksize begin = job_begin + n * thread / thread_count;
+				Ksize end = job_begin + n * (thread + 1) / thread_count;
+				if (begin < end) invoker(job, begin, end, thread);
+			}
+		}
+
+		//seen starts at the generation current when the worker was created, so a
+		//restarted pool does not run the job that already finished.
+		void workerLoop(Kuint thread, Kulong seen) {
+			for (;;) {
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					start_cond.wait(lock, [&] { return stop || generation != seen; });
+					if (stop) return;
+					seen = generation;
+				}
+				runJob(thread);
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					if (--pending == 0) done_cond.notify_one();
+				}
+			}
+		}
+
+		void startWorkers() {
+			Kulong current;
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stop = false;
+				current = generation;
+			}
+			for (Kuint i = 1; i < thread_count; ++i) {
+				workers->emplace_back(&ThreadPool::workerLoop, this, i, current);
+			}
+		}
+
+		void stopWorkers() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stop = true;
+			}
+			start_cond.notify_all();
+			for (auto &it : *workers) it.join();
+			workers->clear();
+		}
+
+		template <typename F>
+		static void invoke(const void* f, Ksize begin, Ksize end, Kuint thread) {
+			(*static_cast<const F*>(f))(begin, end, thread);
+		}
+
+	public:
+		explicit ThreadPool(Kuint count = 0) : workers(nullptr), thread_count(1),
+			generation(0), pending(0), stop(false), invoker(nullptr), job(nullptr),
+			job_begin(0), job_end(0), job_grain(1), job_dynamic(false), job_next(0) {
+			workers = new std::vector<std::thread>();
+			setThreadCount(count);
+		}
+		~ThreadPool() {
+			stopWorkers();
+			delete workers;
+		}
+
+		//0 means one thread per hardware thread.
+		void setThreadCount(Kuint count) {
+			if (count == 0) count = std::thread::hardware_concurrency();
+			if (count == 0) count = 1;
+			if (count == thread_count && workers->size() + 1 == count) return;
+			stopWorkers();
+			thread_count = count;
+			startWorkers();
+		}
+
+		Kuint getThreadCount()const {
+			return thread_count;
+		}
+
+		//Call f(begin, end, thread) over slices of [begin, end) and wait for all of them.
+		//With dynamic = false every thread gets one fixed slice, so the split only
+		//depends on the range and the thread count. With dynamic = true threads pull
+		//slices of grain items until the range runs out.
+		template <typename F>
+		void parallelFor(Ksize begin, Ksize end, const F& f, Kboolean dynamic = false, Ksize grain = 256) {
+			if (begin >= end) return;
+			if (thread_count == 1) {
+				f(begin, end, 0);
+				return;
+			}
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				invoker = &ThreadPool::invoke<F>;
+				job = &f;
+				job_begin = begin;
+				job_end = end;
+				job_grain = grain > 0 ? grain : 1;
+				job_dynamic = dynamic;
+				job_next.store(begin);
+				pending = thread_count - 1;
+				++generation;
+			}
+			start_cond.notify_all();
+			runJob(0);
+			std::unique_lock<std::mutex> lock(mutex);
+			done_cond.wait(lock, [&] { return pending == 0; });
+		}
+	};
+}
+
+#endif // !THREAD_POOL_H
@@ -0,0 +1,101 @@
+//
+// Created by KingSun on 2026/10/18
+//
+
+#ifndef WORK_QUEUE_H
+#define WORK_QUEUE_H
+
+#include <deque>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <functional>
+#include <condition_variable>
+#include "../Core.h"
+
+namespace KThread {
+	//Background workers for independent tasks (encoding, disk writes).
+	//ThreadPool is for loops the caller waits on, this one never blocks the caller
+	//unless capacity tasks are already waiting, then push waits for a free place,
+	//so a producer that is faster than the workers can not eat up the memory.
+	class WorkQueue {
+	private:
+		std::vector<std::thread>* workers;
+		std::deque<std::function<void()>>* tasks;
+		Kuint capacity;
+
+		std::mutex mutex;
+		std::condition_variable task_cond; //a task came or stop
+		std::condition_variable space_cond; //a task was taken
+		std::condition_variable done_cond; //nothing queued nor running
+		Kuint running;
+		Kboolean stop;
+
+		void workerLoop() {
+			for (;;) {
+				std::function<void()> task;
+				{
+					std::unique_lock<std::mutex> lock(mutex);
+					task_cond.wait(lock, [&] { return stop || !tasks->empty(); });
+					if (tasks->empty()) return; //stop, and everything is done
+					task = std::move(tasks->front());
+					tasks->pop_front();
+					++running;
+				}
+				space_cond.notify_one();
+				task();
+				{
+					std::lock_guard<std::mutex> lock(mutex);
+					--running;
+					if (running == 0 && tasks->empty()) done_cond.notify_all();
+				}
+			}
+		}
+
+	public:
+		//0 threads means one per hardware thread, 0 capacity twice the threads.
+		explicit WorkQueue(Kuint count = 0, Kuint capacity = 0) : workers(nullptr), tasks(nullptr),
+			capacity(capacity), running(0), stop(false) {
+			if (count == 0) count = std::thread::hardware_concurrency();
+			if (count == 0) count = 1;
+			if (this->capacity == 0) this->capacity = count * 2;
+			tasks = new std::deque<std::function<void()>>();
+			workers = new std::vector<std::thread>();
+			for (Kuint i = 0; i < count; ++i) {
+				workers->emplace_back(&WorkQueue::workerLoop, this);
+			}
+		}
+		//Runs what is queued before joining.
+		~WorkQueue() {
+			{
+				std::lock_guard<std::mutex> lock(mutex);
+				stop = true;
+			}
+			task_cond.notify_all();
+			for (auto &it : *workers) it.join();
+			delete workers;
+			delete tasks;
+		}
+
+		void push(std::function<void()> task) {
+			{
+				std::unique_lock<std::mutex> lock(mutex);
+				space_cond.wait(lock, [&] { return tasks->size() < capacity; });
+				tasks->emplace_back(std::move(task));
+			}
+			task_cond.notify_one();
+		}
+
+		//Until every pushed task has run.
+		void wait() {
+			std::unique_lock<std::mutex> lock(mutex);
+			done_cond.wait(lock, [&] { return running == 0 && tasks->empty(); });
+		}
+
+		Kuint getThreadCount()const {
+			return workers->size();
+		}
+	};
+}
+
+#endif // !WORK_QUEUE_H